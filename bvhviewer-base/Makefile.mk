@@ -1,12 +1,12 @@
 # Makefile para Windows
 
 PROG = bvhviewer.exe
-FONTES = main.c opengl.c
+FONTES = main.c opengl.c draw.c bvh.c skin.c trail.c reload.c parallel.c quat.c filter.c pick.c capsule.c capture.c queue.c image.c stream.c posepub.c bounds.c names.c rootmotion.c loop.c
 OBJETOS = $(FONTES:.c=.o)
 CFLAGS = -O3 -g -Iinclude # -Wall -g  # Todas as warnings, infos de debug
 
 # Troque -Llib\GL por -Llib\GL\x64 se estiver utilizando o MinGW 64!
-LDFLAGS = -Llib\GL -lfreeglut -lopengl32 -lglu32 -lm
+LDFLAGS = -Llib\GL -lfreeglut -lopengl32 -lglu32 -lpthread -lm
 
 CC = gcc
 
@@ -0,0 +1,188 @@
+// **********************************************************************
+//	bounds.c
+//  Caixas envolventes por frame calculadas na carga e teste de caixas
+//  contra o volume de visao
+// **********************************************************************
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "bounds.h"
+#include "parallel.h"
+
+// Frames por tarefa de parallelFor
+#define BOUNDS_BLOCK 64
+
+// Maior valor quantizado
+#define BOUNDS_LEVELS 65535
+
+void poseBounds(const float *world, int numNodes, float *min, float *max) {
+#ifdef __SSE__
+  // A 4a coluna das matrizes e (x, y, z, 1): o 4o componente e ignorado
+  __m128 lo = _mm_loadu_ps(world + 12), hi = lo;
+  for (int i = 1; i < numNodes; i++) {
+    __m128 p = _mm_loadu_ps(world + i * 16 + 12);
+    lo = _mm_min_ps(lo, p);
+    hi = _mm_max_ps(hi, p);
+  }
+  float l[4], h[4];
+  _mm_storeu_ps(l, lo);
+  _mm_storeu_ps(h, hi);
+  memcpy(min, l, 3 * sizeof(float));
+  memcpy(max, h, 3 * sizeof(float));
+#else
+  for (int k = 0; k < 3; k++)
+    min[k] = max[k] = world[12 + k];
+  for (int i = 1; i < numNodes; i++)
+    for (int k = 0; k < 3; k++) {
+      float v = world[i * 16 + 12 + k];
+      min[k] = v < min[k] ? v : min[k];
+      max[k] = v > max[k] ? v : max[k];
+    }
+#endif
+}
+
+typedef struct {
+  const Clip *clip;
+  float *exact;  // frames x 6 (caixas exatas)
+  float *blocks; // uma caixa por bloco
+} BoundsJob;
+
+static void boundsBlock(int block, int thread, void *ctx) {
+  BoundsJob *job = ctx;
+  const Clip *clip = job->clip;
+  int first = block * BOUNDS_BLOCK;
+  int last = first + BOUNDS_BLOCK < clip->totalFrames ? first + BOUNDS_BLOCK
+                                                      : clip->totalFrames;
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  float *acc = job->blocks + block * 6;
+  for (int f = first; f < last; f++) {
+    float *box = job->exact + (size_t)f * 6;
+    computeWorld(clip, f, world);
+    poseBounds(world, clip->numNodes, box, box + 3);
+    for (int k = 0; k < 3; k++) {
+      if (f == first || box[k] < acc[k])
+        acc[k] = box[k];
+      if (f == first || box[3 + k] > acc[3 + k])
+        acc[3 + k] = box[3 + k];
+    }
+  }
+  free(world);
+}
+
+ClipBounds *computeClipBounds(const Clip *clip, int numThreads) {
+  int frames = clip->totalFrames;
+  if (frames <= 0 || clip->numNodes <= 0)
+    return NULL;
+  int numBlocks = (frames + BOUNDS_BLOCK - 1) / BOUNDS_BLOCK;
+  BoundsJob job = {clip, malloc((size_t)frames * 6 * sizeof(float)),
+                   malloc(numBlocks * 6 * sizeof(float))};
+  parallelFor(numBlocks, numThreads, boundsBlock, &job);
+
+  ClipBounds *b = malloc(sizeof(ClipBounds));
+  b->frames = frames;
+  memcpy(b->min, job.blocks, 3 * sizeof(float));
+  memcpy(b->max, job.blocks + 3, 3 * sizeof(float));
+  for (int i = 1; i < numBlocks; i++)
+    for (int k = 0; k < 3; k++) {
+      b->min[k] = fminf(b->min[k], job.blocks[i * 6 + k]);
+      b->max[k] = fmaxf(b->max[k], job.blocks[i * 6 + 3 + k]);
+    }
+
+  // Quantiza relativo a caixa do clip: min para baixo, max para cima
+  float inv[3];
+  for (int k = 0; k < 3; k++) {
+    float extent = b->max[k] - b->min[k];
+    b->step[k] = extent > 0 ? extent / BOUNDS_LEVELS : 0;
+    inv[k] = extent > 0 ? BOUNDS_LEVELS / extent : 0;
+  }
+  b->boxes = malloc((size_t)frames * 6 * sizeof(unsigned short));
+  for (int f = 0; f < frames; f++) {
+    const float *box = job.exact + (size_t)f * 6;
+    unsigned short *q = b->boxes + (size_t)f * 6;
+    for (int k = 0; k < 3; k++) {
+      float lo = floorf((box[k] - b->min[k]) * inv[k]);
+      float hi = ceilf((box[3 + k] - b->min[k]) * inv[k]);
+      // O arredondamento de step * q pode perder a ultima fracao: folga de
+      // um passo, limitada a caixa do clip
+      lo = lo > 0 ? lo - 1 : 0;
+      hi = hi < BOUNDS_LEVELS ? hi + 1 : BOUNDS_LEVELS;
+      q[k] = (unsigned short)lo;
+      q[3 + k] = (unsigned short)hi;
+    }
+  }
+  free(job.exact);
+  free(job.blocks);
+  return b;
+}
+
+void freeClipBounds(ClipBounds *b) {
+  if (!b)
+    return;
+  free(b->boxes);
+  free(b);
+}
+
+void frameBounds(const ClipBounds *b, int frame, float *min, float *max) {
+  const unsigned short *q = b->boxes + (size_t)frame * 6;
+  for (int k = 0; k < 3; k++) {
+    min[k] = b->min[k] + q[k] * b->step[k];
+    max[k] = q[3 + k] == BOUNDS_LEVELS ? b->max[k]
+                                        : b->min[k] + q[3 + k] * b->step[k];
+  }
+}
+
+void rangeBounds(const ClipBounds *b, int first, int last, float *min,
+                 float *max) {
+  first = first < 0 ? 0 : first;
+  last = last >= b->frames ? b->frames - 1 : last;
+  unsigned short lo[3], hi[3];
+  memcpy(lo, b->boxes + (size_t)first * 6, sizeof(lo));
+  memcpy(hi, b->boxes + (size_t)first * 6 + 3, sizeof(hi));
+  for (int f = first + 1; f <= last; f++) {
+    const unsigned short *q = b->boxes + (size_t)f * 6;
+    for (int k = 0; k < 3; k++) {
+      lo[k] = q[k] < lo[k] ? q[k] : lo[k];
+      hi[k] = q[3 + k] > hi[k] ? q[3 + k] : hi[k];
+    }
+  }
+  for (int k = 0; k < 3; k++) {
+    min[k] = b->min[k] + lo[k] * b->step[k];
+    max[k] = hi[k] == BOUNDS_LEVELS ? b->max[k] : b->min[k] + hi[k] * b->step[k];
+  }
+}
+
+// **********************************************************************
+//  Volume de visao
+// **********************************************************************
+
+void frustumPlanes(const float *proj, const float *model, float planes[6][4]) {
+  float m[16];
+  matMul(proj, model, m);
+  // Linha r da matriz de recorte (armazenada por colunas): m[r + 4 * c].
+  // Planos: w + x, w - x, w + y, w - y, w + z, w - z
+  for (int i = 0; i < 6; i++) {
+    int r = i / 2;
+    float sign = i % 2 ? -1.0f : 1.0f;
+    for (int c = 0; c < 4; c++)
+      planes[i][c] = m[3 + 4 * c] + sign * m[r + 4 * c];
+  }
+}
+
+int boxInFrustum(const float planes[6][4], const float *min, const float *max) {
+  for (int i = 0; i < 6; i++) {
+    const float *p = planes[i];
+    // Vertice da caixa mais a frente na direcao da normal
+    float x = p[0] >= 0 ? max[0] : min[0];
+    float y = p[1] >= 0 ? max[1] : min[1];
+    float z = p[2] >= 0 ? max[2] : min[2];
+    if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0)
+      return 0;
+  }
+  return 1;
+}
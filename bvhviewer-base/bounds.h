@@ -0,0 +1,39 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "bvh.h"
+
+// Caixas alinhadas aos eixos (AABB) das juntas de um clip: uma do clip
+// inteiro e uma por frame, guardada com 16 bits por coordenada relativos
+// a caixa do clip (12 bytes por frame)
+typedef struct ClipBounds {
+  int frames;
+  float min[3], max[3]; // caixa do clip inteiro
+  float step[3];        // unidades por passo de quantizacao em cada eixo
+  unsigned short *boxes; // frames x 6: min x, y, z e max x, y, z
+} ClipBounds;
+
+// Calcula as caixas pela cinematica direta de todos os frames, em blocos
+// paralelos (numThreads <= 0: todas). A caixa quantizada sempre contem a
+// exata (min arredondado para baixo, max para cima)
+ClipBounds *computeClipBounds(const Clip *clip, int numThreads);
+void freeClipBounds(ClipBounds *b);
+
+// Caixa do frame
+void frameBounds(const ClipBounds *b, int frame, float *min, float *max);
+
+// Uniao das caixas dos frames [first, last] (limitados ao clip)
+void rangeBounds(const ClipBounds *b, int first, int last, float *min,
+                 float *max);
+
+// Caixa das posicoes de numNodes matrizes world (16 floats cada)
+void poseBounds(const float *world, int numNodes, float *min, float *max);
+
+// Planos (a, b, c, d, com a normal para dentro) do volume de visao dado
+// pelas matrizes de projecao e de modelo (colunas, como no OpenGL)
+void frustumPlanes(const float *proj, const float *model, float planes[6][4]);
+
+// Zero se a caixa esta inteiramente fora de algum dos planos
+int boxInFrustum(const float planes[6][4], const float *min, const float *max);
+
+#endif
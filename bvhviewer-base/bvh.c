@@ -0,0 +1,896 @@
+// **********************************************************************
+//	bvh.c
+//  Leitura de arquivos BVH (BioVision) e cinematica direta, sem
+//  nenhuma dependencia de OpenGL/GLUT
+// **********************************************************************
+
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "names.h"
+
+#define MAX_LINE_LENGTH 256
+
+int bvhVerbose = 1;
+
+#define LOG(...)                                                               \
+  do {                                                                         \
+    if (bvhVerbose)                                                            \
+      printf(__VA_ARGS__);                                                     \
+  } while (0)
+
+// **********************************************************************
+//  Cria um nodo novo para a hierarquia, fazendo também a ligacao com
+//  o seu pai (se houver)
+//  Parametros:
+//  - names: tabela onde o nome e guardado (sem limite de tamanho)
+//  - name: string com o nome do nodo
+//  - parent: ponteiro para o nodo pai (NULL se for a raiz)
+//  - numChannels: quantidade de canais de transformacao (3 ou 6)
+//  - ofx, ofy, ofz: offset (deslocamento) lido do arquivo
+// **********************************************************************
+Node *createNode(NameTable *names, const char *name, Node *parent,
+                 int numChannels, float ofx, float ofy, float ofz) {
+  Node *aux = malloc(sizeof(Node));
+  aux->channels = numChannels;
+  aux->channelData = calloc(sizeof(float), numChannels);
+  aux->name = internName(names, name);
+  aux->offset[0] = ofx;
+  aux->offset[1] = ofy;
+  aux->offset[2] = ofz;
+  aux->numChildren = 0;
+  aux->children = NULL;
+  aux->parent = parent;
+  aux->next = NULL;
+  aux->index = -1;
+  aux->channelOffset = -1;
+  aux->quatIndex = -1;
+  setChannelOrder(aux, numChannels == 6 ? "xyzZXY" : numChannels == 3 ? "ZXY" : "");
+  aux->dirty = 1;
+  if (parent) {
+    if(parent->children == NULL) {
+      // printf("First child: %s\n", aux->name);
+      parent->children = aux;
+    }
+    else {
+      Node* ptr = parent->children;
+      while(ptr->next != NULL)
+        ptr = ptr->next;
+      // printf("Next child: %s\n", aux->name);
+      ptr->next = aux;
+    }
+    parent->numChildren++;
+  }
+  LOG("Created %s\n", name);
+  return aux;
+}
+
+void freeNode(Node *node) {
+  if (node == NULL)
+    return;
+  Node* ptr = node->children;
+  Node* aux;
+  while(ptr != NULL) {
+    aux = ptr->next;
+    freeNode(ptr);
+    ptr = aux;
+  }
+  free(node->channelData);
+  free(node);
+}
+
+void setChannelOrder(Node *node, const char *order) {
+  int r = 0;
+  snprintf(node->channelOrder, sizeof(node->channelOrder), "%s", order);
+  node->rotationChannel = -1;
+  for (int c = 0; node->channelOrder[c]; c++) {
+    if (node->channelOrder[c] < 'A' || node->channelOrder[c] > 'Z')
+      continue;
+    if (r == 0)
+      node->rotationChannel = c;
+    else if (node->rotationChannel + r != c)
+      node->rotationChannel = -1;
+    if (r < 3)
+      node->rotationOrder[r++] = node->channelOrder[c];
+  }
+  node->rotationOrder[r] = '\0';
+  if (r != 3)
+    node->rotationChannel = -1;
+}
+
+void trimString(char *str) {
+    if (!str) return;
+
+    // Remove espaços do início
+    char *start = str;
+    while (*start && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    if (start != str) {
+        memmove(str, start, strlen(start) + 1);
+    }
+
+    // Remove espaços e quebras de linha do final
+    char *end = str + strlen(str) - 1;
+    while (end > str && (*end == ' ' || *end == '\n' || *end == '\r' || *end == '\t')) {
+        *end = '\0';
+        end--;
+    }
+}
+
+// Le uma linha inteira, aumentando o buffer se preciso (NULL no fim do
+// arquivo)
+static char *readLine(FILE *file, char **line, size_t *cap) {
+    size_t len = 0;
+    while (fgets(*line + len, (int)(*cap - len), file)) {
+        len += strlen(*line + len);
+        if (len > 0 && (*line)[len - 1] == '\n')
+            return *line;
+        if (len + 1 < *cap)
+            return *line; // ultima linha, sem '\n'
+        *cap *= 2;
+        *line = realloc(*line, *cap);
+    }
+    return len ? *line : NULL;
+}
+
+// Nome depois da palavra-chave (ate o primeiro espaco)
+static char *nodeName(char *text) {
+    trimString(text);
+    text[strcspn(text, " \t")] = '\0';
+    return *text ? text : NULL;
+}
+
+static int parseHierarchy(FILE *file, Clip *clip) {
+    size_t cap = MAX_LINE_LENGTH;
+    char *line = malloc(cap);
+    char *name;
+    Node *currentNode = NULL;
+    int lineNumber = 0, ok = 0, invalid = 0;
+    clip->names = createNameTable();
+
+    while (readLine(file, &line, &cap)) {
+        lineNumber++;
+        trimString(line);  // Limpa a linha inteira antes de processá-la
+
+        if (strlen(line) == 0) {
+            continue;  // Pula linhas vazias após o trim
+        }
+
+        LOG("\nProcessando linha %d: '%s'\n", lineNumber, line);
+
+        if (strncmp(line, "ROOT", 4) == 0) {
+            // Pula "ROOT" e limpa espaços extras antes do nome
+            if ((name = nodeName(line + 4)) != NULL) {
+                clip->root = createNode(clip->names, name, NULL, 0, 0, 0, 0);
+                currentNode = clip->root;
+                LOG("ROOT criado: %s\n", name);
+            }
+        }
+        else if (strncmp(line, "JOINT", 5) == 0) {
+            // Pula "JOINT" e limpa espaços extras antes do nome
+            if ((name = nodeName(line + 5)) != NULL) {
+                Node *newNode =
+                    createNode(clip->names, name, currentNode, 0, 0, 0, 0);
+                currentNode = newNode;
+                LOG("JOINT criado: %s (pai: %s)\n", name,
+                    currentNode->parent ? currentNode->parent->name : "NULL");
+            }
+        }
+        else if (strncmp(line, "OFFSET", 6) == 0) {
+            char *offsetValues = line + 6;  // Pula "OFFSET"
+            trimString(offsetValues);       // Limpa espaços extras antes dos valores
+            float x, y, z;
+            if (currentNode && sscanf(offsetValues, "%f %f %f", &x, &y, &z) == 3) {
+                currentNode->offset[0] = x;
+                currentNode->offset[1] = y;
+                currentNode->offset[2] = z;
+                LOG("OFFSET definido para %s: %.2f %.2f %.2f\n",
+                    currentNode->name, x, y, z);
+            }
+        }
+        else if (strncmp(line, "CHANNELS", 8) == 0) {
+            char *channelInfo = line + 8;  // Pula "CHANNELS"
+            trimString(channelInfo);       // Limpa espaços extras antes do número
+            if (currentNode) {
+                int numChannels, n = 0;
+                if (sscanf(channelInfo, "%d%n", &numChannels, &n) == 1) {
+                    // Ordem dos canais: "Xposition" -> 'x', "Zrotation" -> 'Z'
+                    char order[7] = "", token[32];
+                    char *ptr = channelInfo + n;
+                    int names = 0;
+                    for (; sscanf(ptr, "%31s%n", token, &n) == 1; names++) {
+                        ptr += n;
+                        if (names >= 6)
+                            continue; // so conta: a linha sera rejeitada
+                        char axis = token[0];
+                        if (strstr(token, "position"))
+                            axis = axis - 'A' + 'a';
+                        order[names] = axis;
+                        order[names + 1] = '\0';
+                    }
+                    // channelOrder e os leitores de canais supoem no maximo 6
+                    if (numChannels < 0 || numChannels > 6 ||
+                        names != numChannels) {
+                        printf("Erro: linha %d: CHANNELS %d com %d nomes em %s "
+                               "(esperado de 0 a 6, um nome por canal)\n",
+                               lineNumber, numChannels, names,
+                               currentNode->name);
+                        invalid = 1;
+                        break;
+                    }
+                    free(currentNode->channelData);
+                    setChannelOrder(currentNode, order);
+                    currentNode->channels = numChannels;
+                    currentNode->channelData = calloc(numChannels, sizeof(float));
+                    if (currentNode->channelData) {
+                        clip->totalChannels += numChannels;
+                        LOG("CHANNELS configurado para %s: %d\n",
+                            currentNode->name, numChannels);
+                    }
+                }
+            }
+        }
+        else if (strncmp(line, "End Site", 8) == 0) {
+            if (currentNode) {
+                LOG("Processando End Site para nó %s\n", currentNode->name);
+                // Lê a próxima linha que deve ser "{"
+                if (readLine(file, &line, &cap)) {
+                    trimString(line);
+                    if (line[0] == '{') {
+                        // Lê a linha do OFFSET
+                        if (readLine(file, &line, &cap)) {
+                            trimString(line);
+                            float x, y, z;
+                            if (sscanf(line, "OFFSET %f %f %f", &x, &y, &z) == 3) {
+                                createNode(clip->names, "End Site",
+                                           currentNode, 0, x, y, z);
+                            }
+                        }
+                        // Lê o "}" final
+                        if (readLine(file, &line, &cap))
+                            trimString(line);
+                    }
+                }
+            }
+        }
+        else if (strcmp(line, "}") == 0) {
+            if (currentNode && currentNode->parent) {
+                LOG("Voltando do nó %s para o pai %s\n",
+                    currentNode->name,
+                    currentNode->parent->name);
+                currentNode = currentNode->parent;
+            }
+        }
+        else if (strcmp(line, "{") == 0) {
+            LOG("Início de bloco encontrado\n");
+        }
+        else if (strncmp(line, "MOTION", 6) == 0) {
+            LOG("MOTION encontrado - iniciando parsing dos frames\n");
+            LOG("\nParsing da hierarquia concluído. Total de linhas processadas: %d\n", lineNumber);
+            ok = 1;
+            break;
+        }
+        else if (strncmp(line, "HIERARCHY", 9) != 0) {
+            LOG("Aviso: linha não reconhecida: '%s'\n", line);
+        }
+    }
+
+    free(line);
+    if (!ok && !invalid)
+        printf("Erro: secao MOTION nao encontrada\n");
+    return ok;
+}
+
+// Le o restante do arquivo para um buffer terminado em '\0'
+static char *readRemaining(FILE *file, size_t *length) {
+    size_t cap = 1 << 16, len = 0;
+    char *buf = malloc(cap);
+    if (!buf)
+        return NULL;
+    for (;;) {
+        if (cap - len < 4096) {
+            cap *= 2;
+            char *tmp = realloc(buf, cap);
+            if (!tmp) {
+                free(buf);
+                return NULL;
+            }
+            buf = tmp;
+        }
+        size_t n = fread(buf + len, 1, cap - len - 1, file);
+        if (n == 0)
+            break;
+        len += n;
+    }
+    buf[len] = '\0';
+    *length = len;
+    return buf;
+}
+
+size_t parseValues(const char *text, float *out, size_t max) {
+    const char *ptr = text;
+    char *end;
+    size_t read = 0;
+    while (read < max) {
+        float v = strtof(ptr, &end);
+        if (end == ptr)
+            break;
+        out[read++] = v;
+        ptr = end;
+    }
+    return read;
+}
+
+// Le as linhas "Frames:" e "Frame Time:" (clip->totalFrames recebe o total
+// declarado), deixando o arquivo no inicio dos frames
+static int parseMotionHeader(FILE *file, Clip *clip) {
+    char line[1024]; // Buffer para leitura de linhas
+    int totalFrames = 0;
+
+    // Lê a linha com "Frames: X"
+    if (fgets(line, sizeof(line), file)) {
+        trimString(line);
+        if (strncmp(line, "Frames:", 7) == 0) {
+            sscanf(line, "Frames: %d", &totalFrames);
+            LOG("Total de frames: %d\n", totalFrames);
+        } else {
+            printf("Erro: Formato inesperado. Esperado 'Frames:'.\n");
+            return 0;
+        }
+    }
+
+    // Lê a linha "Frame Time: X"
+    if (fgets(line, sizeof(line), file)) {
+        trimString(line);
+        if (strncmp(line, "Frame Time:", 11) != 0) {
+            printf("Erro: Formato inesperado. Esperado 'Frame Time:'.\n");
+            return 0;
+        }
+        sscanf(line, "Frame Time: %f", &clip->frameTime);
+        LOG("Frame Time: %f\n", clip->frameTime);
+    }
+
+    if (totalFrames <= 0 || clip->totalChannels <= 0) {
+        printf("Erro: clip sem frames ou sem canais.\n");
+        return 0;
+    }
+    clip->totalFrames = totalFrames;
+    return 1;
+}
+
+static int parseMotion(FILE *file, Clip *clip) {
+    if (!parseMotionHeader(file, clip))
+        return 0;
+    int totalFrames = clip->totalFrames;
+
+    // Aloca memória para a matriz de dados (um único bloco)
+    size_t numValues = (size_t)totalFrames * clip->totalChannels;
+    clip->motion = malloc(numValues * sizeof(float));
+    clip->data = malloc(totalFrames * sizeof(float *));
+    if (!clip->motion || !clip->data) {
+        printf("Erro: Falha ao alocar memória para a matriz de dados.\n");
+        return 0;
+    }
+
+    // Lê os dados de movimento de uma vez e converte os valores em sequência
+    size_t length;
+    char *text = readRemaining(file, &length);
+    if (!text) {
+        printf("Erro: Falha ao ler os dados de movimento.\n");
+        return 0;
+    }
+    size_t read = parseValues(text, clip->motion, numValues);
+    free(text);
+
+    int framesRead = (int)(read / clip->totalChannels);
+    if (framesRead != totalFrames) {
+        printf("Aviso: Número de frames lidos (%d) não corresponde ao total esperado (%d).\n", framesRead, totalFrames);
+    }
+    if (framesRead == 0)
+        return 0;
+
+    clip->totalFrames = framesRead;
+    for (int i = 0; i < framesRead; i++)
+        clip->data[i] = clip->motion + (size_t)i * clip->totalChannels;
+
+    LOG("Total de canais: %d\n", clip->totalChannels);
+    LOG("Dados de movimento carregados com sucesso.\n");
+    return 1;
+}
+
+static void countNodes(Node *node, int *count) {
+    (*count)++;
+    for (Node *child = node->children; child; child = child->next)
+        countNodes(child, count);
+}
+
+// Mesma ordem de consumo de canais do arquivo (pre-ordem, sem folhas)
+static void indexNode(Clip *clip, Node *node, int *pos, int *channel) {
+    node->index = (*pos)++;
+    clip->nodes[node->index] = node;
+    if (node->numChildren > 0 && node->channels > 0) {
+        node->channelOffset = *channel;
+        *channel += node->channels;
+    } else
+        node->channelOffset = -1;
+    for (Node *child = node->children; child; child = child->next)
+        indexNode(clip, child, pos, channel);
+}
+
+void indexClip(Clip *clip) {
+    int count = 0, pos = 0, channel = 0;
+    countNodes(clip->root, &count);
+    free(clip->nodes);
+    clip->nodes = malloc(count * sizeof(Node *));
+    clip->numNodes = count;
+    indexNode(clip, clip->root, &pos, &channel);
+    if (clip->names)
+        indexNames(clip->names, clip->nodes, count);
+}
+
+Clip *readClip(FILE *file) {
+    if (!file) {
+        printf("Erro: arquivo inválido\n");
+        return NULL;
+    }
+    Clip *clip = calloc(1, sizeof(Clip));
+    if (!parseHierarchy(file, clip) || !clip->root || !parseMotion(file, clip)) {
+        freeClip(clip);
+        return NULL;
+    }
+    indexClip(clip);
+    return clip;
+}
+
+Clip *readClipHeader(FILE *file) {
+    Clip *clip = calloc(1, sizeof(Clip));
+    if (!parseHierarchy(file, clip) || !clip->root ||
+        !parseMotionHeader(file, clip)) {
+        freeClip(clip);
+        return NULL;
+    }
+    indexClip(clip);
+    return clip;
+}
+
+Clip *loadClip(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("Erro: nao foi possivel abrir %s\n", path);
+        return NULL;
+    }
+    Clip *clip = readClip(file);
+    fclose(file);
+    return clip;
+}
+
+void freeClip(Clip *clip) {
+    if (!clip)
+        return;
+    if (!clip->skeleton) {
+        freeNode(clip->root);
+        free(clip->nodes);
+        freeNameTable(clip->names);
+    }
+    free(clip->motion);
+    free(clip->data);
+    free(clip->quats);
+    free(clip->trajectory);
+    free(clip->relative);
+    free(clip);
+}
+
+static void writeNode(FILE *file, const Node *node, int depth) {
+    fprintf(file, "%*s", depth * 2, "");
+    if (node->numChildren == 0) {
+        fprintf(file, "End Site\n%*s{\n%*sOFFSET %g %g %g\n%*s}\n",
+                depth * 2, "", depth * 2 + 2, "", node->offset[0],
+                node->offset[1], node->offset[2], depth * 2, "");
+        return;
+    }
+    fprintf(file, "%s %s\n%*s{\n", node->parent ? "JOINT" : "ROOT", node->name,
+            depth * 2, "");
+    fprintf(file, "%*sOFFSET %g %g %g\n", depth * 2 + 2, "", node->offset[0],
+            node->offset[1], node->offset[2]);
+    if (node->channels > 0) {
+        fprintf(file, "%*sCHANNELS %d", depth * 2 + 2, "", node->channels);
+        for (int c = 0; node->channelOrder[c]; c++) {
+            char axis = node->channelOrder[c];
+            if (axis >= 'a')
+                fprintf(file, " %cposition", axis - 'a' + 'A');
+            else
+                fprintf(file, " %crotation", axis);
+        }
+        fputc('\n', file);
+    }
+    for (const Node *child = node->children; child; child = child->next)
+        writeNode(file, child, depth + 1);
+    fprintf(file, "%*s}\n", depth * 2, "");
+}
+
+int writeClip(FILE *file, const Clip *clip) {
+    fprintf(file, "HIERARCHY\n");
+    writeNode(file, clip->root, 0);
+    fprintf(file, "MOTION\nFrames: %d\nFrame Time: %g\n", clip->totalFrames,
+            clip->frameTime);
+    const float *v = clip->motion;
+    for (int f = 0; f < clip->totalFrames; f++) {
+        for (int c = 0; c < clip->totalChannels; c++)
+            fprintf(file, c ? " %g" : "%g", *v++);
+        fputc('\n', file);
+    }
+    return !ferror(file);
+}
+
+void printHierarchy(Node *node, int depth) {
+    if (!node) return;
+
+    for (int i = 0; i < depth; i++) printf("  "); // Indentação
+    printf("%s (Canais: %d, Filhos: %d)\n", node->name, node->channels, node->numChildren);
+
+    Node *child = node->children;
+    while (child) {
+        printHierarchy(child, depth + 1);
+        child = child->next;
+    }
+}
+
+Node *findNode(Node *node, const char *name) {
+    if (!node)
+        return NULL;
+    if (strcmp(node->name, name) == 0)
+        return node;
+    for (Node *child = node->children; child; child = child->next) {
+        Node *found = findNode(child, name);
+        if (found)
+            return found;
+    }
+    return NULL;
+}
+
+Node *findClipNode(const Clip *clip, const char *name) {
+    if (!clip->names)
+        return findNode(clip->root, name);
+    int index = nameIndex(clip->names, name);
+    return index >= 0 ? clip->nodes[index] : NULL;
+}
+
+static int compareNames(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+char **listBvhFiles(const char *dir, int *count) {
+    *count = 0;
+    DIR *d = opendir(dir);
+    if (!d) {
+        printf("Erro: nao foi possivel abrir o diretorio %s\n", dir);
+        return NULL;
+    }
+    int cap = 64;
+    char **files = malloc(cap * sizeof(char *));
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len < 4 || strcmp(entry->d_name + len - 4, ".bvh") != 0)
+            continue;
+        if (*count == cap) {
+            cap *= 2;
+            files = realloc(files, cap * sizeof(char *));
+        }
+        char *path = malloc(strlen(dir) + len + 2);
+        sprintf(path, "%s/%s", dir, entry->d_name);
+        files[(*count)++] = path;
+    }
+    closedir(d);
+    qsort(files, *count, sizeof(char *), compareNames);
+    return files;
+}
+
+char **collectBvhFiles(int numPaths, char **paths, int *count) {
+    static char *defaultDir[] = {"bvh"};
+    if (numPaths == 0) {
+        numPaths = 1;
+        paths = defaultDir;
+    }
+    int cap = 0;
+    char **files = NULL;
+    *count = 0;
+    for (int i = 0; i < numPaths; i++) {
+        int n = 0;
+        char **found = NULL;
+        DIR *d = opendir(paths[i]);
+        if (d) {
+            closedir(d);
+            found = listBvhFiles(paths[i], &n);
+        } else {
+            found = malloc(sizeof(char *));
+            found[0] = strdup(paths[i]);
+            n = 1;
+        }
+        if (*count + n > cap) {
+            cap = (*count + n) * 2;
+            files = realloc(files, cap * sizeof(char *));
+        }
+        memcpy(files + *count, found, n * sizeof(char *));
+        *count += n;
+        free(found);
+    }
+    return files;
+}
+
+void freeFileList(char **files, int count) {
+    for (int i = 0; i < count; i++)
+        free(files[i]);
+    free(files);
+}
+
+// **********************************************************************
+//  Cinematica direta
+// **********************************************************************
+
+void matMul(const float *a, const float *b, float *out) {
+  float r[16];
+  for (int c = 0; c < 4; c++)
+    for (int l = 0; l < 4; l++)
+      r[c * 4 + l] = a[l] * b[c * 4] + a[4 + l] * b[c * 4 + 1] +
+                     a[8 + l] * b[c * 4 + 2] + a[12 + l] * b[c * 4 + 3];
+  memcpy(out, r, sizeof(r));
+}
+
+// Equivalente a glTranslatef(t) seguido de glRotatef(z, 0,0,1),
+// glRotatef(x, 1,0,0) e glRotatef(y, 0,1,0)
+static void translateRotateZXY(const float *t, float z, float x, float y,
+                               float *out) {
+  const float d2r = (float)(M_PI / 180.0);
+  float cz = cosf(z * d2r), sz = sinf(z * d2r);
+  float cx = cosf(x * d2r), sx = sinf(x * d2r);
+  float cy = cosf(y * d2r), sy = sinf(y * d2r);
+
+  // R = Rz * Rx * Ry (coluna-major)
+  out[0] = cz * cy - sz * sx * sy;
+  out[1] = sz * cy + cz * sx * sy;
+  out[2] = -cx * sy;
+  out[3] = 0;
+  out[4] = -sz * cx;
+  out[5] = cz * cx;
+  out[6] = sx;
+  out[7] = 0;
+  out[8] = cz * sy + sz * sx * cy;
+  out[9] = sz * sy - cz * sx * cy;
+  out[10] = cx * cy;
+  out[11] = 0;
+  out[12] = t[0];
+  out[13] = t[1];
+  out[14] = t[2];
+  out[15] = 1;
+}
+
+// Rotacao de deg graus em torno de um eixo ('X', 'Y' ou 'Z'), 3x3
+static void axisRotation(char axis, float deg, float *r) {
+  const float d2r = (float)(M_PI / 180.0);
+  float c = cosf(deg * d2r), s = sinf(deg * d2r);
+  int a = axis - 'X';
+  int b = (a + 1) % 3, d = (a + 2) % 3;
+  memset(r, 0, 9 * sizeof(float));
+  r[a * 3 + a] = 1;
+  r[b * 3 + b] = c;
+  r[d * 3 + d] = c;
+  r[b * 3 + d] = s;  // coluna b, linha d
+  r[d * 3 + b] = -s; // coluna d, linha b
+}
+
+// Translacao a partir dos canais do nodo (ch = NULL: so o offset)
+static void channelTranslation(const Node *node, const float *ch, float *t) {
+  int hasPosition = 0;
+  float pos[3] = {0, 0, 0};
+  for (int c = 0; ch && node->channelOrder[c]; c++)
+    if (node->channelOrder[c] >= 'x') {
+      pos[node->channelOrder[c] - 'x'] = ch[c];
+      hasPosition = 1;
+    }
+  memcpy(t, hasPosition ? pos : node->offset, sizeof(pos));
+}
+
+void nodeTranslation(const Node *node, const float *frame, float *t) {
+  channelTranslation(node,
+                     node->channelOffset >= 0 ? frame + node->channelOffset : NULL,
+                     t);
+}
+
+// Matriz local a partir dos canais do nodo (ch = NULL: so o offset)
+static void channelMatrix(const Node *node, const float *ch, float *out) {
+  // Casos comuns (os arquivos de bvh/), sem multiplicacoes de matrizes
+  if (ch && node->channels == 6 && strcmp(node->channelOrder, "xyzZXY") == 0)
+    translateRotateZXY(ch, ch[3], ch[4], ch[5], out);
+  else if (ch && node->channels == 3 && strcmp(node->channelOrder, "ZXY") == 0)
+    translateRotateZXY(node->offset, ch[0], ch[1], ch[2], out);
+  else if (!ch)
+    translateRotateZXY(node->offset, 0, 0, 0, out);
+  else {
+    // Ordem qualquer: posicoes substituem o offset e as rotacoes sao
+    // compostas na ordem em que aparecem
+    float t[3], r[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}, a[9], tmp[9];
+    int hasPosition = 0;
+    memcpy(t, node->offset, sizeof(t));
+    for (int c = 0; node->channelOrder[c]; c++) {
+      char axis = node->channelOrder[c];
+      if (axis >= 'x') {
+        if (!hasPosition)
+          t[0] = t[1] = t[2] = 0;
+        hasPosition = 1;
+        t[axis - 'x'] = ch[c];
+        continue;
+      }
+      axisRotation(axis, ch[c], a);
+      for (int col = 0; col < 3; col++)
+        for (int l = 0; l < 3; l++)
+          tmp[col * 3 + l] = r[l] * a[col * 3] + r[3 + l] * a[col * 3 + 1] +
+                             r[6 + l] * a[col * 3 + 2];
+      memcpy(r, tmp, sizeof(r));
+    }
+    for (int col = 0; col < 3; col++) {
+      memcpy(out + col * 4, r + col * 3, 3 * sizeof(float));
+      out[col * 4 + 3] = 0;
+    }
+    memcpy(out + 12, t, sizeof(t));
+    out[15] = 1;
+  }
+}
+
+void quatMatrix(const float *q, const float *t, float *out) {
+  float x = q[0], y = q[1], z = q[2], w = q[3];
+  out[0] = 1 - 2 * (y * y + z * z);
+  out[1] = 2 * (x * y + z * w);
+  out[2] = 2 * (x * z - y * w);
+  out[3] = 0;
+  out[4] = 2 * (x * y - z * w);
+  out[5] = 1 - 2 * (x * x + z * z);
+  out[6] = 2 * (y * z + x * w);
+  out[7] = 0;
+  out[8] = 2 * (x * z + y * w);
+  out[9] = 2 * (y * z - x * w);
+  out[10] = 1 - 2 * (x * x + y * y);
+  out[11] = 0;
+  out[12] = t[0];
+  out[13] = t[1];
+  out[14] = t[2];
+  out[15] = 1;
+}
+
+void localMatrix(const Node *node, const float *frame, float *out) {
+  channelMatrix(node, node->channelOffset >= 0 ? frame + node->channelOffset : NULL,
+                out);
+}
+
+void computeWorld(const Clip *clip, int frame, float *world) {
+  computePose(clip, clip->data[frame], world);
+}
+
+void computePose(const Clip *clip, const float *values, float *world) {
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    float *m = world + i * 16;
+    localMatrix(node, values, m);
+    if (node->parent)
+      matMul(world + node->parent->index * 16, m, m);
+  }
+}
+
+void setChannel(Node *node, int channel, float value) {
+  if (node->channelData[channel] != value) {
+    node->channelData[channel] = value;
+    node->dirty = 1;
+  }
+}
+
+void setQuat(Node *node, const float *q) {
+  if (memcmp(node->quat, q, sizeof(node->quat)) != 0) {
+    memcpy(node->quat, q, sizeof(node->quat));
+    node->dirty = 1;
+  }
+}
+
+static int updateNode(Node *node, const float *parentWorld, int parentChanged) {
+  int count = 0;
+  int changed = node->dirty || parentChanged;
+  if (node->dirty) {
+    if (node->quatIndex >= 0) {
+      float t[3];
+      channelTranslation(node, node->channelData, t);
+      quatMatrix(node->quat, t, node->local);
+    } else
+      channelMatrix(node, node->channels > 0 ? node->channelData : NULL,
+                    node->local);
+    node->dirty = 0;
+  }
+  if (changed) {
+    if (parentWorld)
+      matMul(parentWorld, node->local, node->world);
+    else
+      memcpy(node->world, node->local, sizeof(node->world));
+    count++;
+  }
+  for (Node *child = node->children; child; child = child->next)
+    count += updateNode(child, node->world, changed);
+  return count;
+}
+
+int updatePose(Node *root) {
+  return root ? updateNode(root, NULL, 0) : 0;
+}
+
+int applyFrame(Clip *clip, int frame) {
+  const float *values = clip->data[frame];
+  const float *quats =
+      clip->quats ? clip->quats + (size_t)frame * clip->numRotations * 4 : NULL;
+  for (int i = 0; i < clip->numNodes; i++) {
+    Node *node = clip->nodes[i];
+    if (node->channelOffset < 0)
+      continue;
+    for (int c = 0; c < node->channels; c++)
+      setChannel(node, c, values[node->channelOffset + c]);
+    if (quats && node->quatIndex >= 0)
+      setQuat(node, quats + node->quatIndex * 4);
+  }
+  return updatePose(clip->root);
+}
+
+void rigidInverse(const float *m, float *out) {
+  float r[16];
+  for (int c = 0; c < 3; c++) {
+    for (int l = 0; l < 3; l++)
+      r[c * 4 + l] = m[l * 4 + c];
+    r[c * 4 + 3] = 0;
+  }
+  for (int l = 0; l < 3; l++)
+    r[12 + l] = -(r[l] * m[12] + r[4 + l] * m[13] + r[8 + l] * m[14]);
+  r[15] = 1;
+  memcpy(out, r, sizeof(r));
+}
+
+unsigned long long hashBytes(const void *data, size_t size,
+                             unsigned long long seed) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < size; i++)
+    seed = (seed ^ p[i]) * 0x100000001b3ULL;
+  return seed;
+}
+
+int hashFile(const char *path, unsigned long long *hash) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return 0;
+  unsigned char buffer[65536];
+  size_t n;
+  *hash = HASH_SEED;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    *hash = hashBytes(buffer, n, *hash);
+  int ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+static unsigned long long hashNode(const Node *node, float tolerance,
+                                   unsigned long long hash) {
+  hash = hashBytes(node->name, strlen(node->name) + 1, hash);
+  hash = hashBytes(node->channelOrder, strlen(node->channelOrder) + 1, hash);
+  hash = hashBytes(&node->numChildren, sizeof(int), hash);
+  // Com canais de posicao o offset nao e usado (varia de arquivo para
+  // arquivo na raiz) e fica fora do hash
+  for (int k = 0; k < 3 && !strpbrk(node->channelOrder, "xyz"); k++) {
+    long long q = llroundf(node->offset[k] / tolerance);
+    hash = hashBytes(&q, sizeof(q), hash);
+  }
+  for (const Node *child = node->children; child; child = child->next)
+    hash = hashNode(child, tolerance, hash);
+  return hash;
+}
+
+unsigned long long skeletonHash(const Node *root, float tolerance) {
+  return hashNode(root, tolerance, HASH_SEED);
+}
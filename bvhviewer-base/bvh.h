@@ -0,0 +1,134 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdio.h>
+
+typedef struct Node Node;
+
+struct Node {
+  const char *name;   // nome (guardado na NameTable da hierarquia)
+  float offset[3];    // offset (deslocamento)
+  int channels;       // qtd de canais (3 ou 6)
+  float *channelData; // vetor com os dados dos canais
+  int numChildren;    // qtd de filhos
+  Node *parent;       // ponteiro para o pai
+  Node *children;     // ponteiro para o primeiro filho (ou NULL)
+  Node *next;         // ponteiro para o próximo filho (ou NULL)
+  int index;          // posicao do nodo em Clip.nodes (pre-ordem)
+  int channelOffset;  // primeiro canal do nodo no frame (-1 se nao consome)
+  char channelOrder[7];  // um caractere por canal: x/y/z = posicao,
+                         // X/Y/Z = rotacao (ex.: "xyzZXY")
+  char rotationOrder[4]; // eixos das rotacoes na ordem do arquivo (ex.: "ZXY")
+  int rotationChannel;   // 1o canal de rotacao (-1 se nao forem 3 seguidos)
+  int quatIndex;      // trilha de quaternions do nodo (-1 = usa Euler)
+  float quat[4];      // rotacao atual quando quatIndex >= 0 (x, y, z, w)
+  int dirty;          // channelData mudou desde o ultimo updatePose
+  float local[16];    // transformacao local (cache de updatePose)
+  float world[16];    // transformacao global (cache de updatePose)
+};
+
+// Um arquivo BVH carregado: hierarquia + dados de movimento
+typedef struct Clip {
+  Node *root;         // raiz da hierarquia
+  Node **nodes;       // todos os nodos em pre-ordem (pai antes dos filhos)
+  int numNodes;       // qtd de nodos (inclui os End Site)
+  int totalFrames;    // qtd de frames lidos
+  int totalChannels;  // qtd de canais por frame
+  float frameTime;    // duracao de um frame (segundos)
+  float *motion;      // bloco contiguo totalFrames x totalChannels
+  float **data;       // data[f] aponta para a linha do frame f em motion
+  int numRotations;   // qtd de trilhas de quaternions (buildQuatTracks)
+  float *quats;       // totalFrames x numRotations quaternions (ou NULL)
+  float *trajectory;  // trilhas da raiz, ROOT_TRACKS x totalFrames, e
+  float *relative;    // poses relativas a ela, como motion (buildRootMotion)
+  struct NameTable *names;   // nomes dos nodos e indice nome -> nodo
+  struct Skeleton *skeleton; // hierarquia compartilhada (dono: o
+                             // SkeletonCache) ou NULL se e so do clip
+} Clip;
+
+// Se diferente de zero, o parser descreve o que esta lendo (padrao: 1)
+extern int bvhVerbose;
+
+// O nome e copiado para names (a tabela dos nomes da hierarquia)
+Node *createNode(struct NameTable *names, const char *name, Node *parent,
+                 int numChannels, float ofx, float ofy, float ofz);
+void freeNode(Node *node);
+void trimString(char *str);
+// Define a ordem dos canais do nodo (ex.: "xyzZXY"; ver Node.channelOrder)
+void setChannelOrder(Node *node, const char *order);
+void printHierarchy(Node *node, int depth);
+
+// Carrega um arquivo BVH completo (NULL em caso de erro)
+Clip *loadClip(const char *path);
+Clip *readClip(FILE *file);
+// Le so a hierarquia e as linhas "Frames:"/"Frame Time:" (totalFrames =
+// total declarado, sem motion/data), deixando o arquivo no primeiro frame
+Clip *readClipHeader(FILE *file);
+// Monta Clip.nodes, os deslocamentos de canal e o indice de nomes a partir
+// de clip->root
+void indexClip(Clip *clip);
+void freeClip(Clip *clip);
+// Grava o clip no formato BVH (hierarquia + clip->motion). Retorna 0 se
+// houve erro de escrita
+int writeClip(FILE *file, const Clip *clip);
+// Converte ate max numeros separados por espacos; retorna a qtd lida
+size_t parseValues(const char *text, float *out, size_t max);
+
+// Procura um nodo pelo nome na subarvore (NULL se nao existir)
+Node *findNode(Node *node, const char *name);
+// O mesmo no clip inteiro, pelo hash de clip->names (O(1))
+Node *findClipNode(const Clip *clip, const char *name);
+
+// Lista os arquivos .bvh de um diretorio (ordenados por nome).
+// Devolve um vetor alocado com *count caminhos; liberar com freeFileList
+char **listBvhFiles(const char *dir, int *count);
+// Expande uma lista de caminhos (arquivos ou diretorios) em arquivos .bvh;
+// sem caminhos, usa o diretorio "bvh"
+char **collectBvhFiles(int numPaths, char **paths, int *count);
+void freeFileList(char **files, int count);
+
+// **********************************************************************
+//  Cinematica direta (FK). As matrizes sao 4x4, coluna-major (como a
+//  OpenGL), e reproduzem exatamente as transformacoes de drawNode.
+// **********************************************************************
+
+// out = a * b
+void matMul(const float *a, const float *b, float *out);
+// Matriz local de um nodo a partir dos valores de canal do frame
+void localMatrix(const Node *node, const float *frame, float *out);
+// Matrizes globais de todos os nodos (world tem numNodes * 16 floats)
+void computeWorld(const Clip *clip, int frame, float *world);
+// Idem, a partir de um vetor qualquer de valores de canal
+void computePose(const Clip *clip, const float *values, float *world);
+
+// Translacao local: canais de posicao do frame ou, se nao houver, o offset
+void nodeTranslation(const Node *node, const float *frame, float *t);
+// Matriz de translacao t seguida da rotacao do quaternion q
+void quatMatrix(const float *q, const float *t, float *out);
+
+// Escreve um canal do nodo, marcando-o como sujo se o valor mudou
+void setChannel(Node *node, int channel, float value);
+// Idem para a rotacao em quaternion (nodos com quatIndex >= 0)
+void setQuat(Node *node, const float *q);
+// Recalcula local/world apenas dos nodos sujos e de suas subarvores.
+// Retorna a qtd de nodos recalculados
+int updatePose(Node *root);
+// Escreve nos nodos os canais do frame (e os quaternions, se o clip tiver
+// trilhas) e chama updatePose. Retorna a qtd de nodos recalculados
+int applyFrame(Clip *clip, int frame);
+
+// Inversa de uma matriz rigida (rotacao + translacao)
+void rigidInverse(const float *m, float *out);
+
+// Hash FNV-1a de 64 bits; para encadear, passe o hash anterior como seed
+#define HASH_SEED 0xcbf29ce484222325ULL
+unsigned long long hashBytes(const void *data, size_t size,
+                             unsigned long long seed);
+// Hash do conteudo de um arquivo (0 se nao conseguir le-lo)
+int hashFile(const char *path, unsigned long long *hash);
+// Hash estrutural do esqueleto: nomes, topologia, ordem dos canais e
+// offsets arredondados para multiplos de tolerance (exceto os de nodos com
+// canais de posicao, que sao substituidos pelo movimento)
+unsigned long long skeletonHash(const Node *root, float tolerance);
+
+#endif
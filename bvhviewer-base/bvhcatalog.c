@@ -0,0 +1,158 @@
+// **********************************************************************
+//	bvhcatalog.c
+//  Catalogo da biblioteca BVH: atualiza o indice e responde consultas
+//  sem abrir os clips
+//
+//  Uso: bvhcatalog [-c catalogo] [-j threads] comando ...
+//    update [arquivos ou diretorios...]   relê so os arquivos alterados
+//    list [-k esqueleto] [-n texto] [-f frames]
+//                                         clips filtrados por esqueleto
+//                                         (prefixo do hash), trecho do
+//                                         caminho e minimo de frames
+//    summary                              totais, extremos e esqueletos
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "catalog.h"
+#include "parallel.h"
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Uso: %s [-c catalogo] [-j threads] comando\n"
+          "  update [arquivos ou diretorios...]\n"
+          "  list [-k esqueleto] [-n texto] [-f frames]\n"
+          "  summary\n", prog);
+}
+
+static float duration(const CatalogEntry *e) {
+  return e->frames * e->frameTime;
+}
+
+static int list(const Catalog *cat, int argc, char **argv) {
+  const char *skeleton = NULL, *text = NULL;
+  int minFrames = 0;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+      skeleton = argv[++i];
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      text = argv[++i];
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+      minFrames = atoi(argv[++i]);
+    else
+      return 0;
+  }
+  for (int i = 0; i < cat->count; i++) {
+    const CatalogEntry *e = &cat->entries[i];
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", e->skeleton);
+    if ((skeleton && strncmp(hash, skeleton, strlen(skeleton)) != 0) ||
+        (text && !strstr(e->path, text)) || e->frames < minFrames)
+      continue;
+    printf("%s\t%d frames\t%.2f s\t%s\n", e->path, e->frames, duration(e),
+           hash);
+  }
+  return 1;
+}
+
+typedef struct {
+  unsigned long long hash;
+  int clips, joints, channels;
+  const char *example;
+} SkeletonCount;
+
+static void summary(const Catalog *cat) {
+  long long frames = 0;
+  double seconds = 0;
+  const CatalogEntry *longest = NULL, *shortest = NULL;
+  SkeletonCount *skeletons = calloc(cat->count, sizeof(SkeletonCount));
+  int numSkeletons = 0;
+
+  for (int i = 0; i < cat->count; i++) {
+    const CatalogEntry *e = &cat->entries[i];
+    frames += e->frames;
+    seconds += duration(e);
+    if (!longest || duration(e) > duration(longest))
+      longest = e;
+    if (!shortest || duration(e) < duration(shortest))
+      shortest = e;
+    int s = 0;
+    while (s < numSkeletons && skeletons[s].hash != e->skeleton)
+      s++;
+    if (s == numSkeletons) {
+      skeletons[s].hash = e->skeleton;
+      skeletons[s].joints = e->joints;
+      skeletons[s].channels = e->channels;
+      skeletons[s].example = e->path;
+      numSkeletons++;
+    }
+    skeletons[s].clips++;
+  }
+
+  printf("%d clips, %lld frames, %.1f s\n", cat->count, frames, seconds);
+  if (longest) {
+    printf("mais longo: %s (%d frames, %.2f s)\n", longest->path,
+           longest->frames, duration(longest));
+    printf("mais curto: %s (%d frames, %.2f s)\n", shortest->path,
+           shortest->frames, duration(shortest));
+  }
+  printf("%d esqueletos:\n", numSkeletons);
+  for (int s = 0; s < numSkeletons; s++)
+    printf("  %016llx\t%d clips\t%d juntas\t%d canais\tex.: %s\n",
+           skeletons[s].hash, skeletons[s].clips, skeletons[s].joints,
+           skeletons[s].channels, skeletons[s].example);
+  free(skeletons);
+}
+
+int main(int argc, char **argv) {
+  const char *catalogPath = "bvhcatalog.txt";
+  int threads = 0, first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-c") == 0 && first + 1 < argc)
+      catalogPath = argv[++first];
+    else if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+    first++;
+  }
+  if (first >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *command = argv[first++];
+  Catalog *cat = loadCatalog(catalogPath);
+  if (!cat)
+    return 1;
+
+  int ok = 1;
+  if (strcmp(command, "update") == 0) {
+    bvhVerbose = 0;
+    int count;
+    char **files = collectBvhFiles(argc - first, argv + first, &count);
+    double start = nowSeconds();
+    int scanned = updateCatalog(cat, files, count, threads);
+    double elapsed = nowSeconds() - start;
+    ok = saveCatalog(cat, catalogPath);
+    fprintf(stderr, "%d clips no catalogo, %d relidos em %.3f s\n", cat->count,
+            scanned, elapsed);
+    freeFileList(files, count);
+  } else if (strcmp(command, "list") == 0) {
+    ok = list(cat, argc - first, argv + first);
+    if (!ok)
+      usage(argv[0]);
+  } else if (strcmp(command, "summary") == 0)
+    summary(cat);
+  else {
+    usage(argv[0]);
+    ok = 0;
+  }
+  freeCatalog(cat);
+  return ok ? 0 : 1;
+}
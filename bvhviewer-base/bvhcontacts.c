@@ -0,0 +1,103 @@
+// **********************************************************************
+//	bvhcontacts.c
+//  Rotula os contatos dos pes de todos os clips de uma biblioteca BVH,
+//  processando os arquivos em paralelo
+//
+//  Uso: bvhcontacts [-j threads] [-o saida] [arquivos ou diretorios...]
+//  Cada linha da saida: caminho <TAB> frames <TAB> runs "qtd:mascara"
+//  (mascara: 1 = LFoot, 2 = LToe, 4 = RFoot, 8 = RToe)
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "contact.h"
+#include "parallel.h"
+#include "skeleton.h"
+
+typedef struct {
+  char **files;
+  SkeletonCache *skeletons; // hierarquias compartilhadas entre os clips
+  ContactParams params;
+  unsigned char **labels; // trilha de cada clip (NULL se falhou)
+  int *frames;
+} ContactJob;
+
+static void labelClip(int i, int thread, void *ctx) {
+  ContactJob *job = ctx;
+  Clip *clip = loadSharedClip(job->skeletons, job->files[i]);
+  if (!clip)
+    return;
+  unsigned char *labels = malloc(clip->totalFrames);
+  if (detectContacts(clip, &job->params, labels) > 0) {
+    job->labels[i] = labels;
+    job->frames[i] = clip->totalFrames;
+  } else {
+    fprintf(stderr, "Aviso: %s nao tem juntas de pe conhecidas\n",
+            job->files[i]);
+    free(labels);
+  }
+  freeClip(clip);
+}
+
+int main(int argc, char **argv) {
+  int threads = 0;
+  const char *outPath = NULL;
+  int first = 1;
+  ContactJob job;
+  defaultContactParams(&job.params);
+
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-o") == 0 && first + 1 < argc)
+      outPath = argv[++first];
+    else {
+      fprintf(stderr, "Uso: %s [-j threads] [-o saida] [arquivos ou "
+                      "diretorios...]\n", argv[0]);
+      return 1;
+    }
+    first++;
+  }
+
+  bvhVerbose = 0;
+  int count;
+  job.files = collectBvhFiles(argc - first, argv + first, &count);
+  job.labels = calloc(count, sizeof(unsigned char *));
+  job.frames = calloc(count, sizeof(int));
+  job.skeletons = createSkeletonCache(SKELETON_TOLERANCE);
+
+  double start = nowSeconds();
+  parallelFor(count, threads, labelClip, &job);
+  double elapsed = nowSeconds() - start;
+
+  FILE *out = outPath ? fopen(outPath, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "Erro: nao foi possivel criar %s\n", outPath);
+    return 1;
+  }
+  int labeled = 0, totalFrames = 0;
+  for (int i = 0; i < count; i++) {
+    if (!job.labels[i])
+      continue;
+    fprintf(out, "%s\t%d\t", job.files[i], job.frames[i]);
+    writeContactTrack(out, job.labels[i], job.frames[i]);
+    fputc('\n', out);
+    labeled++;
+    totalFrames += job.frames[i];
+    free(job.labels[i]);
+  }
+  if (out != stdout)
+    fclose(out);
+
+  fprintf(stderr, "%d/%d clips, %d frames rotulados em %.3f s (%d esqueletos)\n",
+          labeled, count, totalFrames, elapsed, skeletonCount(job.skeletons));
+
+  free(job.labels);
+  free(job.frames);
+  freeSkeletonCache(job.skeletons);
+  freeFileList(job.files, count);
+  return 0;
+}
@@ -0,0 +1,287 @@
+// **********************************************************************
+//	bvhcrowd.c
+//  Multidao de personagens (copias dos clips dados, em grade) para medir
+//  a selecao por raio e a deteccao de colisoes: pose e capsulas de todos,
+//  refit da hierarquia, raios aleatorios e colisoes a cada frame
+//
+//  Uso: bvhcrowd [-n personagens] [-f frames] [-r raios por frame]
+//                [-s espacamento] [-j threads] [-c] [-i] [-o contatos]
+//                [arquivos ou diretorios...]
+//  -i  personagens no lugar: usa as poses relativas a raiz, e cada um fica
+//      na sua celula da grade, virado para +Z
+//  -c  detecta as colisoes entre ossos (entre personagens e no mesmo)
+//  -o  grava os contatos de cada frame: frame, personagem:junta de cada
+//      osso (a junta que o gira) e profundidade
+// **********************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "capsule.h"
+#include "collide.h"
+#include "parallel.h"
+#include "pick.h"
+#include "rootmotion.h"
+#include "skeleton.h"
+
+// Distancia padrao entre personagens vizinhos na grade
+#define CROWD_SPACING 150.0f
+
+typedef struct {
+  Clip **clips;
+  int numClips;
+  int characters;
+  int frame;
+  int inPlace;      // poses relativas a raiz (buildRootMotion)
+  RestContacts **rest; // pares em contato no repouso de cada clip
+  int *clipOf;      // clip de cada personagem
+  int *firstCapsule; // primeira capsula de cada personagem
+  float *origins;   // posicao de cada personagem na grade
+  float **world;    // pose de cada thread
+  Capsule *capsules;
+} Crowd;
+
+static void poseCharacter(int c, int thread, void *ctx) {
+  Crowd *crowd = ctx;
+  const Clip *clip = crowd->clips[crowd->clipOf[c]];
+  // Cada personagem comeca num frame diferente do clip
+  int frame = (crowd->frame + c * 7) % clip->totalFrames;
+  if (crowd->inPlace)
+    computePose(clip, relativeFrame(clip, frame), crowd->world[thread]);
+  else
+    computeWorld(clip, frame, crowd->world[thread]);
+  buildCapsules(clip, crowd->world[thread], crowd->origins + c * 3,
+                BONE_RADIUS, c, crowd->rest[crowd->clipOf[c]],
+                crowd->capsules + crowd->firstCapsule[c]);
+}
+
+static float randomRange(float lo, float hi) {
+  return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+int main(int argc, char **argv) {
+  int characters = 200, frames = 100, rays = 1000, threads = 0;
+  int collide = 0, inPlace = 0;
+  float spacing = CROWD_SPACING;
+  const char *outPath = NULL;
+  int first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-n") == 0 && first + 1 < argc)
+      characters = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-f") == 0 && first + 1 < argc)
+      frames = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-r") == 0 && first + 1 < argc)
+      rays = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-s") == 0 && first + 1 < argc)
+      spacing = atof(argv[++first]);
+    else if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-c") == 0)
+      collide = 1;
+    else if (strcmp(argv[first], "-i") == 0)
+      inPlace = 1;
+    else if (strcmp(argv[first], "-o") == 0 && first + 1 < argc) {
+      outPath = argv[++first];
+      collide = 1;
+    } else {
+      fprintf(stderr, "Uso: %s [-n personagens] [-f frames] [-r raios] "
+                      "[-s espacamento] [-j threads] [-c] [-i] [-o contatos] "
+                      "[arquivos ou diretorios...]\n", argv[0]);
+      return 1;
+    }
+    first++;
+  }
+  if (characters < 1 || frames < 1) {
+    fprintf(stderr, "Erro: -n e -f devem ser positivos\n");
+    return 1;
+  }
+  if (threads <= 0)
+    threads = defaultThreads();
+
+  bvhVerbose = 0;
+  int count;
+  char **files = collectBvhFiles(argc - first, argv + first, &count);
+  Crowd crowd = {0};
+  // Clips com o mesmo esqueleto dividem a hierarquia e a pose de repouso
+  SkeletonCache *skeletons = createSkeletonCache(SKELETON_TOLERANCE);
+  crowd.clips = malloc((count > 0 ? count : 1) * sizeof(Clip *));
+  for (int i = 0; i < count; i++)
+    if ((crowd.clips[crowd.numClips] = loadSharedClip(skeletons, files[i])))
+      crowd.numClips++;
+  freeFileList(files, count);
+  if (!crowd.numClips) {
+    fprintf(stderr, "Nenhum clip carregado\n");
+    return 1;
+  }
+
+  // Personagens numa grade quadrada em torno da origem
+  crowd.characters = characters;
+  crowd.inPlace = inPlace;
+  if (inPlace)
+    for (int i = 0; i < crowd.numClips; i++)
+      buildRootMotion(crowd.clips[i], threads);
+  crowd.rest = calloc(crowd.numClips, sizeof(RestContacts *));
+  for (int i = 0; i < crowd.numClips; i++) {
+    for (int j = 0; j < i && !crowd.rest[i]; j++)
+      if (crowd.clips[j]->skeleton == crowd.clips[i]->skeleton)
+        crowd.rest[i] = crowd.rest[j];
+    if (!crowd.rest[i])
+      crowd.rest[i] = findRestContacts(crowd.clips[i], BONE_RADIUS);
+  }
+  crowd.clipOf = malloc(characters * sizeof(int));
+  crowd.firstCapsule = malloc(characters * sizeof(int));
+  crowd.origins = malloc(characters * 3 * sizeof(float));
+  int side = (int)ceil(sqrt(characters)), numCapsules = 0, maxNodes = 0;
+  for (int c = 0; c < characters; c++) {
+    crowd.clipOf[c] = c % crowd.numClips;
+    crowd.firstCapsule[c] = numCapsules;
+    const Clip *clip = crowd.clips[crowd.clipOf[c]];
+    numCapsules += countCapsules(clip);
+    if (clip->numNodes > maxNodes)
+      maxNodes = clip->numNodes;
+    // A raiz dos clips nao fica na origem: desconta a posicao inicial
+    // (as poses relativas ja estao na origem)
+    float start[3] = {0, 0, 0};
+    if (!inPlace)
+      nodeTranslation(clip->root, clip->data[0], start);
+    crowd.origins[c * 3] = (c % side - side / 2) * spacing - start[0];
+    crowd.origins[c * 3 + 1] = 0;
+    crowd.origins[c * 3 + 2] = (c / side - side / 2) * spacing - start[2];
+  }
+  crowd.capsules = malloc(numCapsules * sizeof(Capsule));
+  crowd.world = malloc(threads * sizeof(float *));
+  for (int t = 0; t < threads; t++)
+    crowd.world[t] = malloc(maxNodes * 16 * sizeof(float));
+
+  parallelFor(characters, threads, poseCharacter, &crowd);
+  BoneBvh *bvh = createBoneBvh(crowd.capsules, numCapsules);
+
+  double poseTime = 0, refitTime = 0, rayTime = 0;
+  long hits = 0, mismatches = 0, checked = 0;
+  int rebuilds = 0;
+  float extent = side * spacing * 0.5f;
+
+  FILE *out = NULL;
+  if (outPath && !(out = fopen(outPath, "w"))) {
+    fprintf(stderr, "Erro: nao foi possivel criar %s\n", outPath);
+    return 1;
+  }
+  CollisionWorld *collision = collide ? createCollisionWorld(threads) : NULL;
+  CollideParams collideParams;
+  defaultCollideParams(&collideParams);
+  double collideTime = 0;
+  long contacts = 0, selfContacts = 0;
+  srand(1);
+  for (int f = 0; f < frames; f++) {
+    crowd.frame = f;
+    double start = nowSeconds();
+    parallelFor(characters, threads, poseCharacter, &crowd);
+    poseTime += nowSeconds() - start;
+
+    start = nowSeconds();
+    rebuilds += refitBoneBvh(bvh);
+    refitTime += nowSeconds() - start;
+
+    if (collision) {
+      const Contact *found;
+      start = nowSeconds();
+      int n = detectCollisions(collision, crowd.capsules, numCapsules,
+                               &collideParams, &found);
+      collideTime += nowSeconds() - start;
+      contacts += n;
+      for (int k = 0; k < n; k++) {
+        const Capsule *a = &crowd.capsules[found[k].a];
+        const Capsule *b = &crowd.capsules[found[k].b];
+        selfContacts += a->owner == b->owner;
+        if (out) {
+          const Clip *ca = crowd.clips[crowd.clipOf[a->owner]];
+          const Clip *cb = crowd.clips[crowd.clipOf[b->owner]];
+          fprintf(out, "%d\t%d:%s\t%d:%s\t%.3f\n", f, a->owner,
+                  ca->nodes[a->parent]->name, b->owner,
+                  cb->nodes[b->parent]->name, found[k].depth);
+        }
+      }
+      // Confere o primeiro frame com o teste de todos os pares
+      if (f == 0) {
+        Contact *expected;
+        int m = detectCollisionsBrute(crowd.capsules, numCapsules,
+                                      &collideParams, &expected);
+        int same = m == n;
+        for (int k = 0; k < m && same; k++)
+          same = expected[k].a == found[k].a && expected[k].b == found[k].b;
+        if (!same) {
+          fprintf(stderr, "Erro: %d contatos pelo hash, %d testando todos os "
+                          "pares\n", n, m);
+          mismatches++;
+        }
+        free(expected);
+      }
+    }
+
+    // Raios de uma camera elevada para pontos aleatorios da multidao
+    for (int r = 0; r < rays; r++) {
+      float origin[3] = {randomRange(-extent, extent), 300,
+                         -extent - 300};
+      float target[3] = {randomRange(-extent, extent), randomRange(0, 180),
+                         randomRange(-extent, extent)};
+      float dir[3] = {target[0] - origin[0], target[1] - origin[1],
+                      target[2] - origin[2]};
+      PickHit hit, check;
+      start = nowSeconds();
+      int found = pickRay(bvh, origin, dir, &hit);
+      rayTime += nowSeconds() - start;
+      hits += found;
+      // Confere uma parte dos raios com o teste de todas as capsulas
+      if (r % 50 == 0) {
+        int expected = pickRayBrute(crowd.capsules, numCapsules, origin, dir,
+                                    &check);
+        checked++;
+        if (found != expected ||
+            (found && fabsf(hit.t - check.t) > 1e-3f * check.t))
+          mismatches++;
+      }
+    }
+  }
+
+  printf("%d personagens, %d capsulas, %d frames, %d raios por frame\n",
+         characters, numCapsules, frames, rays);
+  printf("pose + capsulas: %.3f ms/frame\n", poseTime * 1000 / frames);
+  printf("refit:           %.3f ms/frame (%d remontagens)\n",
+         refitTime * 1000 / frames, rebuilds);
+  printf("raio:            %.3f us (%.1f%% acertos, %ld/%ld divergencias)\n",
+         rays ? rayTime * 1e6 / ((double)rays * frames) : 0.0,
+         rays ? 100.0 * hits / ((double)rays * frames) : 0.0, mismatches,
+         checked);
+
+  if (collision)
+    printf("colisoes:        %.3f ms/frame (%.1f contatos/frame, %.1f no "
+           "mesmo personagem)\n", collideTime * 1000 / frames,
+           (double)contacts / frames, (double)selfContacts / frames);
+  if (out)
+    fclose(out);
+
+  freeCollisionWorld(collision);
+  freeBoneBvh(bvh);
+  for (int t = 0; t < threads; t++)
+    free(crowd.world[t]);
+  free(crowd.world);
+  free(crowd.capsules);
+  free(crowd.origins);
+  free(crowd.firstCapsule);
+  free(crowd.clipOf);
+  for (int i = 0; i < crowd.numClips; i++) {
+    int shared = 0;
+    for (int j = i + 1; j < crowd.numClips; j++)
+      shared |= crowd.rest[j] == crowd.rest[i];
+    if (!shared)
+      freeRestContacts(crowd.rest[i]);
+    freeClip(crowd.clips[i]);
+  }
+  freeSkeletonCache(skeletons);
+  free(crowd.rest);
+  free(crowd.clips);
+  return mismatches ? 1 : 0;
+}
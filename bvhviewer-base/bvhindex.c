@@ -0,0 +1,78 @@
+// **********************************************************************
+//	bvhindex.c
+//  Acesso aleatorio aos frames de um arquivo BVH pelo indice de frames
+//  (criado na primeira vez ao lado do arquivo)
+//
+//  Uso: bvhindex [-j threads] arquivo [frame | inicio:fim]
+//  Sem frame, so cria/valida o indice. Os valores dos frames pedidos vao
+//  para a saida padrao, uma linha por frame; as medicoes, para stderr
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "frameindex.h"
+#include "parallel.h"
+
+int main(int argc, char **argv) {
+  int threads = 0;
+  int first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else
+      break;
+    first++;
+  }
+  if (first >= argc || argv[first][0] == '-' || argc - first > 2) {
+    fprintf(stderr, "Uso: %s [-j threads] arquivo [frame | inicio:fim]\n",
+            argv[0]);
+    return 1;
+  }
+
+  bvhVerbose = 0;
+  double start = nowSeconds();
+  FrameIndex *index = openFrameIndex(argv[first]);
+  if (!index)
+    return 1;
+  double opened = nowSeconds() - start;
+  fprintf(stderr, "%d frames, %zu bytes; indice %s em %.3f ms\n",
+          index->frames, index->size,
+          index->fromSidecar ? "lido" : "construido", opened * 1000);
+
+  int status = 0;
+  if (first + 1 < argc) {
+    int from, to;
+    const char *range = argv[first + 1];
+    if (strchr(range, ':')) {
+      if (sscanf(range, "%d:%d", &from, &to) != 2)
+        to = from - 1;
+    } else
+      from = to = atoi(range);
+    if (from < 0 || to < from || to >= index->frames) {
+      fprintf(stderr, "Erro: frames validos: 0 a %d\n", index->frames - 1);
+      closeFrameIndex(index);
+      return 1;
+    }
+
+    int count = to - from + 1, channels = index->clip->totalChannels;
+    float *values = malloc((size_t)count * channels * sizeof(float));
+    start = nowSeconds();
+    int decoded = decodeFrames(index, from, count, values, threads);
+    double elapsed = nowSeconds() - start;
+    fprintf(stderr, "%d/%d frames decodificados em %.3f ms\n", decoded, count,
+            elapsed * 1000);
+    for (int f = 0; f < count; f++) {
+      const float *v = values + (size_t)f * channels;
+      for (int c = 0; c < channels; c++)
+        printf(c ? " %g" : "%g", v[c]);
+      putchar('\n');
+    }
+    free(values);
+    status = decoded == count ? 0 : 1;
+  }
+  closeFrameIndex(index);
+  return status;
+}
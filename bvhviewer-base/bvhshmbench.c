@@ -0,0 +1,170 @@
+// **********************************************************************
+//	bvhshmbench.c
+//  Mede a vazao da pose em memoria compartilhada: um escritor publica
+//  os frames de um clip (FK + publishPose) enquanto processos leitores
+//  leem pelo seqlock de poseshm.h, conferindo se nenhuma leitura saiu
+//  misturada entre dois frames
+//
+//  Uso: bvhshmbench [-r leitores] [-t segundos] [-z] [arquivo.bvh]
+//  -r  processos leitores (padrao 2)
+//  -t  duracao (padrao 2 s)
+//  -z  leitores sem copia: so a posicao da raiz, direto do mapeamento
+// **********************************************************************
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bvh.h"
+#include "parallel.h"
+#include "posepub.h"
+
+#define MAX_READERS 64
+
+// Resultados dos leitores e sinal de parada (memoria anonima compartilhada
+// com os processos filhos)
+typedef struct {
+  atomic_int start, stop;
+  struct {
+    long reads, retries, torn;
+  } reader[MAX_READERS];
+} Shared;
+
+// Confere a copia contra os valores do frame que ela diz ser
+static int consistent(const Clip *clip, const PoseShmPose *pose) {
+  if (pose->frame < 0 || pose->frame >= clip->totalFrames ||
+      pose->numChannels != clip->totalChannels)
+    return 0;
+  return memcmp(pose->channels, clip->data[pose->frame],
+                clip->totalChannels * sizeof(float)) == 0;
+}
+
+static void readerLoop(const char *name, const Clip *clip, Shared *shared,
+                       int id, int zeroCopy) {
+  const PoseShm *s = poseShmOpen(name);
+  if (!s)
+    exit(1);
+  PoseShmPose *pose = malloc(sizeof(PoseShmPose));
+  long reads = 0, retries = 0, torn = 0;
+  while (!atomic_load(&shared->start))
+    ;
+  while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+    if (zeroCopy) {
+      // Posicao da raiz e canal 0 lidos direto do segmento: a raiz com
+      // canais de posicao tem world[0][12] == canal 0 (Xposition)
+      uint32_t seq;
+      float x, c0;
+      int frame;
+      do {
+        seq = poseShmBegin(s);
+        x = s->pose.world[0][12];
+        c0 = s->pose.channels[0];
+        frame = s->pose.frame;
+        retries++;
+      } while (poseShmRetry(s, seq));
+      retries--;
+      if (frame >= 0 && frame < clip->totalFrames &&
+          (x != c0 || c0 != clip->data[frame][0]))
+        torn++;
+    } else {
+      retries += poseShmRead(s, pose) - 1;
+      if (!consistent(clip, pose))
+        torn++;
+    }
+    reads++;
+  }
+  shared->reader[id].reads = reads;
+  shared->reader[id].retries = retries;
+  shared->reader[id].torn = torn;
+  free(pose);
+  poseShmClose(s);
+  exit(0);
+}
+
+int main(int argc, char **argv) {
+  int readers = 2, zeroCopy = 0, first = 1;
+  double seconds = 2;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-r") == 0 && first + 1 < argc)
+      readers = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-t") == 0 && first + 1 < argc)
+      seconds = atof(argv[++first]);
+    else if (strcmp(argv[first], "-z") == 0)
+      zeroCopy = 1;
+    else {
+      fprintf(stderr, "Uso: %s [-r leitores] [-t segundos] [-z] "
+                      "[arquivo.bvh]\n", argv[0]);
+      return 1;
+    }
+    first++;
+  }
+  if (readers < 0)
+    readers = 0;
+  if (readers > MAX_READERS)
+    readers = MAX_READERS;
+
+  bvhVerbose = 0;
+  Clip *clip = loadClip(first < argc ? argv[first] : "bvh/Male2_B3_Walk.bvh");
+  if (!clip)
+    return 1;
+
+  char name[64];
+  snprintf(name, sizeof(name), "/bvhshmbench-%d", (int)getpid());
+  PosePublisher *pub = createPosePublisher(name);
+  if (!pub)
+    return 1;
+  applyFrame(clip, 0);
+  publishPose(pub, clip, 0);
+
+  Shared *shared = mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  memset(shared, 0, sizeof(Shared));
+  for (int i = 0; i < readers; i++)
+    if (fork() == 0)
+      readerLoop(name, clip, shared, i, zeroCopy);
+
+  // Escritor: frames em sequencia, o mais rapido possivel
+  long published = 0;
+  double publishTime = 0;
+  atomic_store(&shared->start, 1);
+  double start = nowSeconds(), end = start + seconds;
+  for (int f = 0; nowSeconds() < end; f = (f + 1) % clip->totalFrames) {
+    applyFrame(clip, f);
+    double t = nowSeconds();
+    publishPose(pub, clip, f);
+    publishTime += nowSeconds() - t;
+    published++;
+  }
+  double elapsed = nowSeconds() - start;
+  atomic_store(&shared->stop, 1);
+  for (int i = 0; i < readers; i++)
+    wait(NULL);
+
+  printf("%s: %d nodos, %d canais, %d leitor(es)%s, %d processador(es)\n",
+         first < argc ? argv[first] : "bvh/Male2_B3_Walk.bvh", clip->numNodes,
+         clip->totalChannels, readers, zeroCopy ? " sem copia" : "",
+         defaultThreads());
+  printf("escritor: %.0f publicacoes/s (publishPose: %.2f us cada)\n",
+         published / elapsed, publishTime * 1e6 / published);
+  long total = 0, torn = 0;
+  for (int i = 0; i < readers; i++) {
+    long reads = shared->reader[i].reads;
+    printf("leitor %d: %.0f leituras/s, %.2f%% repetidas, %ld inconsistentes\n",
+           i, reads / elapsed,
+           reads ? shared->reader[i].retries * 100.0 / reads : 0.0,
+           shared->reader[i].torn);
+    total += reads;
+    torn += shared->reader[i].torn;
+  }
+  if (readers)
+    printf("total: %.0f leituras/s\n", total / elapsed);
+
+  munmap(shared, sizeof(Shared));
+  freePosePublisher(pub);
+  freeClip(clip);
+  return torn ? 1 : 0;
+}
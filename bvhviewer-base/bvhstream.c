@@ -0,0 +1,113 @@
+// **********************************************************************
+//	bvhstream.c
+//  Reproduz clips BVH como poses ao vivo (substituto do software de
+//  captura): manda a hierarquia e depois um datagrama por frame, no ritmo
+//  do Frame Time, para o viewer iniciado com -l
+//
+//  Uso: bvhstream [-x velocidade] [-r] endereco [arquivos ou diretorios...]
+//  endereco: porta UDP, host:porta ou caminho de socket Unix
+//  -x  multiplica a taxa de frames (padrao 1)
+//  -r  repete a lista de clips ate ser interrompido
+// **********************************************************************
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bvh.h"
+#include "parallel.h"
+#include "stream.h"
+
+// A hierarquia e reenviada periodicamente para viewers abertos depois
+#define HIERARCHY_REPEAT_S 1.0
+
+// Dorme ate o instante t (segundos de nowSeconds)
+static void sleepUntil(double t) {
+  struct timespec ts;
+  ts.tv_sec = (time_t)t;
+  ts.tv_nsec = (long)((t - ts.tv_sec) * 1e9);
+  // Repete so se interrompido por um sinal; outro erro (ex.: EINVAL) nao
+  // se resolveria tentando de novo
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+int main(int argc, char **argv) {
+  float speed = 1;
+  int repeat = 0, first = 1;
+
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-x") == 0 && first + 1 < argc)
+      speed = atof(argv[++first]);
+    else if (strcmp(argv[first], "-r") == 0)
+      repeat = 1;
+    else
+      break;
+    first++;
+  }
+  if (first >= argc || argv[first][0] == '-' || speed <= 0) {
+    fprintf(stderr, "Uso: %s [-x velocidade] [-r] endereco "
+                    "[arquivos ou diretorios...]\n", argv[0]);
+    return 1;
+  }
+
+  int fd = openStreamSocket(argv[first], 0);
+  if (fd < 0)
+    return 1;
+  bvhVerbose = 0;
+  int count;
+  char **files = collectBvhFiles(argc - first - 1, argv + first + 1, &count);
+
+  uint32_t sequence = 0;
+  long sent = 0, failed = 0;
+  double start = nowSeconds();
+  do {
+    for (int i = 0; i < count; i++) {
+      Clip *clip = loadClip(files[i]);
+      if (!clip)
+        continue;
+      size_t length;
+      uint32_t id;
+      char *text = hierarchyPacketText(clip, &length, &id);
+      if (!text || !sendHierarchy(fd, text, length, id, sequence++)) {
+        // Sem receptor o UDP conectado devolve ECONNREFUSED: segue em frente
+        failed++;
+      }
+      printf("%s: %d frames a %.1f fps\n", files[i], clip->totalFrames,
+             speed / clip->frameTime);
+      fflush(stdout);
+
+      double step = clip->frameTime / speed;
+      double next = nowSeconds(), lastHierarchy = next;
+      for (int f = 0; f < clip->totalFrames; f++) {
+        sleepUntil(next);
+        if (next - lastHierarchy >= HIERARCHY_REPEAT_S) {
+          if (text)
+            sendHierarchy(fd, text, length, id, sequence++);
+          lastHierarchy = next;
+        }
+        if (sendFrame(fd, clip, f, id, sequence++))
+          sent++;
+        else
+          failed++;
+        next += step;
+        // Atrasou mais de um frame (maquina ocupada): nao tenta compensar
+        double now = nowSeconds();
+        if (now > next + step)
+          next = now;
+      }
+      free(text);
+      freeClip(clip);
+    }
+  } while (repeat && count > 0);
+
+  double elapsed = nowSeconds() - start;
+  fprintf(stderr, "%ld frames enviados em %.1f s (%.1f/s), %ld falhas\n",
+          sent, elapsed, elapsed > 0 ? sent / elapsed : 0.0, failed);
+  freeFileList(files, count);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,228 @@
+// **********************************************************************
+//	bvhthumbs.c
+//  Gera uma folha de contato (PNG) por clip, com quadros igualmente
+//  espacados, desenhando varios clips em paralelo (um contexto por thread)
+//
+//  Uso: bvhthumbs [-j threads] [-n quadros] [-s pixels] [-c colunas]
+//                 [-o diretorio] [-f] [arquivos ou diretorios...]
+//  As folhas vao para o diretorio (padrao "thumbs"), junto com o indice
+//  thumbs.idx (hash do arquivo <TAB> imagem <TAB> caminho). Clips cujo hash
+//  nao mudou nao sao redesenhados; -f forca todos. As entradas de clips
+//  que nao foram processados nesta execucao sao mantidas no indice.
+// **********************************************************************
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bvh.h"
+#include "image.h"
+#include "parallel.h"
+#include "thumb.h"
+
+#define MAX_THREADS 64
+
+typedef struct {
+  char **files;
+  int count;
+  const char *outDir;
+  ThumbOptions opt;
+  int force;
+  int width, height;
+  ThumbContext *contexts[MAX_THREADS]; // criados sob demanda por thread
+  // Indice anterior
+  int numCached;
+  unsigned long long *cachedHash;
+  char **cachedName;
+  char **cachedPath;
+  // Resultado de cada clip
+  unsigned long long *hash;
+  char **name;
+  int *status; // 0 = falhou, 1 = desenhado, 2 = ja estava em cache
+} ThumbJob;
+
+// Nome da imagem: nome do arquivo sem diretorio, seguido do hash do
+// caminho absoluto (clips de mesmo nome em diretorios diferentes nao
+// dividem a imagem) e de .png
+static char *imageName(const char *path) {
+  char full[PATH_MAX];
+  if (!realpath(path, full))
+    snprintf(full, sizeof(full), "%s", path);
+  unsigned long long hash = hashBytes(full, strlen(full), HASH_SEED);
+
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  const char *dot = strrchr(base, '.');
+  int length = dot ? (int)(dot - base) : (int)strlen(base);
+  char *name = malloc(length + 14);
+  sprintf(name, "%.*s-%08x.png", length, base, (unsigned)(hash ^ hash >> 32));
+  return name;
+}
+
+static void readIndex(ThumbJob *job) {
+  char path[1024], line[2048];
+  snprintf(path, sizeof(path), "%s/thumbs.idx", job->outDir);
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return;
+  int cap = 0;
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long long hash;
+    char name[1024], clipPath[1024] = "";
+    if (sscanf(line, "%llx\t%1023[^\t\n]\t%1023[^\n]", &hash, name,
+               clipPath) < 2)
+      continue;
+    if (job->numCached == cap) {
+      cap = cap ? cap * 2 : 256;
+      job->cachedHash = realloc(job->cachedHash, cap * sizeof(*job->cachedHash));
+      job->cachedName = realloc(job->cachedName, cap * sizeof(char *));
+      job->cachedPath = realloc(job->cachedPath, cap * sizeof(char *));
+    }
+    job->cachedHash[job->numCached] = hash;
+    job->cachedName[job->numCached] = strdup(name);
+    job->cachedPath[job->numCached++] = strdup(clipPath);
+  }
+  fclose(file);
+}
+
+static int isCached(const ThumbJob *job, int i) {
+  char path[1024];
+  struct stat st;
+  snprintf(path, sizeof(path), "%s/%s", job->outDir, job->name[i]);
+  if (job->force || stat(path, &st) != 0)
+    return 0;
+  for (int c = 0; c < job->numCached; c++)
+    if (strcmp(job->cachedName[c], job->name[i]) == 0)
+      return job->cachedHash[c] == job->hash[i];
+  return 0;
+}
+
+static void renderFile(int i, int thread, void *ctx) {
+  ThumbJob *job = ctx;
+  job->name[i] = imageName(job->files[i]);
+  if (!hashFile(job->files[i], &job->hash[i]))
+    return;
+  // As opcoes de desenho entram no hash: mudar -n/-s/-c invalida o cache
+  job->hash[i] = hashBytes(&job->opt, sizeof(job->opt), job->hash[i]);
+  if (isCached(job, i)) {
+    job->status[i] = 2;
+    return;
+  }
+
+  if (!job->contexts[thread])
+    job->contexts[thread] = createThumbContext(job->width, job->height);
+  Clip *clip = job->contexts[thread] ? loadClip(job->files[i]) : NULL;
+  if (!clip)
+    return;
+  unsigned char *rgb = malloc((size_t)job->width * job->height * 3);
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", job->outDir, job->name[i]);
+  if (renderContactSheet(job->contexts[thread], clip, &job->opt, rgb) &&
+      writePng(path, job->width, job->height, rgb))
+    job->status[i] = 1;
+  free(rgb);
+  freeClip(clip);
+}
+
+int main(int argc, char **argv) {
+  ThumbJob job = {0};
+  defaultThumbOptions(&job.opt);
+  job.outDir = "thumbs";
+  int threads = 0, first = 1;
+
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-n") == 0 && first + 1 < argc)
+      job.opt.frames = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-s") == 0 && first + 1 < argc)
+      job.opt.tileSize = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-c") == 0 && first + 1 < argc)
+      job.opt.columns = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-o") == 0 && first + 1 < argc)
+      job.outDir = argv[++first];
+    else if (strcmp(argv[first], "-f") == 0)
+      job.force = 1;
+    else {
+      fprintf(stderr, "Uso: %s [-j threads] [-n quadros] [-s pixels] "
+                      "[-c colunas] [-o diretorio] [-f] "
+                      "[arquivos ou diretorios...]\n", argv[0]);
+      return 1;
+    }
+    first++;
+  }
+  if (job.opt.frames < 1 || job.opt.tileSize < 1 || job.opt.columns < 1) {
+    fprintf(stderr, "Erro: -n, -s e -c devem ser positivos\n");
+    return 1;
+  }
+  if (threads <= 0)
+    threads = defaultThreads();
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+
+  bvhVerbose = 0;
+  mkdir(job.outDir, 0755);
+  readIndex(&job);
+  sheetSize(&job.opt, &job.width, &job.height);
+  job.files = collectBvhFiles(argc - first, argv + first, &job.count);
+  job.hash = calloc(job.count, sizeof(*job.hash));
+  job.name = calloc(job.count, sizeof(char *));
+  job.status = calloc(job.count, sizeof(int));
+
+  double start = nowSeconds();
+  parallelFor(job.count, threads, renderFile, &job);
+  double elapsed = nowSeconds() - start;
+
+  // Novo indice: as entradas anteriores de clips que nao foram processados
+  // agora e os clips desta execucao que tem imagem valida. E gravado num
+  // arquivo temporario e renomeado, para nunca ficar pela metade
+  char path[1024], temp[1040];
+  snprintf(path, sizeof(path), "%s/thumbs.idx", job.outDir);
+  snprintf(temp, sizeof(temp), "%s.tmp", path);
+  FILE *index = fopen(temp, "w");
+  if (!index) {
+    fprintf(stderr, "Erro: nao foi possivel criar %s\n", temp);
+    return 1;
+  }
+  for (int c = 0; c < job.numCached; c++) {
+    int processed = 0;
+    for (int i = 0; i < job.count && !processed; i++)
+      processed = job.name[i] && strcmp(job.name[i], job.cachedName[c]) == 0;
+    if (!processed)
+      fprintf(index, "%016llx\t%s\t%s\n", job.cachedHash[c],
+              job.cachedName[c], job.cachedPath[c]);
+  }
+  int rendered = 0, cached = 0;
+  for (int i = 0; i < job.count; i++) {
+    if (job.status[i])
+      fprintf(index, "%016llx\t%s\t%s\n", job.hash[i], job.name[i],
+              job.files[i]);
+    rendered += job.status[i] == 1;
+    cached += job.status[i] == 2;
+  }
+  if (fclose(index) != 0 || rename(temp, path) != 0) {
+    fprintf(stderr, "Erro: nao foi possivel gravar %s\n", path);
+    return 1;
+  }
+  for (int i = 0; i < job.count; i++)
+    free(job.name[i]);
+  fprintf(stderr, "%d clips desenhados, %d em cache, %d com erro em %.3f s\n",
+          rendered, cached, job.count - rendered - cached, elapsed);
+
+  for (int t = 0; t < MAX_THREADS; t++)
+    freeThumbContext(job.contexts[t]);
+  for (int c = 0; c < job.numCached; c++) {
+    free(job.cachedName[c]);
+    free(job.cachedPath[c]);
+  }
+  free(job.cachedName);
+  free(job.cachedPath);
+  free(job.cachedHash);
+  free(job.hash);
+  free(job.name);
+  free(job.status);
+  freeFileList(job.files, job.count);
+  return rendered + cached == job.count ? 0 : 1;
+}
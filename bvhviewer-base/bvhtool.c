@@ -0,0 +1,545 @@
+// **********************************************************************
+//	bvhtool.c
+//  Ferramenta de linha de comando sem OpenGL/GLUT: so usa a biblioteca
+//  bvhcore (parser, FK e analises), para rodar em maquinas sem display
+//
+//  Uso: bvhtool info [-j threads] [arquivos ou diretorios...]
+//       bvhtool validate [-j threads] [arquivos ou diretorios...]
+//       bvhtool convert [-s escala] entrada.bvh saida.bvh|.glb|.csv
+//       bvhtool stats [-j threads] [-w leitura,parser,analise] [-m]
+//                     [-f csv|json] [arquivos ou diretorios...]
+//       bvhtool bench [-n repeticoes] [-k vertices] [-j threads]
+//                     [arquivos ou diretorios...]
+//  Sem arquivos, usa o diretorio "bvh"
+// **********************************************************************
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "bvh.h"
+#include "gltf.h"
+#include "names.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "quat.h"
+#include "skeleton.h"
+#include "skin.h"
+#include "stats.h"
+
+static const char *program;
+
+static void usage() {
+  fprintf(stderr,
+          "Uso: %s info [-j threads] [arquivos ou diretorios...]\n"
+          "     %s validate [-j threads] [arquivos ou diretorios...]\n"
+          "     %s convert [-s escala] entrada.bvh saida.bvh|.glb|.csv\n"
+          "     %s stats [-j threads] [-w leitura,parser,analise] [-m]\n"
+          "                [-f csv|json] [arquivos ou diretorios...]\n"
+          "     %s bench [-n repeticoes] [-k vertices] [-j threads]\n"
+          "                [arquivos ou diretorios...]\n",
+          program, program, program, program, program);
+}
+
+static int hasSuffix(const char *s, const char *suffix) {
+  size_t n = strlen(s), m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+// Uma linha de texto por arquivo, montada em paralelo e impressa em ordem
+typedef struct {
+  char **files;
+  char **lines;
+  int *failed;
+} FileJob;
+
+static void runFiles(FileJob *job, int count, int threads, ParallelFn fn) {
+  job->lines = calloc(count, sizeof(char *));
+  job->failed = calloc(count, sizeof(int));
+  parallelFor(count, threads, fn, job);
+}
+
+// Imprime as linhas e libera o trabalho; retorna a qtd de falhas
+static int finishFiles(FileJob *job, int count) {
+  int failed = 0;
+  for (int i = 0; i < count; i++) {
+    if (job->lines[i])
+      fputs(job->lines[i], stdout);
+    free(job->lines[i]);
+    failed += job->failed[i];
+  }
+  free(job->lines);
+  free(job->failed);
+  freeFileList(job->files, count);
+  return failed;
+}
+
+// **********************************************************************
+//  info
+// **********************************************************************
+
+static void infoFile(int i, int thread, void *ctx) {
+  FileJob *job = ctx;
+  Clip *clip = loadClip(job->files[i]);
+  char line[1024];
+  if (!clip) {
+    snprintf(line, sizeof(line), "%s: erro de leitura\n", job->files[i]);
+    job->failed[i] = 1;
+  } else {
+    int endSites = 0;
+    for (int n = 0; n < clip->numNodes; n++)
+      endSites += clip->nodes[n]->numChildren == 0;
+    snprintf(line, sizeof(line),
+             "%s: %d juntas + %d End Site, %d canais, %d frames a %.1f fps "
+             "(%.2f s), esqueleto %016llx\n",
+             job->files[i], clip->numNodes - endSites, endSites,
+             clip->totalChannels, clip->totalFrames, 1.0f / clip->frameTime,
+             clip->totalFrames * clip->frameTime,
+             skeletonHash(clip->root, SKELETON_TOLERANCE));
+    freeClip(clip);
+  }
+  job->lines[i] = strdup(line);
+}
+
+// **********************************************************************
+//  validate
+// **********************************************************************
+
+// Acrescenta um problema a lista do arquivo
+static void report(char **text, const char *file, const char *fmt, ...) {
+  char msg[512];
+  int n = snprintf(msg, sizeof(msg), "%s: ", file);
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(msg + n, sizeof(msg) - n, fmt, args);
+  va_end(args);
+  size_t old = *text ? strlen(*text) : 0;
+  *text = realloc(*text, old + strlen(msg) + 2);
+  strcpy(*text + old, msg);
+  strcat(*text, "\n");
+}
+
+static void validateFile(int i, int thread, void *ctx) {
+  FileJob *job = ctx;
+  const char *path = job->files[i];
+  char **out = &job->lines[i];
+
+  // Frames declarados no cabecalho (o loader guarda so os lidos)
+  FILE *file = fopen(path, "rb");
+  Clip *header = file ? readClipHeader(file) : NULL;
+  if (file)
+    fclose(file);
+  Clip *clip = header ? loadClip(path) : NULL;
+  if (!clip) {
+    report(out, path, "erro: arquivo ilegivel ou hierarquia invalida");
+    job->failed[i] = 1;
+    freeClip(header);
+    return;
+  }
+
+  int errors = 0;
+  if (clip->totalFrames != header->totalFrames) {
+    report(out, path, "erro: %d frames declarados, %d lidos",
+           header->totalFrames, clip->totalFrames);
+    errors++;
+  }
+  if (!(clip->frameTime > 0)) {
+    report(out, path, "erro: Frame Time invalido (%g)", clip->frameTime);
+    errors++;
+  }
+
+  // Canais: rotacoes em 3 canais seguidos; nomes repetidos
+  for (int n = 0; n < clip->numNodes; n++) {
+    const Node *node = clip->nodes[n];
+    if (node->channelOffset >= 0 && node->rotationChannel < 0 &&
+        strpbrk(node->channelOrder, "XYZ")) {
+      report(out, path, "aviso: rotacoes de %s fora de sequencia",
+             node->name);
+    }
+    // O indice de nomes aponta para a primeira junta com o nome
+    if (node->numChildren > 0 && nameIndex(clip->names, node->name) != n) {
+      report(out, path, "erro: nome de junta repetido: %s", node->name);
+      errors++;
+    }
+  }
+
+  // Valores nao finitos (NaN, inf) no movimento
+  size_t numValues = (size_t)clip->totalFrames * clip->totalChannels;
+  long nonFinite = 0;
+  for (size_t v = 0; v < numValues; v++)
+    nonFinite += !isfinite(clip->motion[v]);
+  if (nonFinite) {
+    report(out, path, "erro: %ld valores nao finitos", nonFinite);
+    errors++;
+  }
+
+  if (!*out)
+    report(out, path, "ok (%d frames, %d canais)", clip->totalFrames,
+           clip->totalChannels);
+  job->failed[i] = errors > 0;
+  freeClip(header);
+  freeClip(clip);
+}
+
+// **********************************************************************
+//  convert
+// **********************************************************************
+
+// CSV com a posicao global de cada nodo por frame
+static int writePositionsCsv(FILE *file, const Clip *clip) {
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  fprintf(file, "frame");
+  for (int n = 0; n < clip->numNodes; n++) {
+    const Node *node = clip->nodes[n];
+    const char *name = node->numChildren ? node->name : node->parent->name;
+    const char *suffix = node->numChildren ? "" : "_end";
+    fprintf(file, ",%s%s_x,%s%s_y,%s%s_z", name, suffix, name, suffix, name,
+            suffix);
+  }
+  fputc('\n', file);
+  for (int f = 0; f < clip->totalFrames; f++) {
+    computeWorld(clip, f, world);
+    fprintf(file, "%d", f);
+    for (int n = 0; n < clip->numNodes; n++)
+      fprintf(file, ",%g,%g,%g", world[n * 16 + 12], world[n * 16 + 13],
+              world[n * 16 + 14]);
+    fputc('\n', file);
+  }
+  free(world);
+  return !ferror(file);
+}
+
+static int convertCommand(int argc, char **argv) {
+  GltfOptions opt;
+  defaultGltfOptions(&opt);
+  int first = 0;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-s") == 0 && first + 1 < argc)
+      opt.scale = atof(argv[++first]);
+    else {
+      usage();
+      return 1;
+    }
+    first++;
+  }
+  if (argc - first != 2) {
+    usage();
+    return 1;
+  }
+  const char *in = argv[first], *out = argv[first + 1];
+  Clip *clip = loadClip(in);
+  if (!clip)
+    return 1;
+
+  int ok;
+  if (hasSuffix(out, ".glb")) {
+    const char *base = strrchr(in, '/');
+    char name[256];
+    snprintf(name, sizeof(name), "%s", base ? base + 1 : in);
+    char *dot = strrchr(name, '.');
+    if (dot)
+      *dot = '\0';
+    ok = exportGlb(clip, name, out, &opt);
+  } else if (hasSuffix(out, ".bvh") || hasSuffix(out, ".csv")) {
+    FILE *file = fopen(out, "w");
+    ok = file != NULL;
+    if (file) {
+      ok = hasSuffix(out, ".bvh") ? writeClip(file, clip)
+                                  : writePositionsCsv(file, clip);
+      ok = fclose(file) == 0 && ok;
+    }
+  } else {
+    fprintf(stderr, "Erro: formato de saida desconhecido: %s\n", out);
+    freeClip(clip);
+    return 1;
+  }
+  if (!ok)
+    fprintf(stderr, "Erro: nao foi possivel gravar %s\n", out);
+  else
+    fprintf(stderr, "%s -> %s (%d frames)\n", in, out, clip->totalFrames);
+  freeClip(clip);
+  return ok ? 0 : 1;
+}
+
+// **********************************************************************
+//  stats
+// **********************************************************************
+
+// Pipeline: leitura do arquivo -> parser -> analise -> saida em ordem.
+// A leitura do disco de um arquivo se sobrepoe a analise dos anteriores e
+// cada estagio tem a sua qtd de threads
+#define STATS_QUEUE 8
+
+typedef struct {
+  const char *path;
+  char *text; // conteudo do arquivo (estagio de leitura)
+  size_t size;
+  Clip *clip;
+  ClipStats *stats;
+} StatsItem;
+
+typedef struct {
+  StatsParams params;
+  int json, analyzed;
+} StatsJob;
+
+static void *readStage(void *item, int worker, void *ctx) {
+  StatsItem *it = item;
+  FILE *file = fopen(it->path, "rb");
+  // Erros vao para stderr: stdout tem o relatorio CSV/JSON
+  if (!file) {
+    fprintf(stderr, "Erro: nao foi possivel abrir %s\n", it->path);
+    return it;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  it->text = malloc(size > 0 ? size : 1);
+  it->size = size > 0 ? fread(it->text, 1, size, file) : 0;
+  fclose(file);
+  return it;
+}
+
+static void *parseStage(void *item, int worker, void *ctx) {
+  StatsItem *it = item;
+  FILE *file = it->size ? fmemopen(it->text, it->size, "rb") : NULL;
+  if (file) {
+    it->clip = readClip(file);
+    fclose(file);
+  }
+  free(it->text);
+  it->text = NULL;
+  return it;
+}
+
+static void *analyzeStage(void *item, int worker, void *ctx) {
+  StatsJob *job = ctx;
+  StatsItem *it = item;
+  if (it->clip)
+    it->stats = computeClipStats(it->clip, &job->params);
+  freeClip(it->clip);
+  it->clip = NULL;
+  return it;
+}
+
+static void *writeStage(void *item, int worker, void *ctx) {
+  StatsJob *job = ctx;
+  StatsItem *it = item;
+  if (it->stats) {
+    if (job->json)
+      writeStatsJson(stdout, it->path, it->stats, job->analyzed == 0);
+    else
+      writeStatsCsv(stdout, it->path, it->stats);
+    job->analyzed++;
+    freeClipStats(it->stats);
+  }
+  free(it);
+  return NULL;
+}
+
+// Le "a,b,c" em ate n inteiros
+static void parseWorkers(const char *text, int *workers, int n) {
+  for (int i = 0; i < n && *text; i++) {
+    workers[i] = atoi(text);
+    const char *comma = strchr(text, ',');
+    if (!comma)
+      break;
+    text = comma + 1;
+  }
+}
+
+static int statsCommand(int argc, char **argv) {
+  int first = 0, metrics = 0;
+  int workers[3] = {1, 0, 0}; // leitura, parser, analise (0 = todas)
+  StatsJob job = {.json = 0, .analyzed = 0};
+  defaultStatsParams(&job.params);
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      workers[1] = workers[2] = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-w") == 0 && first + 1 < argc)
+      parseWorkers(argv[++first], workers, 3);
+    else if (strcmp(argv[first], "-f") == 0 && first + 1 < argc &&
+             (strcmp(argv[first + 1], "csv") == 0 ||
+              strcmp(argv[first + 1], "json") == 0))
+      job.json = strcmp(argv[++first], "json") == 0;
+    else if (strcmp(argv[first], "-m") == 0)
+      metrics = 1;
+    else {
+      usage();
+      return 1;
+    }
+    first++;
+  }
+  int count;
+  char **files = collectBvhFiles(argc - first, argv + first, &count);
+
+  if (job.json)
+    printf("[");
+  else
+    writeStatsCsvHeader(stdout);
+  PipelineStage stages[] = {
+      {"leitura", readStage, &job, workers[0], 0},
+      {"parser", parseStage, &job, workers[1], 0},
+      {"analise", analyzeStage, &job, workers[2], 0},
+      {"saida", writeStage, &job, 1, 1},
+  };
+  Pipeline *pipe = startPipeline(stages, 4, STATS_QUEUE);
+  for (int i = 0; i < count; i++) {
+    StatsItem *it = calloc(1, sizeof(StatsItem));
+    it->path = files[i];
+    pipelineSubmit(pipe, it);
+  }
+  finishPipeline(pipe);
+  if (job.json)
+    printf("]\n");
+  if (metrics)
+    printPipelineStats(pipe, stderr);
+  freePipeline(pipe);
+  freeFileList(files, count);
+  return job.analyzed == count ? 0 : 1;
+}
+
+// **********************************************************************
+//  bench: carga, FK por Euler e por quaternions (com a conferencia entre
+//  as duas), memoria e, com -k, skinning de uma malha sintetica
+//  (createTestMesh) com -j threads
+// **********************************************************************
+
+static int benchCommand(int argc, char **argv) {
+  int repeat = 3, first = 0, skinVertices = 0, threads = 0;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-n") == 0 && first + 1 < argc)
+      repeat = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-k") == 0 && first + 1 < argc)
+      skinVertices = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else {
+      usage();
+      return 1;
+    }
+    first++;
+  }
+  int count;
+  char **files = collectBvhFiles(argc - first, argv + first, &count);
+  double loadTime = 0, eulerTime = 0, quatTime = 0, convertTime = 0;
+  double skinTime = 0;
+  long frames = 0, poses = 0, skinned = 0, meshVertices = 0;
+  float maxError = 0;
+  for (int i = 0; i < count; i++) {
+    double start = nowSeconds();
+    Clip *clip = loadClip(files[i]);
+    loadTime += nowSeconds() - start;
+    if (!clip)
+      continue;
+    frames += clip->totalFrames;
+    float *world = malloc(clip->numNodes * 16 * sizeof(float));
+    float *check = malloc(clip->numNodes * 16 * sizeof(float));
+
+    start = nowSeconds();
+    for (int r = 0; r < repeat; r++)
+      for (int f = 0; f < clip->totalFrames; f++)
+        computeWorld(clip, f, world);
+    eulerTime += nowSeconds() - start;
+
+    start = nowSeconds();
+    buildQuatTracks(clip, 1);
+    convertTime += nowSeconds() - start;
+    start = nowSeconds();
+    for (int r = 0; r < repeat; r++)
+      for (int f = 0; f < clip->totalFrames; f++)
+        computePoseQuat(clip, clip->data[f], frameQuats(clip, f), world);
+    quatTime += nowSeconds() - start;
+    poses += (long)repeat * clip->totalFrames;
+
+    // As duas formas devem dar a mesma pose (confere o ultimo frame)
+    computeWorld(clip, clip->totalFrames - 1, check);
+    for (int k = 0; k < clip->numNodes * 16; k++)
+      maxError = fmaxf(maxError, fabsf(world[k] - check[k]));
+
+    if (skinVertices > 0) {
+      SkinnedMesh *mesh = createTestMesh(clip, skinVertices);
+      skinMesh(mesh, clip, 0, threads); // cria as threads fora da medicao
+      start = nowSeconds();
+      for (int r = 0; r < repeat; r++)
+        for (int f = 0; f < clip->totalFrames; f++) {
+          mesh->frame = -1;
+          skinMesh(mesh, clip, f, threads);
+        }
+      skinTime += nowSeconds() - start;
+      skinned += (long)repeat * clip->totalFrames;
+      meshVertices = mesh->numVertices;
+      freeSkinnedMesh(mesh);
+    }
+    free(world);
+    free(check);
+    freeClip(clip);
+  }
+  freeFileList(files, count);
+  if (!poses) {
+    fprintf(stderr, "Nenhum clip carregado\n");
+    return 1;
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("%d clips, %ld frames\n", count, frames);
+  printf("carga:      %.3f s (%.0f frames/s)\n", loadTime, frames / loadTime);
+  printf("FK euler:   %.3f us/pose\n", eulerTime * 1e6 / poses);
+  printf("FK quat:    %.3f us/pose (+ %.3f s de conversao na carga, "
+         "diferenca maxima %g)\n",
+         quatTime * 1e6 / poses, convertTime, maxError);
+  if (skinned)
+    printf("skinning:   %.3f ms/frame (%ld vertices, %d threads)\n",
+           skinTime * 1e3 / skinned, meshVertices,
+           threads > 0 ? threads : defaultThreads());
+  printf("memoria:    %ld KB de pico\n", usage.ru_maxrss);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  program = argv[0];
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+  bvhVerbose = 0;
+  const char *command = argv[1];
+  argc -= 2;
+  argv += 2;
+
+  if (strcmp(command, "convert") == 0)
+    return convertCommand(argc, argv);
+  if (strcmp(command, "stats") == 0)
+    return statsCommand(argc, argv);
+  if (strcmp(command, "bench") == 0)
+    return benchCommand(argc, argv);
+
+  ParallelFn fn = strcmp(command, "info") == 0       ? infoFile
+                  : strcmp(command, "validate") == 0 ? validateFile
+                                                     : NULL;
+  if (!fn) {
+    usage();
+    return 1;
+  }
+  int threads = 0, first = 0;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else {
+      usage();
+      return 1;
+    }
+    first++;
+  }
+  FileJob job;
+  int count;
+  job.files = collectBvhFiles(argc - first, argv + first, &count);
+  runFiles(&job, count, threads, fn);
+  int failed = finishFiles(&job, count);
+  if (fn == validateFile)
+    fprintf(stderr, "%d/%d arquivos validos\n", count - failed, count);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,38 @@
+// **********************************************************************
+//	capsule.c
+//  Capsulas dos ossos a partir das matrizes globais de uma pose
+// **********************************************************************
+
+#include "capsule.h"
+
+int countCapsules(const Clip *clip) {
+  return clip->numNodes > 0 ? clip->numNodes - 1 : 0;
+}
+
+int buildCapsules(const Clip *clip, const float *world, const float *origin,
+                  float radius, int owner, const struct RestContacts *rest,
+                  Capsule *out) {
+  static const float zero[3] = {0, 0, 0};
+  if (!origin)
+    origin = zero;
+  int count = 0;
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    if (!node->parent)
+      continue;
+    Capsule *c = &out[count++];
+    const float *pa = world + node->parent->index * 16 + 12;
+    const float *pb = world + i * 16 + 12;
+    for (int k = 0; k < 3; k++) {
+      c->a[k] = pa[k] + origin[k];
+      c->b[k] = pb[k] + origin[k];
+    }
+    c->radius = radius;
+    c->owner = owner;
+    c->node = i;
+    c->parent = node->parent->index;
+    c->grandparent = node->parent->parent ? node->parent->parent->index : -1;
+    c->rest = rest;
+  }
+  return count;
+}
@@ -0,0 +1,28 @@
+#ifndef CAPSULE_H
+#define CAPSULE_H
+
+#include "bvh.h"
+
+// Raio das capsulas dos ossos (o mesmo dos cilindros de renderBone)
+#define BONE_RADIUS 3.0f
+
+// Um osso como capsula: segmento do pai (a) ao nodo (b) e raio
+typedef struct {
+  float a[3], b[3];
+  float radius;
+  int owner; // personagem a que o osso pertence
+  int node;  // nodo filho; a junta que gira o osso e nodes[node]->parent
+  int parent, grandparent; // indices dos nodos acima (-1 se nao houver)
+  const struct RestContacts *rest; // pares ja em contato no repouso ou NULL
+} Capsule;
+
+// Qtd de capsulas de um clip (uma por nodo com pai)
+int countCapsules(const Clip *clip);
+// Capsulas da pose world (numNodes x 16, como computePose) deslocada por
+// origin (NULL = sem deslocamento). rest (findRestContacts, pode ser NULL)
+// vai para cada capsula. Retorna a qtd escrita em out
+int buildCapsules(const Clip *clip, const float *world, const float *origin,
+                  float radius, int owner, const struct RestContacts *rest,
+                  Capsule *out);
+
+#endif
@@ -0,0 +1,393 @@
+// **********************************************************************
+//	capture.c
+//  Gravacao de video da janela: leitura assincrona por um anel de pixel
+//  buffer objects e codificacao (Y4M ou PNG) numa thread separada
+// **********************************************************************
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Funcoes de buffer object declaradas pelo glext.h
+#ifndef WIN32
+#define GL_GLEXT_PROTOTYPES
+#endif
+
+#ifdef WIN32
+#include <direct.h>
+#include <windows.h>
+#define mkdir(path, mode) _mkdir(path)
+#endif
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include "capture.h"
+#include "image.h"
+#include "parallel.h"
+#include "queue.h"
+
+struct Capture {
+  int format;
+  int width, height;
+  int rowBytes;        // width * 4 (RGBA)
+  char *path;
+  FILE *file;          // video Y4M
+
+  GLuint pbos[CAPTURE_PBOS];
+  int next;            // proximo PBO a receber uma leitura
+  int pending;         // leituras em andamento (as mais antigas primeiro)
+
+  // Quadros RGBA (linha 0 = base da janela) que circulam entre a thread
+  // da GLUT e a codificadora: livres -> cheios -> livres
+  unsigned char *slots[CAPTURE_SLOTS];
+  SpscQueue freeSlots, fullSlots;
+  atomic_int stopping;
+  pthread_t encoder;
+  int writeError;
+
+  // Estatisticas
+  long captured, dropped, encoded;
+  double readTime;     // tempo gasto na thread da GLUT
+  double encodeTime;   // tempo gasto na codificadora
+  unsigned char *planes; // rascunho: Y4M (Y, U, V) ou PNG (RGB)
+};
+
+// **********************************************************************
+//  Codificacao
+// **********************************************************************
+
+// RGBA de baixo para cima -> YUV 4:2:0 de cima para baixo, faixa completa
+// (BT.601 com os coeficientes do JPEG, como indica C420jpeg). Cada bloco
+// 2x2 gera 4 amostras de Y e uma de U e de V, da media das 4 cores. Pesos
+// em ponto fixo (x 16384), iguais no caminho SSE2 e no escalar.
+#define Y_R 4899
+#define Y_G 9617
+#define Y_B 1868
+#define U_R -2765
+#define U_G -5427
+#define U_B 8192
+#define V_R 8192
+#define V_G -6860
+#define V_B -1332
+
+static unsigned char clampByte(int v) {
+  return (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// Blocos 2x2 das colunas [x, w) de um par de linhas
+static void yuvBlocks(const unsigned char *row0, const unsigned char *row1,
+                      int x, int w, unsigned char *y0, unsigned char *y1,
+                      unsigned char *u, unsigned char *v) {
+  for (; x < w; x += 2) {
+    const unsigned char *p[4] = {row0 + x * 4, row0 + x * 4 + 4,
+                                 row1 + x * 4, row1 + x * 4 + 4};
+    int r = 0, g = 0, b = 0;
+    for (int k = 0; k < 4; k++) {
+      int luma = (Y_R * p[k][0] + Y_G * p[k][1] + Y_B * p[k][2] + 8192) >> 14;
+      (k < 2 ? y0 : y1)[x + (k & 1)] = clampByte(luma);
+      r += p[k][0];
+      g += p[k][1];
+      b += p[k][2];
+    }
+    // Somas de 4 amostras: o >> 16 tambem divide por 4
+    u[x / 2] = clampByte((U_R * r + U_G * g + U_B * b + (128 << 16) + 32768) >>
+                         16);
+    v[x / 2] = clampByte((V_R * r + V_G * g + V_B * b + (128 << 16) + 32768) >>
+                         16);
+  }
+}
+
+#ifdef __SSE2__
+// Soma os pares de inteiros vizinhos de a e de b: (a0+a1, a2+a3, b0+b1, b2+b3)
+static __m128i pairSums(__m128i a, __m128i b) {
+  __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+                              _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+// Y de 4 pixels RGBA (16 bits por canal, 2 pixels em cada registrador)
+static int luma4(__m128i lo, __m128i hi, __m128i weights) {
+  __m128i sum = pairSums(_mm_madd_epi16(lo, weights),
+                         _mm_madd_epi16(hi, weights));
+  sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(8192)), 14);
+  sum = _mm_packs_epi32(sum, sum);
+  return _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+}
+#endif
+
+static void rgbaToYuv(const Capture *c, const unsigned char *rgba,
+                      unsigned char *out) {
+  int w = c->width, h = c->height;
+  unsigned char *yPlane = out, *uPlane = out + w * h;
+  unsigned char *vPlane = uPlane + (w / 2) * (h / 2);
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i wy = _mm_setr_epi16(Y_R, Y_G, Y_B, 0, Y_R, Y_G, Y_B, 0);
+  const __m128i wu = _mm_setr_epi16(U_R, U_G, U_B, 0, U_R, U_G, U_B, 0);
+  const __m128i wv = _mm_setr_epi16(V_R, V_G, V_B, 0, V_R, V_G, V_B, 0);
+  const __m128i bias = _mm_set1_epi32((128 << 16) + 32768);
+#endif
+  for (int y = 0; y < h; y += 2) {
+    const unsigned char *row0 = rgba + (size_t)(h - 1 - y) * c->rowBytes;
+    const unsigned char *row1 = row0 - c->rowBytes;
+    unsigned char *y0 = yPlane + (size_t)y * w, *y1 = y0 + w;
+    unsigned char *u = uPlane + (size_t)(y / 2) * (w / 2);
+    unsigned char *v = vPlane + (size_t)(y / 2) * (w / 2);
+    int x = 0;
+#ifdef __SSE2__
+    // 4 pixels de cada linha (2 blocos) por iteracao
+    for (; x + 4 <= w; x += 4) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(row0 + x * 4));
+      __m128i b = _mm_loadu_si128((const __m128i *)(row1 + x * 4));
+      __m128i aLo = _mm_unpacklo_epi8(a, zero), aHi = _mm_unpackhi_epi8(a, zero);
+      __m128i bLo = _mm_unpacklo_epi8(b, zero), bHi = _mm_unpackhi_epi8(b, zero);
+      int ya = luma4(aLo, aHi, wy), yb = luma4(bLo, bHi, wy);
+      memcpy(y0 + x, &ya, 4);
+      memcpy(y1 + x, &yb, 4);
+
+      // Soma de cada bloco 2x2: (R, G, B, A) do bloco 0 e do bloco 1
+      __m128i lo = _mm_add_epi16(aLo, bLo), hi = _mm_add_epi16(aHi, bHi);
+      lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+      hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+      __m128i blocks = _mm_unpacklo_epi64(lo, hi);
+      // (U0, U1, V0, V1)
+      __m128i uv = pairSums(_mm_madd_epi16(blocks, wu),
+                            _mm_madd_epi16(blocks, wv));
+      uv = _mm_srai_epi32(_mm_add_epi32(uv, bias), 16);
+      uv = _mm_packs_epi32(uv, uv);
+      int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(uv, uv));
+      u[x / 2] = bytes & 0xff;
+      u[x / 2 + 1] = (bytes >> 8) & 0xff;
+      v[x / 2] = (bytes >> 16) & 0xff;
+      v[x / 2 + 1] = (bytes >> 24) & 0xff;
+    }
+#endif
+    yuvBlocks(row0, row1, x, w, y0, y1, u, v);
+  }
+}
+
+static int encodeFrame(Capture *c, const unsigned char *rgba) {
+  if (c->format == CAPTURE_Y4M) {
+    size_t size = (size_t)c->width * c->height * 3 / 2;
+    rgbaToYuv(c, rgba, c->planes);
+    return fputs("FRAME\n", c->file) >= 0 &&
+           fwrite(c->planes, 1, size, c->file) == size;
+  }
+  // PNG: RGB de cima para baixo
+  for (int y = 0; y < c->height; y++) {
+    const unsigned char *src = rgba + (size_t)(c->height - 1 - y) * c->rowBytes;
+    unsigned char *dst = c->planes + (size_t)y * c->width * 3;
+    for (int x = 0; x < c->width; x++) {
+      dst[x * 3] = src[x * 4];
+      dst[x * 3 + 1] = src[x * 4 + 1];
+      dst[x * 3 + 2] = src[x * 4 + 2];
+    }
+  }
+  char name[1024];
+  snprintf(name, sizeof(name), "%s/frame_%05ld.png", c->path, c->encoded);
+  return writePng(name, c->width, c->height, c->planes);
+}
+
+// Thread codificadora: consome os quadros cheios e devolve os buffers.
+// A fila nao tem como acordar a thread, que dorme 1 ms quando ela esta
+// vazia (bem menos que o intervalo entre dois frames).
+static void *encoderLoop(void *arg) {
+  Capture *c = arg;
+  const struct timespec nap = {0, 1000000};
+  for (;;) {
+    unsigned char *rgba = queuePop(&c->fullSlots);
+    if (!rgba) {
+      if (atomic_load(&c->stopping) && queueCount(&c->fullSlots) == 0)
+        break;
+      nanosleep(&nap, NULL);
+      continue;
+    }
+    double start = nowSeconds();
+    if (!c->writeError && !encodeFrame(c, rgba)) {
+      printf("Erro: falha ao gravar o quadro %ld em %s\n", c->encoded,
+             c->path);
+      c->writeError = 1;
+    }
+    c->encoded++;
+    c->encodeTime += nowSeconds() - start;
+    queuePush(&c->freeSlots, rgba);
+  }
+  return NULL;
+}
+
+// **********************************************************************
+//  Leitura (thread da GLUT)
+// **********************************************************************
+
+// Entrega um quadro a codificadora, ou o descarta se nao houver buffer livre
+static void submitFrame(Capture *c, const unsigned char *pixels) {
+  unsigned char *slot = queuePop(&c->freeSlots);
+  if (!slot) {
+    c->dropped++;
+    return;
+  }
+  memcpy(slot, pixels, (size_t)c->rowBytes * c->height);
+  queuePush(&c->fullSlots, slot);
+  c->captured++;
+}
+
+#ifndef WIN32
+// Copia a leitura mais antiga em andamento. Como ela foi disparada
+// CAPTURE_PBOS - 1 frames antes, o mapeamento normalmente nao espera.
+static void collectOldest(Capture *c) {
+  int i = (c->next - c->pending + CAPTURE_PBOS) % CAPTURE_PBOS;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbos[i]);
+  const unsigned char *pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if (pixels) {
+    submitFrame(c, pixels);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  } else
+    c->dropped++;
+  c->pending--;
+}
+#endif
+
+void captureFrame(Capture *c) {
+  double start = nowSeconds();
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadBuffer(GL_BACK);
+#ifndef WIN32
+  if (c->pending == CAPTURE_PBOS)
+    collectOldest(c);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbos[c->next]);
+  glReadPixels(0, 0, c->width, c->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  c->next = (c->next + 1) % CAPTURE_PBOS;
+  c->pending++;
+#else
+  // Sem buffer objects: leitura sincrona direto no buffer livre
+  unsigned char *slot = queuePop(&c->freeSlots);
+  if (slot) {
+    glReadPixels(0, 0, c->width, c->height, GL_RGBA, GL_UNSIGNED_BYTE, slot);
+    queuePush(&c->fullSlots, slot);
+    c->captured++;
+  } else
+    c->dropped++;
+#endif
+  c->readTime += nowSeconds() - start;
+}
+
+// **********************************************************************
+//  Inicio e fim
+// **********************************************************************
+
+static int hasSuffix(const char *s, const char *suffix) {
+  size_t n = strlen(s), m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static void freeCapture(Capture *c) {
+  for (int i = 0; i < CAPTURE_SLOTS; i++)
+    free(c->slots[i]);
+  destroyQueue(&c->freeSlots);
+  destroyQueue(&c->fullSlots);
+  free(c->planes);
+  free(c->path);
+  free(c);
+}
+
+Capture *startCapture(const char *path, int width, int height, float fps) {
+  Capture *c = calloc(1, sizeof(Capture));
+  c->format = hasSuffix(path, ".y4m") ? CAPTURE_Y4M : CAPTURE_PNG;
+  if (c->format == CAPTURE_Y4M) {
+    width &= ~1;
+    height &= ~1;
+  }
+  if (width <= 0 || height <= 0) {
+    free(c);
+    return NULL;
+  }
+  c->width = width;
+  c->height = height;
+  c->rowBytes = width * 4;
+  c->path = strdup(path);
+
+  if (c->format == CAPTURE_Y4M) {
+    c->file = fopen(path, "wb");
+    if (!c->file) {
+      printf("Erro: nao foi possivel criar %s\n", path);
+      freeCapture(c);
+      return NULL;
+    }
+    // Taxa como fracao com denominador 1000 (ex.: 120 fps = 120000:1000)
+    fprintf(c->file, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", width,
+            height, (int)(fps * 1000 + 0.5f));
+    c->planes = malloc((size_t)width * height * 3 / 2);
+  } else {
+    mkdir(path, 0755);
+    c->planes = malloc((size_t)width * height * 3);
+  }
+
+  size_t frameBytes = (size_t)c->rowBytes * height;
+  initQueue(&c->freeSlots, CAPTURE_SLOTS);
+  initQueue(&c->fullSlots, CAPTURE_SLOTS);
+  for (int i = 0; i < CAPTURE_SLOTS; i++) {
+    c->slots[i] = malloc(frameBytes);
+    queuePush(&c->freeSlots, c->slots[i]);
+  }
+
+#ifndef WIN32
+  glGenBuffers(CAPTURE_PBOS, c->pbos);
+  for (int i = 0; i < CAPTURE_PBOS; i++) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbos[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+
+  atomic_init(&c->stopping, 0);
+  if (pthread_create(&c->encoder, NULL, encoderLoop, c) != 0) {
+    printf("Erro: nao foi possivel criar a thread de codificacao\n");
+    if (c->file)
+      fclose(c->file);
+#ifndef WIN32
+    glDeleteBuffers(CAPTURE_PBOS, c->pbos);
+#endif
+    freeCapture(c);
+    return NULL;
+  }
+  printf("Gravando %dx%d em %s (%s)\n", width, height, path,
+         c->format == CAPTURE_Y4M ? "Y4M" : "PNG");
+  return c;
+}
+
+void stopCapture(Capture *c) {
+  if (!c)
+    return;
+#ifndef WIN32
+  while (c->pending > 0)
+    collectOldest(c);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glDeleteBuffers(CAPTURE_PBOS, c->pbos);
+#endif
+  atomic_store(&c->stopping, 1);
+  pthread_join(c->encoder, NULL);
+  if (c->file)
+    fclose(c->file);
+
+  long frames = c->captured + c->dropped;
+  printf("Captura: %ld quadros gravados, %ld descartados; leitura %.2f "
+         "ms/quadro (thread da GLUT), codificacao %.2f ms/quadro\n",
+         c->encoded, c->dropped, frames ? c->readTime * 1000 / frames : 0.0,
+         c->encoded ? c->encodeTime * 1000 / c->encoded : 0.0);
+  freeCapture(c);
+}
@@ -0,0 +1,31 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+// Gravacao do que aparece na janela. A leitura dos pixels e assincrona:
+// cada frame vai para um de CAPTURE_PBOS pixel buffer objects e so e
+// copiado para a memoria quando o buffer volta a ser usado, alguns frames
+// depois, quando a GPU ja terminou. Os quadros seguem por uma fila sem
+// locks para a thread codificadora; se ela nao der conta, o quadro e
+// descartado em vez de atrasar a reproducao.
+#define CAPTURE_PBOS 3
+#define CAPTURE_SLOTS 8
+
+enum { CAPTURE_Y4M, CAPTURE_PNG };
+
+typedef struct Capture Capture;
+
+// Caminho terminado em ".y4m": video YUV 4:2:0 sem compressao; qualquer
+// outro: diretorio com um PNG por quadro (frame_00000.png, ...). A
+// largura e a altura sao as da janela no inicio (arredondadas para pares
+// em Y4M) e ficam fixas durante a gravacao.
+// Deve ser chamada com o contexto OpenGL ativo. Retorna NULL em caso de erro
+Capture *startCapture(const char *path, int width, int height, float fps);
+
+// Le o back buffer do frame atual (chamar antes do glutSwapBuffers)
+void captureFrame(Capture *c);
+
+// Recolhe as leituras pendentes, espera a codificacao terminar, mostra as
+// estatisticas e libera a captura
+void stopCapture(Capture *c);
+
+#endif
@@ -0,0 +1,246 @@
+// **********************************************************************
+//	catalog.c
+//  Catalogo da biblioteca de clips: um arquivo texto com os metadados
+//  de cada clip, atualizado incrementalmente
+// **********************************************************************
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bvh.h"
+#include "catalog.h"
+#include "parallel.h"
+
+#define CATALOG_MAGIC "# bvhcatalog 1"
+
+static int compareEntries(const void *a, const void *b) {
+  return strcmp(((const CatalogEntry *)a)->path,
+                ((const CatalogEntry *)b)->path);
+}
+
+static CatalogEntry *findEntry(Catalog *cat, const char *path) {
+  CatalogEntry key = {.path = (char *)path};
+  return bsearch(&key, cat->entries, cat->count, sizeof(CatalogEntry),
+                 compareEntries);
+}
+
+static CatalogEntry *addEntry(Catalog *cat) {
+  if (cat->count == cat->cap) {
+    cat->cap = cat->cap ? cat->cap * 2 : 256;
+    cat->entries = realloc(cat->entries, cat->cap * sizeof(CatalogEntry));
+  }
+  CatalogEntry *e = &cat->entries[cat->count++];
+  memset(e, 0, sizeof(*e));
+  return e;
+}
+
+Catalog *loadCatalog(const char *path) {
+  Catalog *cat = calloc(1, sizeof(Catalog));
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return cat;
+  char line[4096];
+  if (!fgets(line, sizeof(line), file) ||
+      strncmp(line, CATALOG_MAGIC, strlen(CATALOG_MAGIC)) != 0) {
+    printf("Erro: %s nao e um catalogo\n", path);
+    fclose(file);
+    freeCatalog(cat);
+    return NULL;
+  }
+  while (fgets(line, sizeof(line), file)) {
+    char *tab = strchr(line, '\t');
+    if (!tab)
+      continue;
+    *tab = '\0';
+    CatalogEntry e = {0};
+    if (sscanf(tab + 1, "%lld %lld %d %f %d %d %llx %f %f %f %f %f %f",
+               &e.size, &e.mtime, &e.frames, &e.frameTime, &e.channels,
+               &e.joints, &e.skeleton, &e.bboxMin[0], &e.bboxMin[1],
+               &e.bboxMin[2], &e.bboxMax[0], &e.bboxMax[1],
+               &e.bboxMax[2]) != 13)
+      continue;
+    e.path = strdup(line);
+    *addEntry(cat) = e;
+  }
+  fclose(file);
+  qsort(cat->entries, cat->count, sizeof(CatalogEntry), compareEntries);
+  return cat;
+}
+
+int saveCatalog(const Catalog *cat, const char *path) {
+  // Grava num temporario e renomeia, para nunca deixar um catalogo pela metade
+  char tmp[1024];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *file = fopen(tmp, "w");
+  if (!file) {
+    printf("Erro: nao foi possivel criar %s\n", tmp);
+    return 0;
+  }
+  fprintf(file, "%s\n", CATALOG_MAGIC);
+  fprintf(file, "# caminho\ttamanho mtime frames frameTime canais juntas "
+                "esqueleto min[3] max[3]\n");
+  for (int i = 0; i < cat->count; i++) {
+    const CatalogEntry *e = &cat->entries[i];
+    // %.9g: o float volta identico na leitura (%g perde digitos)
+    fprintf(file,
+            "%s\t%lld %lld %d %.9g %d %d %016llx %.9g %.9g %.9g %.9g %.9g "
+            "%.9g\n",
+            e->path, e->size, e->mtime, e->frames, e->frameTime, e->channels,
+            e->joints, e->skeleton, e->bboxMin[0], e->bboxMin[1],
+            e->bboxMin[2], e->bboxMax[0], e->bboxMax[1], e->bboxMax[2]);
+  }
+  int ok = !ferror(file);
+  fclose(file);
+  if (ok && rename(tmp, path) != 0)
+    ok = 0;
+  if (!ok)
+    printf("Erro: nao foi possivel gravar %s\n", path);
+  return ok;
+}
+
+void freeCatalog(Catalog *cat) {
+  if (!cat)
+    return;
+  for (int i = 0; i < cat->count; i++)
+    free(cat->entries[i].path);
+  free(cat->entries);
+  free(cat);
+}
+
+// Maior distancia possivel de uma junta ate a raiz, qualquer que seja a pose
+static float skeletonReach(const Node *node) {
+  float reach = 0;
+  for (const Node *child = node->children; child; child = child->next) {
+    const float *o = child->offset;
+    float r = sqrtf(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]) +
+              skeletonReach(child);
+    reach = r > reach ? r : reach;
+  }
+  return reach;
+}
+
+int scanClip(const char *path, CatalogEntry *entry) {
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return 0;
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return 0;
+  Clip *clip = readClipHeader(file);
+  if (!clip) {
+    fclose(file);
+    return 0;
+  }
+  entry->size = st.st_size;
+  entry->mtime = st.st_mtime;
+  entry->frames = clip->totalFrames;
+  entry->frameTime = clip->frameTime;
+  entry->channels = clip->totalChannels;
+  entry->joints = clip->numNodes;
+  entry->skeleton = skeletonHash(clip->root, CATALOG_SKELETON_TOLERANCE);
+
+  // Faixa da translacao da raiz: so os canais da raiz de cada linha
+  const Node *root = clip->root;
+  float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  char line[65536];
+  int atLineStart = 1;
+  while (fgets(line, sizeof(line), file)) {
+    int start = atLineStart;
+    atLineStart = strchr(line, '\n') != NULL;
+    float values[6], t[3];
+    if (!start || root->channels <= 0 ||
+        parseValues(line, values, root->channels) < (size_t)root->channels)
+      continue;
+    nodeTranslation(root, values, t); // a raiz comeca no canal 0
+    for (int k = 0; k < 3; k++) {
+      min[k] = t[k] < min[k] ? t[k] : min[k];
+      max[k] = t[k] > max[k] ? t[k] : max[k];
+    }
+  }
+  fclose(file);
+  if (min[0] > max[0])
+    for (int k = 0; k < 3; k++)
+      min[k] = max[k] = root->offset[k];
+  float reach = skeletonReach(root);
+  for (int k = 0; k < 3; k++) {
+    entry->bboxMin[k] = min[k] - reach;
+    entry->bboxMax[k] = max[k] + reach;
+  }
+  freeClip(clip);
+  return 1;
+}
+
+typedef struct {
+  char **files;
+  CatalogEntry *scanned;
+  int *ok;
+} ScanJob;
+
+static void scanFile(int i, int thread, void *ctx) {
+  ScanJob *job = ctx;
+  job->ok[i] = scanClip(job->files[i], &job->scanned[i]);
+}
+
+int updateCatalog(Catalog *cat, char **files, int count, int numThreads) {
+  // Arquivos novos ou alterados (e a entrada atual de cada um, se houver)
+  char **stale = malloc(count * sizeof(char *));
+  CatalogEntry **current = malloc(count * sizeof(CatalogEntry *));
+  int numStale = 0;
+  for (int i = 0; i < count; i++) {
+    struct stat st;
+    CatalogEntry *e = findEntry(cat, files[i]);
+    if (!e || stat(files[i], &st) != 0 || e->size != st.st_size ||
+        e->mtime != (long long)st.st_mtime) {
+      current[numStale] = e;
+      stale[numStale++] = files[i];
+    }
+  }
+
+  ScanJob job = {stale, calloc(numStale, sizeof(CatalogEntry)),
+                 calloc(numStale, sizeof(int))};
+  parallelFor(numStale, numThreads, scanFile, &job);
+
+  // Substitui as entradas alteradas antes de acrescentar as novas (addEntry
+  // pode realocar o vetor)
+  for (int i = 0; i < numStale; i++)
+    if (job.ok[i] && current[i]) {
+      job.scanned[i].path = current[i]->path;
+      *current[i] = job.scanned[i];
+    }
+  for (int i = 0; i < numStale; i++) {
+    if (!job.ok[i]) {
+      printf("Aviso: %s nao pode ser lido\n", stale[i]);
+      // A entrada antiga nao vale mais
+      if (current[i]) {
+        free(current[i]->path);
+        current[i]->path = NULL;
+      }
+    } else if (!current[i]) {
+      job.scanned[i].path = strdup(stale[i]);
+      *addEntry(cat) = job.scanned[i];
+    }
+  }
+
+  // Remove o que sumiu do disco ou nao pode ser lido
+  int kept = 0;
+  for (int i = 0; i < cat->count; i++) {
+    struct stat st;
+    if (cat->entries[i].path && stat(cat->entries[i].path, &st) == 0)
+      cat->entries[kept++] = cat->entries[i];
+    else
+      free(cat->entries[i].path);
+  }
+  cat->count = kept;
+  qsort(cat->entries, cat->count, sizeof(CatalogEntry), compareEntries);
+
+  free(stale);
+  free(current);
+  free(job.scanned);
+  free(job.ok);
+  return numStale;
+}
@@ -0,0 +1,38 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+// Tolerancia (unidades do arquivo) dos offsets no hash de esqueleto
+#define CATALOG_SKELETON_TOLERANCE 0.001f
+
+// Metadados de um clip, obtidos sem carregar o movimento
+typedef struct {
+  char *path;
+  long long size, mtime;        // para detectar arquivos alterados
+  int frames;                   // total declarado na linha "Frames:"
+  float frameTime;
+  int channels, joints;
+  unsigned long long skeleton;  // skeletonHash da hierarquia
+  float bboxMin[3], bboxMax[3]; // caixa conservadora do movimento
+} CatalogEntry;
+
+typedef struct {
+  int count, cap;
+  CatalogEntry *entries; // ordenadas pelo caminho
+} Catalog;
+
+// Le o catalogo (vazio se o arquivo nao existir; NULL se estiver invalido)
+Catalog *loadCatalog(const char *path);
+int saveCatalog(const Catalog *cat, const char *path);
+void freeCatalog(Catalog *cat);
+
+// Atualiza as entradas dos arquivos dados, relendo (em paralelo) so os que
+// sao novos ou mudaram de tamanho/data, e remove as entradas de arquivos
+// que nao existem mais. Retorna a qtd de arquivos relidos
+int updateCatalog(Catalog *cat, char **files, int count, int numThreads);
+
+// Le os metadados de um arquivo. A caixa e a faixa da translacao da raiz
+// (so os primeiros valores de cada frame sao convertidos) expandida pelo
+// alcance do esqueleto, a soma dos offsets ate a junta mais distante.
+int scanClip(const char *path, CatalogEntry *entry);
+
+#endif
@@ -0,0 +1,499 @@
+// **********************************************************************
+//	collide.c
+//  Colisao entre capsulas de ossos: hash espacial uniforme (fase larga)
+//  e distancia entre segmentos em SSE (fase estreita)
+// **********************************************************************
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "collide.h"
+#include "parallel.h"
+#include "skeleton.h"
+
+// Itens por tarefa de parallelFor nas fases do hash e da fase estreita
+#define CAPSULE_BLOCK 512
+#define BUCKET_BLOCK 1024
+#define PAIR_BLOCK 1024
+
+void defaultCollideParams(CollideParams *p) {
+  p->cellSize = 40.0f;
+  p->selfCollision = 1;
+}
+
+// Uma capsula registrada numa celula
+typedef struct {
+  int capsule;
+  int cell[3];
+  unsigned bucket;
+} CellEntry;
+
+// Vetor de pares candidatos de uma thread
+typedef struct {
+  int count, cap;
+  int *pairs; // a, b intercalados
+} PairList;
+
+struct CollisionWorld {
+  int numThreads;
+  // Capacidade de cada buffer
+  int capRange, capFirst, capEntries, capSorted, capFill, capStart;
+  int capPairs, capDepth, capContacts;
+  int *cellRange;       // por capsula: celula minima (3) e maxima (3)
+  int *firstEntry;      // por capsula: primeira entrada (count + 1)
+  CellEntry *entries, *sorted;
+  atomic_int *bucketFill; // ocupacao e depois cursor de cada balde
+  int *bucketStart;     // inicio de cada balde em sorted (buckets + 1)
+  unsigned numBuckets;
+  PairList *lists;      // candidatos por thread
+  int *pairs;           // candidatos de todas as threads
+  float *depth;         // profundidade de cada candidato (< 0: separados)
+  Contact *contacts;
+  // Parametros da chamada atual
+  const Capsule *capsules;
+  int count;
+  const CollideParams *params;
+  int numPairs;
+};
+
+CollisionWorld *createCollisionWorld(int numThreads) {
+  CollisionWorld *w = calloc(1, sizeof(CollisionWorld));
+  w->numThreads = numThreads > 0 ? numThreads : defaultThreads();
+  w->lists = calloc(w->numThreads, sizeof(PairList));
+  return w;
+}
+
+void freeCollisionWorld(CollisionWorld *w) {
+  if (!w)
+    return;
+  for (int t = 0; t < w->numThreads; t++)
+    free(w->lists[t].pairs);
+  free(w->lists);
+  free(w->cellRange);
+  free(w->firstEntry);
+  free(w->entries);
+  free(w->sorted);
+  free(w->bucketFill);
+  free(w->bucketStart);
+  free(w->pairs);
+  free(w->depth);
+  free(w->contacts);
+  free(w);
+}
+
+// Garante espaco para n itens de size bytes em buf (capacidade em *cap)
+static void *reserve(void *buf, int *cap, int n, size_t size) {
+  if (n <= *cap)
+    return buf;
+  *cap = n + n / 2;
+  return realloc(buf, (size_t)*cap * size);
+}
+
+// **********************************************************************
+//  Regras de exclusao e testes
+// **********************************************************************
+
+// Ossos de um mesmo personagem que se tocam pela construcao do esqueleto:
+// vizinhos na hierarquia ou ja em contato na pose de repouso
+static int adjacent(const Capsule *a, const Capsule *b) {
+  if (a->parent == b->parent || a->node == b->parent ||
+      b->node == a->parent || a->parent == b->grandparent ||
+      b->parent == a->grandparent)
+    return 1;
+  const RestContacts *rest = a->rest;
+  return rest && rest == b->rest &&
+         rest->pairs[a->node * rest->numNodes + b->node];
+}
+
+static int skipPair(const Capsule *a, const Capsule *b,
+                    const CollideParams *p) {
+  return a->owner == b->owner && (!p->selfCollision || adjacent(a, b));
+}
+
+static void capsuleBox(const Capsule *c, float *min, float *max) {
+  for (int k = 0; k < 3; k++) {
+    min[k] = (c->a[k] < c->b[k] ? c->a[k] : c->b[k]) - c->radius;
+    max[k] = (c->a[k] > c->b[k] ? c->a[k] : c->b[k]) + c->radius;
+  }
+}
+
+static float clamp01(float x) { return x < 0 ? 0 : x > 1 ? 1 : x; }
+
+#define SEGMENT_EPS 1e-8f
+
+// Quadrado da distancia entre os segmentos das capsulas (Ericson, Real-
+// Time Collision Detection, 5.1.9, sem desvios para segmentos degenerados)
+static float segmentDistance2(const Capsule *ca, const Capsule *cb) {
+  float d1[3], d2[3], r[3];
+  for (int k = 0; k < 3; k++) {
+    d1[k] = ca->b[k] - ca->a[k];
+    d2[k] = cb->b[k] - cb->a[k];
+    r[k] = ca->a[k] - cb->a[k];
+  }
+  float a = d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2];
+  float e = d2[0] * d2[0] + d2[1] * d2[1] + d2[2] * d2[2];
+  float f = d2[0] * r[0] + d2[1] * r[1] + d2[2] * r[2];
+  float c = d1[0] * r[0] + d1[1] * r[1] + d1[2] * r[2];
+  float b = d1[0] * d2[0] + d1[1] * d2[1] + d1[2] * d2[2];
+  float ia = 1.0f / fmaxf(a, SEGMENT_EPS), ie = 1.0f / fmaxf(e, SEGMENT_EPS);
+  float denom = a * e - b * b;
+  float s = denom > SEGMENT_EPS * a * e ? clamp01((b * f - c * e) / denom)
+                                        : clamp01(-c * ia);
+  float t = (b * s + f) * ie;
+  if (t < 0) {
+    t = 0;
+    s = clamp01(-c * ia);
+  } else if (t > 1) {
+    t = 1;
+    s = clamp01((b - c) * ia);
+  }
+  float d = 0;
+  for (int k = 0; k < 3; k++) {
+    float v = r[k] + d1[k] * s - d2[k] * t;
+    d += v * v;
+  }
+  return d;
+}
+
+RestContacts *findRestContacts(const Clip *clip, float radius) {
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  int count = countCapsules(clip);
+  Capsule *capsules = malloc((count + 1) * sizeof(Capsule));
+  buildCapsules(clip, restPose(clip, world), NULL, radius, 0, NULL, capsules);
+  free(world);
+
+  RestContacts *rest = malloc(sizeof(RestContacts));
+  int n = rest->numNodes = clip->numNodes;
+  rest->pairs = calloc((size_t)n * n, 1);
+  float reach = 2 * radius;
+  for (int i = 0; i < count; i++)
+    for (int j = i + 1; j < count; j++) {
+      const Capsule *a = &capsules[i], *b = &capsules[j];
+      if (!adjacent(a, b) && segmentDistance2(a, b) < reach * reach)
+        rest->pairs[a->node * n + b->node] =
+            rest->pairs[b->node * n + a->node] = 1;
+    }
+  free(capsules);
+  return rest;
+}
+
+void freeRestContacts(RestContacts *rest) {
+  if (!rest)
+    return;
+  free(rest->pairs);
+  free(rest);
+}
+
+#ifdef __SSE__
+
+static __m128 clamp4(__m128 x) {
+  return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+static __m128 select4(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// segmentDistance2 de 4 pares por vez (SoA)
+static __m128 segmentDistance2x4(const Capsule *const *ca,
+                                 const Capsule *const *cb) {
+  __m128 d1[3], d2[3], r[3];
+  for (int k = 0; k < 3; k++) {
+    __m128 pa = _mm_setr_ps(ca[0]->a[k], ca[1]->a[k], ca[2]->a[k], ca[3]->a[k]);
+    __m128 qa = _mm_setr_ps(ca[0]->b[k], ca[1]->b[k], ca[2]->b[k], ca[3]->b[k]);
+    __m128 pb = _mm_setr_ps(cb[0]->a[k], cb[1]->a[k], cb[2]->a[k], cb[3]->a[k]);
+    __m128 qb = _mm_setr_ps(cb[0]->b[k], cb[1]->b[k], cb[2]->b[k], cb[3]->b[k]);
+    d1[k] = _mm_sub_ps(qa, pa);
+    d2[k] = _mm_sub_ps(qb, pb);
+    r[k] = _mm_sub_ps(pa, pb);
+  }
+#define DOT3(x, y)                                                           \
+  _mm_add_ps(_mm_add_ps(_mm_mul_ps(x[0], y[0]), _mm_mul_ps(x[1], y[1])),     \
+             _mm_mul_ps(x[2], y[2]))
+  __m128 a = DOT3(d1, d1), e = DOT3(d2, d2), f = DOT3(d2, r);
+  __m128 c = DOT3(d1, r), b = DOT3(d1, d2);
+#undef DOT3
+  const __m128 eps = _mm_set1_ps(SEGMENT_EPS);
+  __m128 ia = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(a, eps));
+  __m128 ie = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(e, eps));
+  __m128 ae = _mm_mul_ps(a, e);
+  __m128 denom = _mm_sub_ps(ae, _mm_mul_ps(b, b));
+  __m128 sOnA = clamp4(_mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), c), ia));
+  // Divisao protegida: nas lanes sem solucao geral o resultado e descartado
+  __m128 general = _mm_cmpgt_ps(denom, _mm_mul_ps(eps, ae));
+  __m128 sGeneral = clamp4(_mm_div_ps(
+      _mm_sub_ps(_mm_mul_ps(b, f), _mm_mul_ps(c, e)),
+      select4(general, denom, _mm_set1_ps(1.0f))));
+  __m128 s = select4(general, sGeneral, sOnA);
+  __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(b, s), f), ie);
+  __m128 below = _mm_cmplt_ps(t, _mm_setzero_ps());
+  __m128 above = _mm_cmpgt_ps(t, _mm_set1_ps(1.0f));
+  __m128 sAbove = clamp4(_mm_mul_ps(_mm_sub_ps(b, c), ia));
+  s = select4(below, sOnA, select4(above, sAbove, s));
+  t = clamp4(t);
+  __m128 d = _mm_setzero_ps();
+  for (int k = 0; k < 3; k++) {
+    __m128 v = _mm_sub_ps(_mm_add_ps(r[k], _mm_mul_ps(d1[k], s)),
+                          _mm_mul_ps(d2[k], t));
+    d = _mm_add_ps(d, _mm_mul_ps(v, v));
+  }
+  return d;
+}
+
+#endif
+
+// **********************************************************************
+//  Hash espacial
+// **********************************************************************
+
+static int cellOf(float x, float inv) { return (int)floorf(x * inv); }
+
+static unsigned hashCell(const int *cell, unsigned mask) {
+  return ((unsigned)cell[0] * 73856093u ^ (unsigned)cell[1] * 19349663u ^
+          (unsigned)cell[2] * 83492791u) &
+         mask;
+}
+
+// Celulas cobertas pela caixa de cada capsula
+static void rangeTask(int block, int thread, void *ctx) {
+  CollisionWorld *w = ctx;
+  float inv = 1.0f / w->params->cellSize;
+  int end = (block + 1) * CAPSULE_BLOCK;
+  if (end > w->count)
+    end = w->count;
+  for (int i = block * CAPSULE_BLOCK; i < end; i++) {
+    float min[3], max[3];
+    capsuleBox(&w->capsules[i], min, max);
+    int *range = w->cellRange + i * 6, cells = 1;
+    for (int k = 0; k < 3; k++) {
+      range[k] = cellOf(min[k], inv);
+      range[3 + k] = cellOf(max[k], inv);
+      cells *= range[3 + k] - range[k] + 1;
+    }
+    w->firstEntry[i + 1] = cells;
+  }
+}
+
+// Entradas de cada capsula e ocupacao dos baldes
+static void entryTask(int block, int thread, void *ctx) {
+  CollisionWorld *w = ctx;
+  unsigned mask = w->numBuckets - 1;
+  int end = (block + 1) * CAPSULE_BLOCK;
+  if (end > w->count)
+    end = w->count;
+  for (int i = block * CAPSULE_BLOCK; i < end; i++) {
+    const int *range = w->cellRange + i * 6;
+    CellEntry *e = w->entries + w->firstEntry[i];
+    int cell[3];
+    for (cell[2] = range[2]; cell[2] <= range[5]; cell[2]++)
+      for (cell[1] = range[1]; cell[1] <= range[4]; cell[1]++)
+        for (cell[0] = range[0]; cell[0] <= range[3]; cell[0]++, e++) {
+          e->capsule = i;
+          memcpy(e->cell, cell, sizeof(cell));
+          e->bucket = hashCell(cell, mask);
+          atomic_fetch_add_explicit(&w->bucketFill[e->bucket], 1,
+                                    memory_order_relaxed);
+        }
+  }
+}
+
+static void scatterTask(int block, int thread, void *ctx) {
+  CollisionWorld *w = ctx;
+  int numEntries = w->firstEntry[w->count];
+  int end = (block + 1) * CAPSULE_BLOCK;
+  if (end > numEntries)
+    end = numEntries;
+  for (int i = block * CAPSULE_BLOCK; i < end; i++) {
+    const CellEntry *e = &w->entries[i];
+    int slot = atomic_fetch_add_explicit(&w->bucketFill[e->bucket], 1,
+                                         memory_order_relaxed);
+    w->sorted[slot] = *e;
+  }
+}
+
+static void addPair(PairList *list, int a, int b) {
+  if (list->count == list->cap) {
+    list->cap = list->cap ? list->cap * 2 : 1024;
+    list->pairs = realloc(list->pairs, list->cap * 2 * sizeof(int));
+  }
+  list->pairs[list->count * 2] = a < b ? a : b;
+  list->pairs[list->count * 2 + 1] = a < b ? b : a;
+  list->count++;
+}
+
+// Fase larga: pares da mesma celula cujas caixas se sobrepoem. Um par que
+// divide varias celulas so e aceito na celula do canto minimo da
+// intersecao das caixas
+static void broadTask(int block, int thread, void *ctx) {
+  CollisionWorld *w = ctx;
+  PairList *list = &w->lists[thread];
+  float inv = 1.0f / w->params->cellSize;
+  unsigned end = (block + 1) * BUCKET_BLOCK;
+  if (end > w->numBuckets)
+    end = w->numBuckets;
+  for (unsigned k = block * BUCKET_BLOCK; k < end; k++) {
+    const CellEntry *first = w->sorted + w->bucketStart[k];
+    const CellEntry *last = w->sorted + w->bucketStart[k + 1];
+    for (const CellEntry *ei = first; ei < last; ei++)
+      for (const CellEntry *ej = ei + 1; ej < last; ej++) {
+        if (memcmp(ei->cell, ej->cell, sizeof(ei->cell)) != 0)
+          continue; // outra celula no mesmo balde
+        const Capsule *a = &w->capsules[ei->capsule];
+        const Capsule *b = &w->capsules[ej->capsule];
+        if (skipPair(a, b, w->params))
+          continue;
+        float amin[3], amax[3], bmin[3], bmax[3];
+        capsuleBox(a, amin, amax);
+        capsuleBox(b, bmin, bmax);
+        int overlap = 1, owner = 1;
+        for (int d = 0; d < 3 && overlap; d++) {
+          overlap = amin[d] <= bmax[d] && bmin[d] <= amax[d];
+          float lo = amin[d] > bmin[d] ? amin[d] : bmin[d];
+          owner = owner && cellOf(lo, inv) == ei->cell[d];
+        }
+        if (overlap && owner)
+          addPair(list, ei->capsule, ej->capsule);
+      }
+  }
+}
+
+// Fase estreita sobre um bloco de candidatos
+static void narrowTask(int block, int thread, void *ctx) {
+  CollisionWorld *w = ctx;
+  int begin = block * PAIR_BLOCK, end = begin + PAIR_BLOCK;
+  if (end > w->numPairs)
+    end = w->numPairs;
+  int i = begin;
+#ifdef __SSE__
+  for (; i + 4 <= end; i += 4) {
+    const Capsule *ca[4], *cb[4];
+    float radius[4];
+    for (int k = 0; k < 4; k++) {
+      ca[k] = &w->capsules[w->pairs[(i + k) * 2]];
+      cb[k] = &w->capsules[w->pairs[(i + k) * 2 + 1]];
+      radius[k] = ca[k]->radius + cb[k]->radius;
+    }
+    __m128 r = _mm_loadu_ps(radius);
+    __m128 depth = _mm_sub_ps(r, _mm_sqrt_ps(segmentDistance2x4(ca, cb)));
+    _mm_storeu_ps(w->depth + i, depth);
+  }
+#endif
+  for (; i < end; i++) {
+    const Capsule *a = &w->capsules[w->pairs[i * 2]];
+    const Capsule *b = &w->capsules[w->pairs[i * 2 + 1]];
+    w->depth[i] = a->radius + b->radius - sqrtf(segmentDistance2(a, b));
+  }
+}
+
+static int compareContacts(const void *x, const void *y) {
+  const Contact *a = x, *b = y;
+  if (a->a != b->a)
+    return a->a < b->a ? -1 : 1;
+  return (a->b > b->b) - (a->b < b->b);
+}
+
+int detectCollisions(CollisionWorld *w, const Capsule *capsules, int count,
+                     const CollideParams *p, const Contact **contacts) {
+  w->capsules = capsules;
+  w->count = count;
+  w->params = p;
+  *contacts = w->contacts;
+  if (count < 2)
+    return 0;
+
+  w->cellRange = reserve(w->cellRange, &w->capRange, count, 6 * sizeof(int));
+  w->firstEntry =
+      reserve(w->firstEntry, &w->capFirst, count + 1, sizeof(int));
+  int capsuleBlocks = (count + CAPSULE_BLOCK - 1) / CAPSULE_BLOCK;
+  parallelFor(capsuleBlocks, w->numThreads, rangeTask, w);
+  w->firstEntry[0] = 0;
+  for (int i = 0; i < count; i++)
+    w->firstEntry[i + 1] += w->firstEntry[i];
+  int numEntries = w->firstEntry[count];
+
+  // Baldes: potencia de 2 com pelo menos o dobro das entradas
+  unsigned buckets = 1024;
+  while (buckets < 2u * (unsigned)numEntries)
+    buckets *= 2;
+  w->numBuckets = buckets;
+  w->entries =
+      reserve(w->entries, &w->capEntries, numEntries, sizeof(CellEntry));
+  w->sorted = reserve(w->sorted, &w->capSorted, numEntries, sizeof(CellEntry));
+  w->bucketFill =
+      reserve(w->bucketFill, &w->capFill, buckets, sizeof(atomic_int));
+  w->bucketStart =
+      reserve(w->bucketStart, &w->capStart, buckets + 1, sizeof(int));
+  for (unsigned k = 0; k < buckets; k++)
+    atomic_init(&w->bucketFill[k], 0);
+
+  parallelFor(capsuleBlocks, w->numThreads, entryTask, w);
+  // Contagem -> inicio de cada balde (e cursor para o espalhamento)
+  int start = 0;
+  for (unsigned k = 0; k < buckets; k++) {
+    int n = atomic_load_explicit(&w->bucketFill[k], memory_order_relaxed);
+    w->bucketStart[k] = start;
+    atomic_init(&w->bucketFill[k], start);
+    start += n;
+  }
+  w->bucketStart[buckets] = start;
+  parallelFor((numEntries + CAPSULE_BLOCK - 1) / CAPSULE_BLOCK, w->numThreads,
+              scatterTask, w);
+
+  for (int t = 0; t < w->numThreads; t++)
+    w->lists[t].count = 0;
+  parallelFor((buckets + BUCKET_BLOCK - 1) / BUCKET_BLOCK, w->numThreads,
+              broadTask, w);
+
+  w->numPairs = 0;
+  for (int t = 0; t < w->numThreads; t++)
+    w->numPairs += w->lists[t].count;
+  w->pairs = reserve(w->pairs, &w->capPairs, w->numPairs, 2 * sizeof(int));
+  w->depth = reserve(w->depth, &w->capDepth, w->numPairs, sizeof(float));
+  w->contacts =
+      reserve(w->contacts, &w->capContacts, w->numPairs, sizeof(Contact));
+  int pos = 0;
+  for (int t = 0; t < w->numThreads; t++) {
+    memcpy(w->pairs + pos * 2, w->lists[t].pairs,
+           w->lists[t].count * 2 * sizeof(int));
+    pos += w->lists[t].count;
+  }
+  parallelFor((w->numPairs + PAIR_BLOCK - 1) / PAIR_BLOCK, w->numThreads,
+              narrowTask, w);
+
+  int found = 0;
+  for (int i = 0; i < w->numPairs; i++)
+    if (w->depth[i] > 0)
+      w->contacts[found++] =
+          (Contact){w->pairs[i * 2], w->pairs[i * 2 + 1], w->depth[i]};
+  qsort(w->contacts, found, sizeof(Contact), compareContacts);
+  *contacts = w->contacts;
+  return found;
+}
+
+int detectCollisionsBrute(const Capsule *capsules, int count,
+                          const CollideParams *p, Contact **contacts) {
+  int found = 0, cap = 0;
+  *contacts = NULL;
+  for (int i = 0; i < count; i++)
+    for (int j = i + 1; j < count; j++) {
+      if (skipPair(&capsules[i], &capsules[j], p))
+        continue;
+      float depth = capsules[i].radius + capsules[j].radius -
+                    sqrtf(segmentDistance2(&capsules[i], &capsules[j]));
+      if (depth <= 0)
+        continue;
+      if (found == cap) {
+        cap = cap ? cap * 2 : 256;
+        *contacts = realloc(*contacts, cap * sizeof(Contact));
+      }
+      (*contacts)[found++] = (Contact){i, j, depth};
+    }
+  return found;
+}
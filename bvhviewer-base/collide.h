@@ -0,0 +1,51 @@
+#ifndef COLLIDE_H
+#define COLLIDE_H
+
+#include "capsule.h"
+
+typedef struct {
+  float cellSize;    // aresta das celulas do hash espacial
+  int selfCollision; // testa os ossos de um mesmo personagem entre si
+} CollideParams;
+
+void defaultCollideParams(CollideParams *p);
+
+// Pares de ossos de um esqueleto que ja se interpenetram na pose de
+// repouso (ex.: pescoco e ombros saindo de Spine1). Eles nao sao testados
+// entre si, como os ossos vizinhos
+typedef struct RestContacts {
+  int numNodes;
+  unsigned char *pairs; // numNodes x numNodes, por indice do nodo filho
+} RestContacts;
+
+RestContacts *findRestContacts(const Clip *clip, float radius);
+void freeRestContacts(RestContacts *rest);
+
+// Par de capsulas que se interpenetram (a < b)
+typedef struct {
+  int a, b;
+  float depth; // soma dos raios menos a distancia entre os segmentos
+} Contact;
+
+// Buffers reaproveitados de um frame para o outro
+typedef struct CollisionWorld CollisionWorld;
+
+CollisionWorld *createCollisionWorld(int numThreads);
+void freeCollisionWorld(CollisionWorld *world);
+
+// Detecta as interpenetracoes entre as capsulas. Fase larga: hash espacial
+// uniforme, refeito a cada chamada em paralelo; fase estreita: distancia
+// entre segmentos, 4 pares por vez (SSE). Ossos vizinhos de um mesmo
+// personagem (que compartilham uma junta ou estao a uma junta disso) e os
+// pares de Capsule.rest nao sao testados. Retorna a qtd de contatos;
+// *contacts aponta para um vetor do world, ordenado por (a, b) e valido
+// ate a proxima chamada
+int detectCollisions(CollisionWorld *world, const Capsule *capsules,
+                     int count, const CollideParams *p,
+                     const Contact **contacts);
+
+// Idem, testando todos os pares (referencia para conferencia)
+int detectCollisionsBrute(const Capsule *capsules, int count,
+                          const CollideParams *p, Contact **contacts);
+
+#endif
@@ -0,0 +1,135 @@
+// **********************************************************************
+//	contact.c
+//  Deteccao de contato dos pes com o chao, por altura e velocidade das
+//  juntas LFoot/LToe/RFoot/RToe obtidas por cinematica direta
+// **********************************************************************
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contact.h"
+
+#define NUM_CONTACT_JOINTS 4
+
+// Nomes aceitos para cada junta: o do esqueleto de exemplo (initMaleSkel)
+// e o usado pelos arquivos de bvh/
+static const char *jointNames[NUM_CONTACT_JOINTS][2] = {
+    {"LFoot", "LeftFoot"},
+    {"LToe", "LeftToeBase"},
+    {"RFoot", "RightFoot"},
+    {"RToe", "RightToeBase"},
+};
+
+static const unsigned char jointBits[NUM_CONTACT_JOINTS] = {
+    CONTACT_LFOOT, CONTACT_LTOE, CONTACT_RFOOT, CONTACT_RTOE};
+
+void defaultContactParams(ContactParams *p) {
+  p->heightOn = 4.0f;
+  p->heightOff = 6.0f;
+  p->speedOn = 20.0f;
+  p->speedOff = 35.0f;
+}
+
+// Marca o nodo e todos os seus ancestrais como necessarios para a FK
+static void markChain(const Node *node, char *needed) {
+  for (; node; node = node->parent)
+    needed[node->index] = 1;
+}
+
+int detectContacts(const Clip *clip, const ContactParams *p,
+                   unsigned char *labels) {
+  int frames = clip->totalFrames;
+  memset(labels, 0, frames);
+
+  const Node *joints[NUM_CONTACT_JOINTS];
+  int found = 0;
+  char *needed = calloc(clip->numNodes, 1);
+  for (int j = 0; j < NUM_CONTACT_JOINTS; j++) {
+    joints[j] = findClipNode(clip, jointNames[j][0]);
+    if (!joints[j])
+      joints[j] = findClipNode(clip, jointNames[j][1]);
+    if (joints[j]) {
+      markChain(joints[j], needed);
+      found++;
+    }
+  }
+  if (found == 0) {
+    free(needed);
+    return 0;
+  }
+
+  // So as cadeias raiz -> pe/dedo sao avaliadas
+  int numChain = 0;
+  int *chain = malloc(clip->numNodes * sizeof(int));
+  for (int i = 0; i < clip->numNodes; i++)
+    if (needed[i])
+      chain[numChain++] = i;
+
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  float *pos = malloc((size_t)frames * NUM_CONTACT_JOINTS * 3 * sizeof(float));
+  float ground[NUM_CONTACT_JOINTS] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+
+  for (int f = 0; f < frames; f++) {
+    const float *values = clip->data[f];
+    for (int k = 0; k < numChain; k++) {
+      const Node *node = clip->nodes[chain[k]];
+      float *m = world + node->index * 16;
+      localMatrix(node, values, m);
+      if (node->parent)
+        matMul(world + node->parent->index * 16, m, m);
+    }
+    for (int j = 0; j < NUM_CONTACT_JOINTS; j++) {
+      if (!joints[j])
+        continue;
+      const float *m = world + joints[j]->index * 16;
+      float *out = pos + (f * NUM_CONTACT_JOINTS + j) * 3;
+      out[0] = m[12];
+      out[1] = m[13];
+      out[2] = m[14];
+      if (out[1] < ground[j])
+        ground[j] = out[1];
+    }
+  }
+
+  float dt = clip->frameTime > 0 ? clip->frameTime : 1.0f / 30.0f;
+  for (int j = 0; j < NUM_CONTACT_JOINTS; j++) {
+    if (!joints[j])
+      continue;
+    int inContact = 0;
+    for (int f = 0; f < frames; f++) {
+      // Diferenca para o frame anterior (o primeiro usa o seguinte)
+      int g = f > 0 ? f - 1 : (frames > 1 ? 1 : 0);
+      const float *a = pos + (f * NUM_CONTACT_JOINTS + j) * 3;
+      const float *b = pos + (g * NUM_CONTACT_JOINTS + j) * 3;
+      float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+      float speed = sqrtf(dx * dx + dy * dy + dz * dz) / dt;
+      float height = a[1] - ground[j];
+
+      if (inContact)
+        inContact = height < p->heightOff && speed < p->speedOff;
+      else
+        inContact = height < p->heightOn && speed < p->speedOn;
+      if (inContact)
+        labels[f] |= jointBits[j];
+    }
+  }
+
+  free(pos);
+  free(world);
+  free(chain);
+  free(needed);
+  return found;
+}
+
+void writeContactTrack(FILE *out, const unsigned char *labels, int frames) {
+  int f = 0;
+  while (f < frames) {
+    int run = 1;
+    while (f + run < frames && labels[f + run] == labels[f])
+      run++;
+    fprintf(out, "%s%d:%x", f ? " " : "", run, labels[f]);
+    f += run;
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef CONTACT_H
+#define CONTACT_H
+
+#include <stdio.h>
+
+#include "bvh.h"
+
+// Bits da mascara de contato de cada frame
+#define CONTACT_LFOOT 1
+#define CONTACT_LTOE 2
+#define CONTACT_RFOOT 4
+#define CONTACT_RTOE 8
+
+// Limiares com histerese: o contato comeca abaixo de *On e so termina
+// acima de *Off. A altura de cada junta e medida a partir do ponto mais
+// baixo que ela atinge no clip, velocidades em unidades do arquivo/segundo.
+typedef struct {
+  float heightOn, heightOff;
+  float speedOn, speedOff;
+} ContactParams;
+
+void defaultContactParams(ContactParams *p);
+
+// Classifica os contatos de cada frame (labels tem clip->totalFrames
+// bytes). Retorna a qtd de juntas de pe encontradas (0 = nenhuma)
+int detectContacts(const Clip *clip, const ContactParams *p,
+                   unsigned char *labels);
+
+// Escreve a trilha de rotulos compactada em runs "qtd:mascara" (hexa)
+void writeContactTrack(FILE *out, const unsigned char *labels, int frames);
+
+#endif
@@ -0,0 +1,176 @@
+// **********************************************************************
+//	draw.c
+//  Desenho do esqueleto e do piso em OpenGL (sem GLUT), compartilhado
+//  pelo visualizador e pelo gerador de miniaturas
+// **********************************************************************
+
+#include <math.h>
+
+#include "draw.h"
+
+// Desenha um segmento do esqueleto (bone)
+void renderBone(float x0, float y0, float z0, float x1, float y1, float z1) {
+  GLdouble dir_x = x1 - x0;
+  GLdouble dir_y = y1 - y0;
+  GLdouble dir_z = z1 - z0;
+  GLdouble bone_length = sqrt(dir_x * dir_x + dir_y * dir_y + dir_z * dir_z);
+
+  // Um por thread: as miniaturas desenham em varios contextos ao mesmo tempo
+  static _Thread_local GLUquadricObj *quad_obj = NULL;
+  if (quad_obj == NULL)
+    quad_obj = gluNewQuadric();
+  gluQuadricDrawStyle(quad_obj, GLU_FILL);
+  gluQuadricNormals(quad_obj, GLU_SMOOTH);
+
+  glPushMatrix();
+
+  glTranslated(x0, y0, z0);
+
+  double length;
+  length = sqrt(dir_x * dir_x + dir_y * dir_y + dir_z * dir_z);
+  if (length < 0.0001) {
+    dir_x = 0.0;
+    dir_y = 0.0;
+    dir_z = 1.0;
+    length = 1.0;
+  }
+  dir_x /= length;
+  dir_y /= length;
+  dir_z /= length;
+
+  GLdouble up_x, up_y, up_z;
+  up_x = 0.0;
+  up_y = 1.0;
+  up_z = 0.0;
+
+  double side_x, side_y, side_z;
+  side_x = up_y * dir_z - up_z * dir_y;
+  side_y = up_z * dir_x - up_x * dir_z;
+  side_z = up_x * dir_y - up_y * dir_x;
+
+  length = sqrt(side_x * side_x + side_y * side_y + side_z * side_z);
+  if (length < 0.0001) {
+    side_x = 1.0;
+    side_y = 0.0;
+    side_z = 0.0;
+    length = 1.0;
+  }
+  side_x /= length;
+  side_y /= length;
+  side_z /= length;
+
+  up_x = dir_y * side_z - dir_z * side_y;
+  up_y = dir_z * side_x - dir_x * side_z;
+  up_z = dir_x * side_y - dir_y * side_x;
+
+  GLdouble m[16] = {side_x, side_y, side_z, 0.0, up_x, up_y, up_z, 0.0,
+                    dir_x,  dir_y,  dir_z,  0.0, 0.0,  0.0,  0.0,  1.0};
+  glMultMatrixd(m);
+
+  GLdouble radius = 3;   // raio
+  GLdouble slices = 8.0; // fatias horizontais
+  GLdouble stack = 3.0;  // fatias verticais
+
+  // Desenha como cilindros
+  gluCylinder(quad_obj, radius, radius, bone_length, slices, stack);
+
+  glPopMatrix();
+}
+
+// Desenha um nodo da hierarquia (chamada recursiva)
+void drawNode(Node *node) {
+  glPushMatrix();
+
+  // Transformacao local calculada por updatePose (ver apply)
+  glMultMatrixf(node->local);
+
+  if (node->numChildren == 0)
+    renderBone(0, 0, 0, node->offset[0], node->offset[1], node->offset[2]);
+  else if (node->numChildren == 1) {
+    Node *child = node->children;
+    renderBone(0, 0, 0, child->offset[0], child->offset[1], child->offset[2]);
+  } else {
+    int nc = 0;
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    Node* child = node->children;
+    while(child) {
+      nc++;
+      center[0] += child->offset[0];
+      center[1] += child->offset[1];
+      center[2] += child->offset[2];
+      child = child->next;
+    }
+    center[0] /= nc + 1;
+    center[1] /= nc + 1;
+    center[2] /= nc + 1;
+
+    renderBone(0.0f, 0.0f, 0.0f, center[0], center[1], center[2]);
+
+    child = node->children;
+    while(child) {
+      renderBone(center[0], center[1], center[2], child->offset[0],
+                 child->offset[1], child->offset[2]);
+      child = child->next;
+    }
+  }
+
+  Node* child = node->children;
+  while(child) {
+    drawNode(child);
+    child = child->next;
+  }
+  glPopMatrix();
+}
+
+// **********************************************************************
+//  Desenha um quadriculado para representar um piso
+// **********************************************************************
+void drawFloor() {
+  float size = 50;
+  int num_x = 100, num_z = 100;
+  double ox, oz;
+  glBegin(GL_QUADS);
+  glNormal3d(0.0, 1.0, 0.0);
+  ox = -(num_x * size) / 2;
+  for (int x = 0; x < num_x; x++, ox += size) {
+    oz = -(num_z * size) / 2;
+    for (int z = 0; z < num_z; z++, oz += size) {
+      if (((x + z) % 2) == 0)
+        glColor3f(1.0, 1.0, 1.0);
+      else
+        glColor3f(0.8, 0.8, 0.8);
+      glVertex3d(ox, 0.0, oz);
+      glVertex3d(ox, 0.0, oz + size);
+      glVertex3d(ox + size, 0.0, oz + size);
+      glVertex3d(ox + size, 0.0, oz);
+    }
+  }
+  glEnd();
+}
+
+// **********************************************************************
+//  Luz e estados usados pelas cenas do visualizador e das miniaturas
+// **********************************************************************
+void setupScene() {
+  // Parametros da fonte de luz
+  float light0_position[] = {10.0, 100.0, 100.0, 1.0};
+  float light0_diffuse[] = {0.8, 0.8, 0.8, 1.0};
+  float light0_specular[] = {1.0, 1.0, 1.0, 1.0};
+  float light0_ambient[] = {0.1, 0.1, 0.1, 1.0};
+
+  // Ajusta
+  glLightfv(GL_LIGHT0, GL_POSITION, light0_position);
+  glLightfv(GL_LIGHT0, GL_DIFFUSE, light0_diffuse);
+  glLightfv(GL_LIGHT0, GL_SPECULAR, light0_specular);
+  glLightfv(GL_LIGHT0, GL_AMBIENT, light0_ambient);
+
+  // Habilita estados necessarios
+  glEnable(GL_LIGHT0);
+  glEnable(GL_LIGHTING);
+  glEnable(GL_COLOR_MATERIAL);
+  glEnable(GL_DEPTH_TEST);
+  glCullFace(GL_BACK);
+  glEnable(GL_CULL_FACE);
+
+  glClearColor(0.5, 0.5, 0.8, 0.0);
+}
@@ -0,0 +1,25 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+#include "bvh.h"
+
+#ifdef WIN32
+#include <windows.h> // somente no Windows
+#endif
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+void renderBone(float x0, float y0, float z0, float x1, float y1, float z1);
+// Desenha a subarvore usando as transformacoes locais de updatePose
+void drawNode(Node *node);
+void drawFloor();
+// Configura a luz, o teste de profundidade e a cor de fundo
+void setupScene();
+
+#endif
@@ -0,0 +1,321 @@
+// **********************************************************************
+//	filter.c
+//  Suavizacao dos canais de movimento: Savitzky-Golay, Butterworth de
+//  fase zero e Savitzky-Golay sobre quaternions
+// **********************************************************************
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "filter.h"
+#include "parallel.h"
+#include "quat.h"
+
+// Maior meia janela do Savitzky-Golay e maior grau do polinomio
+#define SAVGOL_MAX_WINDOW 32
+#define SAVGOL_MAX_DEGREE 6
+// Frames refletidos antes e depois do clip no Butterworth (como filtfilt)
+#define BUTTER_PAD 9
+
+void defaultFilterParams(FilterParams *p) {
+  p->type = FILTER_SAVGOL;
+  p->window = 4;
+  p->degree = 2;
+  p->cutoff = 6.0f;
+}
+
+static const char *filterNames[FILTER_COUNT] = {"none", "savgol", "butter",
+                                                "quat"};
+
+const char *filterName(int type) {
+  return type >= 0 && type < FILTER_COUNT ? filterNames[type] : "?";
+}
+
+int filterType(const char *name) {
+  for (int t = 0; t < FILTER_COUNT; t++)
+    if (strcmp(name, filterNames[t]) == 0)
+      return t;
+  return -1;
+}
+
+// **********************************************************************
+//  Operacoes sobre 4 canais por vez (um frame = 4 floats consecutivos)
+// **********************************************************************
+
+#ifdef __SSE__
+typedef __m128 Lanes;
+#define lanesLoad(p) _mm_loadu_ps(p)
+#define lanesStore(p, v) _mm_storeu_ps(p, v)
+#define lanesSet(x) _mm_set1_ps(x)
+#define lanesAdd(a, b) _mm_add_ps(a, b)
+#define lanesSub(a, b) _mm_sub_ps(a, b)
+#define lanesMul(a, b) _mm_mul_ps(a, b)
+#else
+typedef struct {
+  float v[4];
+} Lanes;
+static Lanes lanesLoad(const float *p) {
+  Lanes r;
+  memcpy(r.v, p, sizeof(r.v));
+  return r;
+}
+#define lanesStore(p, x) memcpy(p, (x).v, sizeof((x).v))
+static Lanes lanesSet(float x) { return (Lanes){{x, x, x, x}}; }
+#define LANES_OP(name, op)                                                   \
+  static Lanes name(Lanes a, Lanes b) {                                      \
+    for (int k = 0; k < 4; k++)                                              \
+      a.v[k] = a.v[k] op b.v[k];                                             \
+    return a;                                                                \
+  }
+LANES_OP(lanesAdd, +)
+LANES_OP(lanesSub, -)
+LANES_OP(lanesMul, *)
+#endif
+
+// Indice refletido nas bordas: -1 -> 1, n -> n - 2
+static int reflect(int i, int n) {
+  if (n == 1)
+    return 0;
+  while (i < 0 || i >= n)
+    i = i < 0 ? -i : 2 * (n - 1) - i;
+  return i;
+}
+
+// Coeficientes de suavizacao (derivada zero) de uma janela 2m + 1: valor
+// no centro do polinomio de grau g ajustado por minimos quadrados
+static void savgolCoefficients(int m, int g, float *coef) {
+  double a[SAVGOL_MAX_DEGREE + 1][SAVGOL_MAX_DEGREE + 2] = {{0}};
+  // Equacoes normais (A^T A) z = e0, com A[k][j] = k^j
+  for (int i = 0; i <= g; i++) {
+    for (int j = 0; j <= g; j++)
+      for (int k = -m; k <= m; k++)
+        a[i][j] += pow(k, i + j);
+    a[i][g + 1] = i == 0;
+  }
+  for (int c = 0; c <= g; c++) {
+    int pivot = c;
+    for (int r = c + 1; r <= g; r++)
+      if (fabs(a[r][c]) > fabs(a[pivot][c]))
+        pivot = r;
+    for (int j = 0; j <= g + 1; j++) {
+      double t = a[c][j];
+      a[c][j] = a[pivot][j];
+      a[pivot][j] = t;
+    }
+    for (int r = 0; r <= g; r++)
+      if (r != c) {
+        double f = a[r][c] / a[c][c];
+        for (int j = c; j <= g + 1; j++)
+          a[r][j] -= f * a[c][j];
+      }
+  }
+  for (int k = -m; k <= m; k++) {
+    double sum = 0;
+    for (int j = 0; j <= g; j++)
+      sum += a[j][g + 1] / a[j][j] * pow(k, j);
+    coef[k + m] = (float)sum;
+  }
+}
+
+static void savgolLanes(const float *in, float *out, int n, const float *coef,
+                        int m) {
+  for (int f = 0; f < n; f++) {
+    Lanes sum = lanesSet(0);
+    if (f >= m && f + m < n) {
+      const float *x = in + (f - m) * 4;
+      for (int k = 0; k <= 2 * m; k++)
+        sum = lanesAdd(sum, lanesMul(lanesSet(coef[k]), lanesLoad(x + k * 4)));
+    } else
+      for (int k = -m; k <= m; k++)
+        sum = lanesAdd(sum, lanesMul(lanesSet(coef[k + m]),
+                                     lanesLoad(in + reflect(f + k, n) * 4)));
+    lanesStore(out + f * 4, sum);
+  }
+}
+
+// Biquad passa-baixas (forma direta II transposta)
+typedef struct {
+  float b0, b1, b2, a1, a2;
+} Biquad;
+
+static void butterworthBiquad(float cutoff, float frameTime, Biquad *q) {
+  float rate = frameTime > 0 ? 1.0f / frameTime : 30.0f;
+  if (cutoff > 0.45f * rate)
+    cutoff = 0.45f * rate;
+  double k = tan(M_PI * cutoff / rate), k2 = k * k;
+  double norm = 1.0 / (1.0 + M_SQRT2 * k + k2);
+  q->b0 = (float)(k2 * norm);
+  q->b1 = 2 * q->b0;
+  q->b2 = q->b0;
+  q->a1 = (float)(2.0 * (k2 - 1.0) * norm);
+  q->a2 = (float)((1.0 - M_SQRT2 * k + k2) * norm);
+}
+
+// Filtra buf[0, n) no sentido dir (1 ou -1), partindo do regime
+// permanente do primeiro valor
+static void biquadPass(const Biquad *q, float *buf, int n, int dir) {
+  float *x = dir > 0 ? buf : buf + (n - 1) * 4;
+  Lanes x0 = lanesLoad(x);
+  Lanes b0 = lanesSet(q->b0), b1 = lanesSet(q->b1), b2 = lanesSet(q->b2);
+  Lanes a1 = lanesSet(q->a1), a2 = lanesSet(q->a2);
+  Lanes z1 = lanesMul(x0, lanesSet(1 - q->b0));
+  Lanes z2 = lanesMul(x0, lanesSet(q->b2 - q->a2));
+  for (int f = 0; f < n; f++, x += dir * 4) {
+    Lanes in = lanesLoad(x);
+    Lanes y = lanesAdd(lanesMul(b0, in), z1);
+    z1 = lanesAdd(lanesSub(lanesMul(b1, in), lanesMul(a1, y)), z2);
+    z2 = lanesSub(lanesMul(b2, in), lanesMul(a2, y));
+    lanesStore(x, y);
+  }
+}
+
+// Ida e volta sobre o sinal estendido por reflexao impar nas bordas
+static void butterworthLanes(const float *in, float *out, int n,
+                             const Biquad *q, float *pad) {
+  int p = n > 1 ? (n - 1 < BUTTER_PAD ? n - 1 : BUTTER_PAD) : 0;
+  memcpy(pad + p * 4, in, (size_t)n * 4 * sizeof(float));
+  for (int i = 1; i <= p; i++)
+    for (int k = 0; k < 4; k++) {
+      pad[(p - i) * 4 + k] = 2 * in[k] - in[i * 4 + k];
+      pad[(p + n - 1 + i) * 4 + k] =
+          2 * in[(n - 1) * 4 + k] - in[(n - 1 - i) * 4 + k];
+    }
+  biquadPass(q, pad, n + 2 * p, 1);
+  biquadPass(q, pad, n + 2 * p, -1);
+  memcpy(out, pad + p * 4, (size_t)n * 4 * sizeof(float));
+}
+
+// **********************************************************************
+//  Tarefas: 4 canais quaisquer ou uma trilha de rotacao (quaternion)
+// **********************************************************************
+
+typedef struct {
+  int count;       // canais validos (1 a 4); 0 = trilha de quaternion
+  int channel[4];  // canais do grupo ou os 3 canais de rotacao do nodo
+  int rotation[4]; // 1 se o canal e um angulo
+  const Node *node;
+} FilterTask;
+
+typedef struct {
+  const Clip *clip;
+  const float *src;
+  float *dst;
+  const FilterParams *p;
+  FilterTask *tasks;
+  float coef[2 * SAVGOL_MAX_WINDOW + 1];
+  int window;
+  Biquad biquad;
+} FilterJob;
+
+// Leva v para a volta de ref (mesmo angulo, diferenca <= 180)
+static float nearestTurn(float v, float ref) {
+  return v + 360.0f * roundf((ref - v) / 360.0f);
+}
+
+static void filterTask(int t, int thread, void *ctx) {
+  FilterJob *job = ctx;
+  const FilterTask *task = &job->tasks[t];
+  int n = job->clip->totalFrames, stride = job->clip->totalChannels;
+  float *in = malloc((size_t)(3 * n + 2 * BUTTER_PAD) * 4 * sizeof(float));
+  float *out = in + (size_t)n * 4, *pad = out + (size_t)n * 4;
+
+  if (task->count == 0) {
+    // Quaternions contiguos no hemisferio (eulerToQuats), filtrados como
+    // 4 canais e normalizados de volta
+    const Node *node = task->node;
+    eulerToQuats(job->src + node->channelOffset + node->rotationChannel,
+                 stride, node->rotationOrder, n, in, 4);
+    savgolLanes(in, out, n, job->coef, job->window);
+    for (int f = 0; f < n; f++) {
+      float *q = out + f * 4, angles[3];
+      float len = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+      for (int k = 0; k < 4; k++)
+        q[k] /= len;
+      quatToEuler(q, node->rotationOrder, angles);
+      size_t row = (size_t)f * stride;
+      for (int k = 0; k < 3; k++)
+        job->dst[row + task->channel[k]] =
+            nearestTurn(angles[k], job->src[row + task->channel[k]]);
+    }
+    free(in);
+    return;
+  }
+
+  // Angulos desenrolados ao longo do tempo para que o filtro nao veja os
+  // saltos de 360 graus; canais que faltam no grupo repetem o ultimo
+  for (int f = 0; f < n; f++)
+    for (int k = 0; k < 4; k++) {
+      int c = k < task->count ? k : task->count - 1;
+      float v = job->src[(size_t)f * stride + task->channel[c]];
+      if (task->rotation[c] && f > 0)
+        v = nearestTurn(v, in[(f - 1) * 4 + k]);
+      in[f * 4 + k] = v;
+    }
+  if (job->p->type == FILTER_BUTTERWORTH)
+    butterworthLanes(in, out, n, &job->biquad, pad);
+  else
+    savgolLanes(in, out, n, job->coef, job->window);
+  for (int f = 0; f < n; f++)
+    for (int k = 0; k < task->count; k++) {
+      size_t i = (size_t)f * stride + task->channel[k];
+      float v = out[f * 4 + k];
+      job->dst[i] = task->rotation[k] ? nearestTurn(v, job->src[i]) : v;
+    }
+  free(in);
+}
+
+void filterMotion(const Clip *clip, const float *src, float *dst,
+                  const FilterParams *p, int numThreads) {
+  size_t size = (size_t)clip->totalFrames * clip->totalChannels;
+  if (p->type == FILTER_NONE || clip->totalFrames < 2) {
+    if (dst != src)
+      memcpy(dst, src, size * sizeof(float));
+    return;
+  }
+
+  FilterJob job = {clip, src, dst, p};
+  job.window = p->window < 1 ? 1 : p->window;
+  if (job.window > SAVGOL_MAX_WINDOW)
+    job.window = SAVGOL_MAX_WINDOW;
+  int degree = p->degree < 0 ? 0 : p->degree;
+  if (degree > SAVGOL_MAX_DEGREE)
+    degree = SAVGOL_MAX_DEGREE;
+  if (degree > 2 * job.window)
+    degree = 2 * job.window;
+  savgolCoefficients(job.window, degree, job.coef);
+  butterworthBiquad(p->cutoff, clip->frameTime, &job.biquad);
+
+  // Grupos de 4 canais; no modo quaternion, os 3 angulos de cada nodo com
+  // rotacao contigua viram uma tarefa propria
+  job.tasks = calloc(clip->totalChannels, sizeof(FilterTask));
+  int numTasks = 0;
+  FilterTask *group = NULL;
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    if (node->channelOffset < 0)
+      continue;
+    int quatTrack = p->type == FILTER_QUAT && node->rotationChannel >= 0;
+    if (quatTrack) {
+      FilterTask *task = &job.tasks[numTasks++];
+      task->node = node;
+      for (int k = 0; k < 3; k++)
+        task->channel[k] = node->channelOffset + node->rotationChannel + k;
+    }
+    for (int c = 0; c < node->channels; c++) {
+      int rotation = node->channelOrder[c] < 'a';
+      if (quatTrack && rotation)
+        continue;
+      if (!group || group->count == 4)
+        group = &job.tasks[numTasks++];
+      group->rotation[group->count] = rotation;
+      group->channel[group->count++] = node->channelOffset + c;
+    }
+  }
+  parallelFor(numTasks, numThreads, filterTask, &job);
+  free(job.tasks);
+}
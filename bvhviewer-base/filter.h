@@ -0,0 +1,35 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "bvh.h"
+
+// Filtros de suavizacao do movimento
+enum {
+  FILTER_NONE,
+  FILTER_SAVGOL,      // Savitzky-Golay (polinomio local), todos os canais
+  FILTER_BUTTERWORTH, // passa-baixas de 2a ordem, ida e volta (fase zero)
+  FILTER_QUAT,        // Savitzky-Golay nos quaternions das rotacoes
+  FILTER_COUNT
+};
+
+typedef struct {
+  int type;     // FILTER_*
+  int window;   // Savitzky-Golay: meia janela (frames de cada lado)
+  int degree;   // Savitzky-Golay: grau do polinomio
+  float cutoff; // Butterworth: frequencia de corte (Hz)
+} FilterParams;
+
+void defaultFilterParams(FilterParams *p);
+const char *filterName(int type);
+// Tipo a partir do nome ("savgol", "butter", "quat"); -1 se desconhecido
+int filterType(const char *name);
+
+// Filtra o movimento src (clip->totalFrames x clip->totalChannels, como
+// clip->motion) para dst, que pode ser o proprio src. Os canais sao
+// processados em grupos de 4 (SSE), em paralelo entre os grupos. Os
+// angulos de saida ficam na mesma volta (multiplo de 360) que os de src.
+// As trilhas de quaternions do clip (se houver) devem ser refeitas depois.
+void filterMotion(const Clip *clip, const float *src, float *dst,
+                  const FilterParams *p, int numThreads);
+
+#endif
@@ -0,0 +1,250 @@
+// **********************************************************************
+//	frameindex.c
+//  Indice de frames do bloco MOTION para acesso aleatorio (mmap)
+// **********************************************************************
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "frameindex.h"
+#include "parallel.h"
+
+#define FRAME_INDEX_MAGIC "BVHFIDX1"
+// Frames por tarefa de decodeFrames
+#define DECODE_BLOCK 64
+
+// Cabecalho do arquivo de indice (seguido de frames + 1 posicoes)
+typedef struct {
+  char magic[8];
+  uint64_t size;  // tamanho do BVH indexado
+  int64_t mtime;  // data de modificacao do BVH
+  uint64_t motion; // inicio do primeiro frame
+  uint32_t frames, channels;
+} FrameIndexHeader;
+
+static int isBlankLine(const char *p, const char *end) {
+  for (; p < end && *p != '\n'; p++)
+    if (*p != ' ' && *p != '\t' && *p != '\r')
+      return 0;
+  return 1;
+}
+
+int scanFrameOffsets(const char *text, size_t size, size_t start,
+                     unsigned long long **offsets) {
+  size_t cap = 1024;
+  int count = 0;
+  unsigned long long *out = malloc(cap * sizeof(*out));
+  const char *end = text + size;
+  size_t pos = start;
+
+  // Cada linha comeca em start ou logo apos um '\n'
+#define ADD_LINE(p)                                                          \
+  do {                                                                       \
+    if (!isBlankLine(text + (p), end)) {                                     \
+      if ((size_t)count + 2 > cap) {                                         \
+        cap *= 2;                                                            \
+        out = realloc(out, cap * sizeof(*out));                              \
+      }                                                                      \
+      out[count++] = (p);                                                    \
+    }                                                                        \
+  } while (0)
+
+  if (pos < size)
+    ADD_LINE(pos);
+#ifdef __SSE2__
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(text + pos));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+    while (mask) {
+      size_t next = pos + __builtin_ctz(mask) + 1;
+      mask &= mask - 1;
+      if (next < size)
+        ADD_LINE(next);
+    }
+  }
+#endif
+  for (; pos < size; pos++)
+    if (text[pos] == '\n' && pos + 1 < size)
+      ADD_LINE(pos + 1);
+#undef ADD_LINE
+
+  out[count] = size;
+  *offsets = out;
+  return count;
+}
+
+static void sidecarPath(const char *path, char *out, size_t size) {
+  snprintf(out, size, "%s%s", path, FRAME_INDEX_SUFFIX);
+}
+
+// Le o indice gravado, se ainda corresponder ao arquivo. As posicoes sao
+// conferidas (crescentes, dentro do bloco MOTION e terminando no fim do
+// arquivo): um indice corrompido ou de outra ferramenta faria decodeFrame
+// ler fora do mapeamento
+static int readSidecar(FrameIndex *index, const char *path,
+                       const struct stat *st, size_t motion) {
+  char name[1024];
+  sidecarPath(path, name, sizeof(name));
+  FILE *file = fopen(name, "rb");
+  if (!file)
+    return 0;
+  FrameIndexHeader h;
+  int ok = fread(&h, sizeof(h), 1, file) == 1 &&
+           memcmp(h.magic, FRAME_INDEX_MAGIC, 8) == 0 &&
+           h.size == (uint64_t)st->st_size &&
+           h.mtime == (int64_t)st->st_mtime &&
+           h.channels == (uint32_t)index->clip->totalChannels &&
+           (uint64_t)h.frames + 1 <= h.size;
+  if (ok) {
+    size_t count = (size_t)h.frames + 1;
+    unsigned long long *offsets = malloc(count * sizeof(*offsets));
+    index->offsets = offsets;
+    ok = fread(offsets, sizeof(*offsets), count, file) == count &&
+         offsets[0] >= motion && offsets[h.frames] == h.size;
+    for (size_t f = 1; ok && f < count; f++)
+      ok = offsets[f] > offsets[f - 1];
+    index->frames = h.frames;
+  }
+  fclose(file);
+  return ok;
+}
+
+static void writeSidecar(const FrameIndex *index, const char *path,
+                         const struct stat *st) {
+  char name[1024], tmp[1100];
+  sidecarPath(path, name, sizeof(name));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", name);
+  FILE *file = fopen(tmp, "wb");
+  if (!file)
+    return; // diretorio somente leitura: o indice fica so em memoria
+  FrameIndexHeader h = {FRAME_INDEX_MAGIC};
+  h.size = st->st_size;
+  h.mtime = st->st_mtime;
+  h.motion = index->frames ? index->offsets[0] : index->size;
+  h.frames = index->frames;
+  h.channels = index->clip->totalChannels;
+  int ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+           fwrite(index->offsets, sizeof(unsigned long long),
+                  index->frames + 1, file) == (size_t)index->frames + 1;
+  if (fclose(file) != 0 || !ok || rename(tmp, name) != 0)
+    remove(tmp);
+}
+
+FrameIndex *openFrameIndex(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    printf("Erro: nao foi possivel abrir %s\n", path);
+    return NULL;
+  }
+  FrameIndex *index = calloc(1, sizeof(FrameIndex));
+  index->clip = readClipHeader(file);
+  long motion = ftell(file);
+  struct stat st;
+  if (!index->clip || motion < 0 || fstat(fileno(file), &st) != 0) {
+    fclose(file);
+    closeFrameIndex(index);
+    return NULL;
+  }
+  index->size = st.st_size;
+  index->text = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE,
+                     fileno(file), 0);
+  fclose(file);
+  if (index->text == MAP_FAILED) {
+    printf("Erro: nao foi possivel mapear %s\n", path);
+    index->text = NULL;
+    closeFrameIndex(index);
+    return NULL;
+  }
+  madvise((void *)index->text, index->size, MADV_RANDOM);
+
+  if (readSidecar(index, path, &st, motion))
+    index->fromSidecar = 1;
+  else {
+    free(index->offsets);
+    index->frames =
+        scanFrameOffsets(index->text, index->size, motion, &index->offsets);
+    writeSidecar(index, path, &st);
+  }
+  if (index->frames != index->clip->totalFrames)
+    printf("Aviso: %s declara %d frames, mas tem %d\n", path,
+           index->clip->totalFrames, index->frames);
+  return index;
+}
+
+void closeFrameIndex(FrameIndex *index) {
+  if (!index)
+    return;
+  if (index->text)
+    munmap((void *)index->text, index->size);
+  free(index->offsets);
+  freeClip(index->clip);
+  free(index);
+}
+
+int decodeFrame(const FrameIndex *index, int frame, float *values) {
+  if (frame < 0 || frame >= index->frames)
+    return 0;
+  // A linha e copiada para um buffer terminado em '\0': o texto mapeado
+  // nao tem terminador e strtof nao pode passar para o frame seguinte
+  size_t begin = index->offsets[frame], end = index->offsets[frame + 1];
+  char stack[4096], *line = stack;
+  if (end - begin >= sizeof(stack))
+    line = malloc(end - begin + 1);
+  memcpy(line, index->text + begin, end - begin);
+  line[end - begin] = '\0';
+  char *newline = strchr(line, '\n');
+  if (newline)
+    *newline = '\0';
+  int read = (int)parseValues(line, values, index->clip->totalChannels);
+  if (line != stack)
+    free(line);
+  return read;
+}
+
+typedef struct {
+  const FrameIndex *index;
+  int first, count;
+  float *out;
+  int *complete; // frames decodificados por bloco
+} DecodeJob;
+
+static void decodeBlock(int b, int thread, void *ctx) {
+  DecodeJob *job = ctx;
+  int channels = job->index->clip->totalChannels;
+  int end = (b + 1) * DECODE_BLOCK;
+  if (end > job->count)
+    end = job->count;
+  for (int f = b * DECODE_BLOCK; f < end; f++)
+    if (decodeFrame(job->index, job->first + f,
+                    job->out + (size_t)f * channels) == channels)
+      job->complete[b]++;
+}
+
+int decodeFrames(const FrameIndex *index, int first, int count, float *out,
+                 int numThreads) {
+  if (first < 0)
+    first = 0;
+  if (first + count > index->frames)
+    count = index->frames - first;
+  if (count <= 0)
+    return 0;
+  int blocks = (count + DECODE_BLOCK - 1) / DECODE_BLOCK;
+  DecodeJob job = {index, first, count, out, calloc(blocks, sizeof(int))};
+  parallelFor(blocks, numThreads, decodeBlock, &job);
+  int complete = 0;
+  for (int b = 0; b < blocks; b++)
+    complete += job.complete[b];
+  free(job.complete);
+  return complete;
+}
@@ -0,0 +1,43 @@
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <stddef.h>
+
+#include "bvh.h"
+
+// Indice de frames de um arquivo BVH: a posicao (em bytes) do inicio de
+// cada linha de frame no bloco MOTION. Com ele qualquer frame e decodificado
+// direto do texto mapeado em memoria, sem ler os anteriores.
+//
+// O indice fica num arquivo ao lado do BVH (caminho + FRAME_INDEX_SUFFIX),
+// valido enquanto o tamanho e a data de modificacao do BVH nao mudarem.
+#define FRAME_INDEX_SUFFIX ".fidx"
+
+typedef struct {
+  Clip *clip;         // hierarquia e cabecalho (readClipHeader, sem motion)
+  const char *text;   // arquivo inteiro, mapeado (somente leitura)
+  size_t size;
+  int frames;         // frames encontrados no texto
+  unsigned long long *offsets; // frames + 1 posicoes (a ultima = fim)
+  int fromSidecar;    // 1 se o indice foi lido do arquivo ao lado
+} FrameIndex;
+
+// Mapeia o arquivo e carrega o indice (ou o constroi e tenta grava-lo).
+// NULL em caso de erro
+FrameIndex *openFrameIndex(const char *path);
+void closeFrameIndex(FrameIndex *index);
+
+// Posicoes dos inicios de linha nao vazias de text[start, size), com
+// busca de quebras de linha em SSE2. *offsets recebe count + 1 posicoes
+int scanFrameOffsets(const char *text, size_t size, size_t start,
+                     unsigned long long **offsets);
+
+// Decodifica um frame (clip->totalChannels valores). Retorna a qtd de
+// valores lidos
+int decodeFrame(const FrameIndex *index, int frame, float *values);
+// Decodifica os frames [first, first + count) em paralelo, dividindo o
+// intervalo nos limites do indice. Retorna a qtd de frames completos
+int decodeFrames(const FrameIndex *index, int first, int count, float *out,
+                 int numThreads);
+
+#endif
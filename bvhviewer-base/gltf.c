@@ -0,0 +1,320 @@
+// **********************************************************************
+//	gltf.c
+//  Exportacao de um clip para glTF 2.0 binario (.glb)
+// **********************************************************************
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gltf.h"
+#include "parallel.h"
+#include "quat.h"
+
+#define GLB_MAGIC 0x46546C67
+#define GLB_JSON 0x4E4F534A
+#define GLB_BIN 0x004E4942
+#define GL_FLOAT_TYPE 5126
+
+// Trilha de animacao de um nodo
+typedef struct {
+  int node;      // indice do nodo animado
+  int rotation;  // 1 = rotacao (quaternion), 0 = translacao
+  int channel;   // primeiro canal da trilha no frame
+  int numKeys;   // keyframes mantidos
+  int *keys;     // frames dos keyframes (NULL = todos os frames)
+  float *values; // numKeys * (4 ou 3)
+} Track;
+
+typedef struct {
+  const Clip *clip;
+  const GltfOptions *opt;
+  Track *tracks;
+} EncodeJob;
+
+// Texto crescente para montar o JSON
+typedef struct {
+  char *data;
+  size_t length, cap;
+} Text;
+
+static void textPrintf(Text *t, const char *fmt, ...) {
+  va_list args;
+  for (;;) {
+    va_start(args, fmt);
+    int n = vsnprintf(t->data + t->length, t->cap - t->length, fmt, args);
+    va_end(args);
+    if (n >= 0 && (size_t)n < t->cap - t->length) {
+      t->length += n;
+      return;
+    }
+    t->cap = t->cap ? t->cap * 2 : 4096;
+    t->data = realloc(t->data, t->cap);
+  }
+}
+
+// Binario crescente (o chunk BIN)
+typedef struct {
+  unsigned char *data;
+  size_t length, cap;
+} Blob;
+
+static size_t blobAppend(Blob *b, const void *data, size_t size) {
+  if (b->length + size > b->cap) {
+    while (b->length + size > b->cap)
+      b->cap = b->cap ? b->cap * 2 : 65536;
+    b->data = realloc(b->data, b->cap);
+  }
+  size_t offset = b->length;
+  memcpy(b->data + offset, data, size);
+  b->length += size;
+  return offset;
+}
+
+void defaultGltfOptions(GltfOptions *opt) {
+  opt->scale = 0.01f;
+  opt->tolerance = 0;
+  opt->numThreads = 0;
+}
+
+// Erro (graus ou unidades) ao interpolar entre os keys a e b no frame f
+static float keyError(const Track *t, const float *values, int a, int b,
+                      int f) {
+  float u = (float)(f - a) / (b - a);
+  const float *va, *vb, *vf;
+  if (t->rotation) {
+    float q[4];
+    va = values + a * 4, vb = values + b * 4, vf = values + f * 4;
+    quatNlerp(va, vb, u, q);
+    float d = fabsf(q[0] * vf[0] + q[1] * vf[1] + q[2] * vf[2] + q[3] * vf[3]);
+    return d >= 1 ? 0 : 2 * acosf(d) * (float)(180.0 / M_PI);
+  }
+  va = values + a * 3, vb = values + b * 3, vf = values + f * 3;
+  float e = 0;
+  for (int k = 0; k < 3; k++) {
+    float d = va[k] + (vb[k] - va[k]) * u - vf[k];
+    e += d * d;
+  }
+  return sqrtf(e);
+}
+
+// Reducao gulosa: estende cada segmento enquanto a interpolacao linear
+// entre suas pontas representa todos os frames internos
+static void reduceTrack(Track *t, const float *values, int frames,
+                        float tolerance) {
+  int comps = t->rotation ? 4 : 3;
+  t->keys = malloc(frames * sizeof(int));
+  t->values = malloc((size_t)frames * comps * sizeof(float));
+  int numKeys = 0, start = 0;
+  t->keys[numKeys++] = 0;
+  for (int end = 2; end < frames; end++) {
+    int ok = 1;
+    for (int f = start + 1; f < end && ok; f++)
+      ok = keyError(t, values, start, end, f) <= tolerance;
+    if (!ok) {
+      start = end - 1;
+      t->keys[numKeys++] = start;
+    }
+  }
+  if (frames > 1)
+    t->keys[numKeys++] = frames - 1;
+  for (int k = 0; k < numKeys; k++)
+    memcpy(t->values + k * comps, values + (size_t)t->keys[k] * comps,
+           comps * sizeof(float));
+  t->numKeys = numKeys;
+}
+
+static void encodeTrack(int i, int thread, void *ctx) {
+  EncodeJob *job = ctx;
+  const Clip *clip = job->clip;
+  Track *t = &job->tracks[i];
+  int frames = clip->totalFrames;
+  int comps = t->rotation ? 4 : 3;
+  float *values = malloc((size_t)frames * comps * sizeof(float));
+
+  if (t->rotation)
+    eulerToQuats(clip->motion + t->channel, clip->totalChannels,
+                 clip->nodes[t->node]->rotationOrder, frames, values, 4);
+  else
+    for (int f = 0; f < frames; f++)
+      for (int k = 0; k < 3; k++)
+        values[f * 3 + k] = clip->data[f][t->channel + k];
+
+  if (job->opt->tolerance > 0) {
+    reduceTrack(t, values, frames, job->opt->tolerance);
+    free(values);
+  } else {
+    t->keys = NULL;
+    t->numKeys = frames;
+    t->values = values;
+  }
+  if (!t->rotation)
+    for (int k = 0; k < t->numKeys * 3; k++)
+      t->values[k] *= job->opt->scale;
+}
+
+static void writeName(Text *json, const char *name) {
+  textPrintf(json, "\"");
+  for (const char *c = name; *c; c++)
+    if (*c == '"' || *c == '\\')
+      textPrintf(json, "\\%c", *c);
+    else if ((unsigned char)*c >= 0x20)
+      textPrintf(json, "%c", *c);
+  textPrintf(json, "\"");
+}
+
+// Acrescenta um bufferView + accessor de floats e devolve o accessor
+static int addAccessor(Text *accessors, Text *views, Blob *bin, int *count,
+                       const float *data, int n, const char *type, int comps,
+                       int withRange) {
+  size_t offset = blobAppend(bin, data, (size_t)n * comps * sizeof(float));
+  textPrintf(views, "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}",
+             *count ? "," : "", offset, (size_t)n * comps * sizeof(float));
+  textPrintf(accessors,
+             "%s{\"bufferView\":%d,\"componentType\":%d,\"count\":%d,"
+             "\"type\":\"%s\"",
+             *count ? "," : "", *count, GL_FLOAT_TYPE, n, type);
+  if (withRange)
+    textPrintf(accessors, ",\"min\":[%.9g],\"max\":[%.9g]", data[0],
+               data[n - 1]);
+  textPrintf(accessors, "}");
+  return (*count)++;
+}
+
+int exportGlb(const Clip *clip, const char *name, const char *path,
+              const GltfOptions *opt) {
+  int frames = clip->totalFrames;
+
+  // Uma trilha de rotacao por junta animada e uma de translacao na raiz
+  Track *tracks = calloc(clip->numNodes + 1, sizeof(Track));
+  int numTracks = 0;
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    if (node->channelOffset < 0)
+      continue;
+    if (node->channels == 6 && strncmp(node->channelOrder, "xyz", 3) == 0) {
+      tracks[numTracks].node = i;
+      tracks[numTracks].rotation = 0;
+      tracks[numTracks++].channel = node->channelOffset;
+    }
+    if (node->rotationChannel >= 0) {
+      tracks[numTracks].node = i;
+      tracks[numTracks].rotation = 1;
+      tracks[numTracks++].channel = node->channelOffset + node->rotationChannel;
+    }
+  }
+  EncodeJob job = {clip, opt, tracks};
+  parallelFor(numTracks, opt->numThreads, encodeTrack, &job);
+
+  Text nodes = {0}, accessors = {0}, views = {0}, samplers = {0},
+       channels = {0}, json = {0};
+  Blob bin = {0};
+  int numAccessors = 0;
+
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    textPrintf(&nodes, "%s{\"name\":", i ? "," : "");
+    if (node->numChildren == 0 && node->parent) {
+      char endName[64];
+      snprintf(endName, sizeof(endName), "%s_End", node->parent->name);
+      writeName(&nodes, endName);
+    } else
+      writeName(&nodes, node->name);
+    textPrintf(&nodes, ",\"translation\":[%.9g,%.9g,%.9g]",
+               node->offset[0] * opt->scale, node->offset[1] * opt->scale,
+               node->offset[2] * opt->scale);
+    if (node->numChildren > 0) {
+      textPrintf(&nodes, ",\"children\":[");
+      for (Node *child = node->children; child; child = child->next)
+        textPrintf(&nodes, "%d%s", child->index, child->next ? "," : "]");
+    }
+    textPrintf(&nodes, "}");
+  }
+
+  // Tempos de todos os frames (compartilhados se nao houver reducao)
+  float *times = malloc(frames * sizeof(float));
+  float dt = clip->frameTime > 0 ? clip->frameTime : 1.0f / 30.0f;
+  for (int f = 0; f < frames; f++)
+    times[f] = f * dt;
+  int sharedTimes = -1;
+  if (opt->tolerance <= 0)
+    sharedTimes = addAccessor(&accessors, &views, &bin, &numAccessors, times,
+                              frames, "SCALAR", 1, 1);
+
+  for (int t = 0; t < numTracks; t++) {
+    Track *track = &tracks[t];
+    int input = sharedTimes;
+    if (track->keys) {
+      float *keyTimes = malloc(track->numKeys * sizeof(float));
+      for (int k = 0; k < track->numKeys; k++)
+        keyTimes[k] = times[track->keys[k]];
+      input = addAccessor(&accessors, &views, &bin, &numAccessors, keyTimes,
+                          track->numKeys, "SCALAR", 1, 1);
+      free(keyTimes);
+    }
+    int output = addAccessor(&accessors, &views, &bin, &numAccessors,
+                             track->values, track->numKeys,
+                             track->rotation ? "VEC4" : "VEC3",
+                             track->rotation ? 4 : 3, 0);
+    textPrintf(&samplers,
+               "%s{\"input\":%d,\"output\":%d,\"interpolation\":\"LINEAR\"}",
+               t ? "," : "", input, output);
+    textPrintf(&channels,
+               "%s{\"sampler\":%d,\"target\":{\"node\":%d,\"path\":\"%s\"}}",
+               t ? "," : "", t, track->node,
+               track->rotation ? "rotation" : "translation");
+    free(track->keys);
+    free(track->values);
+  }
+  free(times);
+  free(tracks);
+
+  textPrintf(&json, "{\"asset\":{\"version\":\"2.0\",\"generator\":\"bvh2glb\"},"
+                    "\"scene\":0,\"scenes\":[{\"name\":");
+  writeName(&json, name);
+  textPrintf(&json, ",\"nodes\":[0]}],\"nodes\":[%s],", nodes.data);
+  textPrintf(&json, "\"buffers\":[{\"byteLength\":%zu}],", bin.length);
+  textPrintf(&json, "\"bufferViews\":[%s],\"accessors\":[%s],", views.data,
+             accessors.data);
+  textPrintf(&json, "\"animations\":[{\"name\":");
+  writeName(&json, name);
+  textPrintf(&json, ",\"samplers\":[%s],\"channels\":[%s]}]}",
+             samplers.data ? samplers.data : "",
+             channels.data ? channels.data : "");
+
+  // Os chunks precisam ter tamanho multiplo de 4
+  while (json.length % 4)
+    textPrintf(&json, " ");
+  static const unsigned char zeros[4] = {0};
+  blobAppend(&bin, zeros, (4 - bin.length % 4) % 4);
+
+  int ok = 0;
+  FILE *file = fopen(path, "wb");
+  if (file) {
+    uint32_t header[3] = {GLB_MAGIC, 2,
+                          (uint32_t)(12 + 8 + json.length + 8 + bin.length)};
+    uint32_t jsonChunk[2] = {(uint32_t)json.length, GLB_JSON};
+    uint32_t binChunk[2] = {(uint32_t)bin.length, GLB_BIN};
+    fwrite(header, sizeof(header), 1, file);
+    fwrite(jsonChunk, sizeof(jsonChunk), 1, file);
+    fwrite(json.data, 1, json.length, file);
+    fwrite(binChunk, sizeof(binChunk), 1, file);
+    fwrite(bin.data, 1, bin.length, file);
+    ok = !ferror(file);
+    fclose(file);
+  }
+  if (!ok)
+    printf("Erro: nao foi possivel gravar %s\n", path);
+
+  free(nodes.data);
+  free(accessors.data);
+  free(views.data);
+  free(samplers.data);
+  free(channels.data);
+  free(json.data);
+  free(bin.data);
+  return ok;
+}
@@ -0,0 +1,21 @@
+#ifndef GLTF_H
+#define GLTF_H
+
+#include "bvh.h"
+
+typedef struct GltfOptions {
+  float scale;        // fator para offsets e translacoes (0.01: cm -> m)
+  float tolerance;    // reducao de keyframes: erro maximo em graus (rotacao)
+                      // e em unidades do arquivo (translacao); 0 = desligada
+  int numThreads;     // threads para converter as juntas (<= 0: todas)
+} GltfOptions;
+
+void defaultGltfOptions(GltfOptions *opt);
+
+// Exporta o clip como glTF binario (.glb): um no por Node, uma animacao
+// com a rotacao (quaternion) de cada junta e a translacao da raiz.
+// Retorna 0 em caso de erro
+int exportGlb(const Clip *clip, const char *name, const char *path,
+              const GltfOptions *opt);
+
+#endif
@@ -0,0 +1,121 @@
+// **********************************************************************
+//	image.c
+//  Gravacao de imagens PNG sem dependencias (zlib opcional)
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "image.h"
+
+// CRC-32 dos chunks (bit a bit: os dados comprimidos sao pequenos)
+static unsigned long crc(unsigned long c, const unsigned char *data,
+                         size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    c ^= data[i];
+    for (int k = 0; k < 8; k++)
+      c = c & 1 ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+  }
+  return c;
+}
+
+static void put32(unsigned char *p, unsigned long v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static void writeChunk(FILE *file, const char *type, const unsigned char *data,
+                       size_t size) {
+  unsigned char word[4];
+  put32(word, size);
+  fwrite(word, 4, 1, file);
+  fwrite(type, 4, 1, file);
+  fwrite(data, 1, size, file);
+  unsigned long c = crc(0xffffffffUL, (const unsigned char *)type, 4);
+  put32(word, crc(c, data, size) ^ 0xffffffffUL);
+  fwrite(word, 4, 1, file);
+}
+
+// Stream zlib com blocos "stored" (sem compressao)
+static unsigned char *storeDeflate(const unsigned char *raw, size_t size,
+                                   size_t *outSize) {
+  size_t blocks = size / 65535 + 1;
+  unsigned char *out = malloc(2 + size + blocks * 5 + 4), *p = out;
+  unsigned long a = 1, b = 0;
+  *p++ = 0x78;
+  *p++ = 0x01;
+  for (size_t pos = 0;;) {
+    size_t len = size - pos > 65535 ? 65535 : size - pos;
+    *p++ = pos + len == size;
+    p[0] = len & 0xff;
+    p[1] = len >> 8;
+    p[2] = ~len & 0xff;
+    p[3] = (~len >> 8) & 0xff;
+    memcpy(p + 4, raw + pos, len);
+    p += 4 + len;
+    pos += len;
+    if (pos == size)
+      break;
+  }
+  for (size_t i = 0; i < size; i++) {
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  put32(p, (b << 16) | a);
+  *outSize = p + 4 - out;
+  return out;
+}
+
+int writePng(const char *path, int width, int height,
+             const unsigned char *rgb) {
+  static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  // Cada linha comeca com o filtro 0 (nenhum)
+  size_t stride = (size_t)width * 3, rawSize = (stride + 1) * height;
+  unsigned char *raw = malloc(rawSize);
+  for (int y = 0; y < height; y++) {
+    raw[y * (stride + 1)] = 0;
+    memcpy(raw + y * (stride + 1) + 1, rgb + y * stride, stride);
+  }
+
+  size_t size;
+  unsigned char *idat;
+#ifdef HAVE_ZLIB
+  uLongf bound = compressBound(rawSize);
+  idat = malloc(bound);
+  if (compress2(idat, &bound, raw, rawSize, 6) != Z_OK) {
+    free(idat);
+    idat = storeDeflate(raw, rawSize, &size);
+  } else
+    size = bound;
+#else
+  idat = storeDeflate(raw, rawSize, &size);
+#endif
+  free(raw);
+
+  int ok = 0;
+  FILE *file = fopen(path, "wb");
+  if (file) {
+    unsigned char header[13] = {0};
+    put32(header, width);
+    put32(header + 4, height);
+    header[8] = 8; // bits por componente
+    header[9] = 2; // RGB
+    fwrite(signature, sizeof(signature), 1, file);
+    writeChunk(file, "IHDR", header, sizeof(header));
+    writeChunk(file, "IDAT", idat, size);
+    writeChunk(file, "IEND", NULL, 0);
+    ok = !ferror(file);
+    fclose(file);
+  }
+  if (!ok)
+    printf("Erro: nao foi possivel gravar %s\n", path);
+  free(idat);
+  return ok;
+}
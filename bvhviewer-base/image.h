@@ -0,0 +1,10 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+// Grava uma imagem RGB de 8 bits (linha 0 = topo) como PNG. Com zlib
+// (HAVE_ZLIB) os dados sao comprimidos; sem ela vao em blocos deflate
+// sem compressao, ainda validos. Retorna 0 em caso de erro
+int writePng(const char *path, int width, int height,
+             const unsigned char *rgb);
+
+#endif
@@ -0,0 +1,247 @@
+// **********************************************************************
+//	loop.c
+//  Deteccao de pontos de loop pela matriz de distancias entre as poses
+//  de todos os frames (auto-similaridade)
+// **********************************************************************
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "loop.h"
+#include "parallel.h"
+#include "rootmotion.h"
+
+// Frames por lado de um bloco da matriz: dois blocos de descritores
+// (64 x ~170 floats) cabem juntos na cache L2. Cada faixa de LOOP_TILE
+// linhas (mais a de cima e a de baixo, para a vizinhanca dos minimos) e
+// calculada num buffer da thread e descartada em seguida: a memoria fica
+// em (LOOP_TILE + 2) x frames floats por thread, e nao frames x frames
+#define LOOP_TILE 64
+
+void defaultLoopParams(LoopParams *p) {
+  p->minLength = 0.5f;
+  p->separation = 0.25f;
+  p->velocityWeight = 0.1f;
+  p->turnRadius = 50.0f;
+  p->numThreads = 0;
+}
+
+typedef struct {
+  Clip *clip;
+  const LoopParams *params;
+  float *features; // frames x dim
+  int dim;         // multiplo de 4
+  float **world;   // pose de cada thread
+  int numThreads;
+} FeatureJob;
+
+// Descritor do frame: posicoes relativas a raiz, velocidades delas e
+// velocidade da raiz (frente, lado, giro)
+static void frameFeatures(int f, int thread, void *ctx) {
+  FeatureJob *job = ctx;
+  Clip *clip = job->clip;
+  int n = clip->numNodes, last = clip->totalFrames - 1;
+  float *out = job->features + (size_t)f * job->dim;
+  float *world = job->world[thread], *next = world + n * 16;
+  float w = job->params->velocityWeight;
+  // Velocidade pela diferenca para o frame seguinte (anterior no ultimo)
+  int g = f < last ? f + 1 : f - 1;
+  float dt = clip->frameTime > 0 ? clip->frameTime : 1;
+  float scale = (f < last ? w : -w) / dt;
+  computePose(clip, relativeFrame(clip, f), world);
+  computePose(clip, relativeFrame(clip, g), next);
+  for (int i = 0; i < n; i++)
+    for (int k = 0; k < 3; k++) {
+      float p = world[i * 16 + 12 + k];
+      out[i * 3 + k] = p;
+      out[n * 3 + i * 3 + k] = (next[i * 16 + 12 + k] - p) * scale;
+    }
+  float *root = out + n * 6;
+  root[0] = rootTrack(clip, ROOT_FORWARD)[f] * w;
+  root[1] = rootTrack(clip, ROOT_LATERAL)[f] * w;
+  root[2] = rootTrack(clip, ROOT_TURN)[f] * job->params->turnRadius * w;
+  for (int k = n * 6 + 3; k < job->dim; k++)
+    out[k] = 0;
+}
+
+// Candidatos achados numa faixa de linhas, em ordem de (in, out)
+typedef struct {
+  LoopCandidate *items;
+  int count, cap;
+} CandidateList;
+
+typedef struct {
+  const float *features;
+  const float *norms; // |descritor|^2 de cada frame
+  int dim, frames, minGap, numNodes;
+  int tiles;          // faixas de LOOP_TILE linhas
+  float **rows;       // buffer de cada thread: (LOOP_TILE + 2) x frames
+  CandidateList *found; // um por faixa
+} MatrixJob;
+
+// Distancias ao quadrado entre os frames [i0, i1) e [j0, j1):
+// |a|^2 + |b|^2 - 2 a.b, quatro produtos escalares por vez. A linha i
+// vai para dist + (i - base) * frames
+static void tileDistances(const MatrixJob *job, float *dist, int base,
+                          int i0, int i1, int j0, int j1) {
+  int dim = job->dim;
+  for (int i = i0; i < i1; i++) {
+    const float *a = job->features + (size_t)i * dim;
+    float *row = dist + (size_t)(i - base) * job->frames;
+    int j = j0;
+#ifdef __SSE__
+    for (; j + 4 <= j1; j += 4) {
+      const float *b = job->features + (size_t)j * dim;
+      __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+      for (int k = 0; k < dim; k += 4) {
+        __m128 va = _mm_loadu_ps(a + k);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(va, _mm_loadu_ps(b + k)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(va, _mm_loadu_ps(b + dim + k)));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(va, _mm_loadu_ps(b + 2 * dim + k)));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(va, _mm_loadu_ps(b + 3 * dim + k)));
+      }
+      // Soma horizontal dos quatro acumuladores de uma vez
+      _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+      __m128 dot = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+      __m128 d = _mm_sub_ps(
+          _mm_add_ps(_mm_set1_ps(job->norms[i]), _mm_loadu_ps(job->norms + j)),
+          _mm_add_ps(dot, dot));
+      _mm_storeu_ps(row + j, _mm_max_ps(d, _mm_setzero_ps()));
+    }
+#endif
+    for (; j < j1; j++) {
+      const float *b = job->features + (size_t)j * dim;
+      float dot = 0;
+      for (int k = 0; k < dim; k++)
+        dot += a[k] * b[k];
+      float d = job->norms[i] + job->norms[j] - 2 * dot;
+      row[j] = d > 0 ? d : 0;
+    }
+  }
+}
+
+// Tarefa ti: a faixa de linhas [i0, i1) em blocos de LOOP_TILE colunas,
+// e os minimos locais (vizinhanca 3x3) dela na regiao out >= in + minGap
+static void matrixRow(int ti, int thread, void *ctx) {
+  MatrixJob *job = ctx;
+  int frames = job->frames, minGap = job->minGap;
+  int i0 = ti * LOOP_TILE;
+  int i1 = i0 + LOOP_TILE < frames ? i0 + LOOP_TILE : frames;
+  int r0 = i0 > 0 ? i0 - 1 : 0, r1 = i1 < frames ? i1 + 1 : frames;
+  float *d = job->rows[thread];
+  // Blocos alinhados a LOOP_TILE (o primeiro pode comecar antes de
+  // r0 + minGap): cada coluna cai sempre no mesmo grupo de 4 do SSE
+  int first = (r0 + minGap) / LOOP_TILE * LOOP_TILE;
+  for (int j0 = first; j0 < frames; j0 += LOOP_TILE) {
+    int j1 = j0 + LOOP_TILE < frames ? j0 + LOOP_TILE : frames;
+    tileDistances(job, d, r0, r0, r1, j0, j1);
+  }
+
+  CandidateList *list = &job->found[ti];
+  for (int i = i0; i < i1; i++)
+    for (int j = i + minGap; j < frames; j++) {
+      float v = d[(size_t)(i - r0) * frames + j];
+      int minimum = 1;
+      for (int di = -1; di <= 1 && minimum; di++)
+        for (int dj = -1; dj <= 1; dj++) {
+          int a = i + di, b = j + dj;
+          if ((di || dj) && a >= 0 && a < frames && b < frames &&
+              b >= a + minGap && d[(size_t)(a - r0) * frames + b] < v) {
+            minimum = 0;
+            break;
+          }
+        }
+      if (!minimum)
+        continue;
+      if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 16;
+        list->items = realloc(list->items, list->cap * sizeof(LoopCandidate));
+      }
+      list->items[list->count++] =
+          (LoopCandidate){i, j, sqrtf(v / job->numNodes)};
+    }
+}
+
+static int compareCandidates(const void *a, const void *b) {
+  const LoopCandidate *x = a, *y = b;
+  if (x->cost != y->cost)
+    return x->cost < y->cost ? -1 : 1;
+  return (y->out - y->in) - (x->out - x->in); // empate: o mais longo
+}
+
+int findLoops(Clip *clip, const LoopParams *p, LoopCandidate *out, int max) {
+  int frames = clip->totalFrames;
+  float dt = clip->frameTime > 0 ? clip->frameTime : 1;
+  int minGap = (int)(p->minLength / dt + 0.5f);
+  int sep = (int)(p->separation / dt + 0.5f);
+  if (minGap < 1)
+    minGap = 1;
+  if (frames <= minGap || max <= 0)
+    return 0;
+  int threads = p->numThreads > 0 ? p->numThreads : defaultThreads();
+
+  buildRootMotion(clip, threads);
+  FeatureJob fj = {clip, p, NULL, (clip->numNodes * 6 + 3 + 3) & ~3,
+                   malloc(threads * sizeof(float *)), threads};
+  fj.features = malloc((size_t)frames * fj.dim * sizeof(float));
+  for (int t = 0; t < threads; t++)
+    fj.world[t] = malloc(clip->numNodes * 32 * sizeof(float));
+  parallelFor(frames, threads, frameFeatures, &fj);
+  for (int t = 0; t < threads; t++)
+    free(fj.world[t]);
+  free(fj.world);
+
+  float *norms = malloc(frames * sizeof(float));
+  for (int f = 0; f < frames; f++) {
+    const float *v = fj.features + (size_t)f * fj.dim;
+    float s = 0;
+    for (int k = 0; k < fj.dim; k++)
+      s += v[k] * v[k];
+    norms[f] = s;
+  }
+  MatrixJob mj = {fj.features, norms, fj.dim, frames, minGap,
+                  clip->numNodes, (frames + LOOP_TILE - 1) / LOOP_TILE,
+                  malloc(threads * sizeof(float *)), NULL};
+  mj.found = calloc(mj.tiles, sizeof(CandidateList));
+  for (int t = 0; t < threads; t++)
+    mj.rows[t] = malloc((size_t)(LOOP_TILE + 2) * frames * sizeof(float));
+  parallelFor(mj.tiles, threads, matrixRow, &mj);
+  for (int t = 0; t < threads; t++)
+    free(mj.rows[t]);
+  free(mj.rows);
+
+  // Junta as faixas na ordem das linhas
+  int count = 0;
+  for (int t = 0; t < mj.tiles; t++)
+    count += mj.found[t].count;
+  LoopCandidate *all = malloc((count ? count : 1) * sizeof(LoopCandidate));
+  count = 0;
+  for (int t = 0; t < mj.tiles; t++) {
+    memcpy(all + count, mj.found[t].items,
+           mj.found[t].count * sizeof(LoopCandidate));
+    count += mj.found[t].count;
+    free(mj.found[t].items);
+  }
+  free(mj.found);
+  qsort(all, count, sizeof(LoopCandidate), compareCandidates);
+
+  // Descarta os candidatos perto de um melhor ja aceito
+  int found = 0;
+  for (int c = 0; c < count && found < max; c++) {
+    int near = 0;
+    for (int k = 0; k < found && !near; k++)
+      near = abs(all[c].in - out[k].in) <= sep &&
+             abs(all[c].out - out[k].out) <= sep;
+    if (!near)
+      out[found++] = all[c];
+  }
+  free(all);
+  free(norms);
+  free(fj.features);
+  return found;
+}
@@ -0,0 +1,34 @@
+#ifndef LOOP_H
+#define LOOP_H
+
+#include "bvh.h"
+
+typedef struct LoopParams {
+  float minLength;      // menor loop (segundos)
+  float separation;     // distancia minima entre candidatos (segundos)
+  float velocityWeight; // peso das velocidades (s): velocidade * peso
+                        // entra na distancia como posicao
+  float turnRadius;     // giro do heading (rad/s) * raio vira velocidade
+  int numThreads;       // threads para a matriz (<= 0: todas)
+} LoopParams;
+
+void defaultLoopParams(LoopParams *p);
+
+// Um loop toca os frames [in, out) e volta para in; a costura e boa quando
+// o frame out e parecido com o in
+typedef struct LoopCandidate {
+  int in, out;
+  float cost; // distancia RMS por nodo entre os frames in e out (unidades)
+} LoopCandidate;
+
+// Procura os melhores pontos de loop do clip: descritor de cada frame com
+// as posicoes e velocidades dos nodos relativas a raiz (buildRootMotion) e
+// a velocidade da raiz; matriz de distancias entre todos os pares de
+// frames em blocos (SSE, faixas de linhas em paralelo, sem guardar a
+// matriz inteira); minimos locais da matriz, sem repetir candidatos
+// proximos. O custo cresce com frames^2: quem chama limita o tamanho do
+// clip. Grava ate max candidatos em out, do menor custo para o maior, e
+// retorna a qtd
+int findLoops(Clip *clip, const LoopParams *p, LoopCandidate *out, int max);
+
+#endif
@@ -10,424 +10,305 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "filter.h"
+#include "loop.h"
 #include "opengl.h"
+#include "parallel.h"
+#include "posepub.h"
+#include "quat.h"
+#include "reload.h"
+#include "stream.h"
+
+// Intervalo (ms) entre verificacoes de recarga do arquivo
+#define RELOAD_POLL_MS 100
+
+// Intervalo (ms) entre verificacoes de frames ao vivo (opcao -l)
+#define LIVE_POLL_MS 2
+
+// Destino e estado da gravacao de video (opengl.c)
+extern const char *capturePath;
+extern int frameDue;
+void toggleCapture();
+
+// Clip carregado (hierarquia + movimento)
+Clip *clip;
+
+// Malha deformada pelo esqueleto (opcional) e seus arquivos
+SkinnedMesh *mesh = NULL;
+char *meshPath = NULL, *weightsPath = NULL;
 
 // Raiz da hierarquia
 Node *root;
 
 float **data = NULL;
 int totalFrames = 0;
-int totalChannels = 0; 
-int frameCount = 0;
-int frameDataSize = 0;
-float *motionData = 0;
-
-#define MAX_LINE_LENGTH 256
-#define MAX_NAME_LENGTH 128
 
 // Frame atual
 int curFrame = 0;
 
+// Qtd de juntas recalculadas pelo ultimo apply()
+int recomputedJoints = 0;
+
+// Se diferente de zero, as rotacoes vem de trilhas de quaternions
+// convertidas na carga (opcao -q), em vez dos angulos de cada frame
+int useQuats = 0;
+
+// Filtro de suavizacao ativo (tecla 'f') e o movimento original do arquivo
+// (NULL enquanto nenhum filtro foi usado)
+FilterParams filter = {FILTER_NONE};
+float *rawMotion = NULL;
+
+// Reproducao automatica (tecla 'p'), um frame a cada clip->frameTime.
+// Cada inicio ganha um numero novo, para que um timer de uma reproducao
+// anterior ainda pendente nao avance frames em dobro.
+int playing = 0, playRun = 0;
+
+// Loop da reproducao (tecla 'l'): os frames [loopIn, loopOut) achados por
+// findLoops, de pelo menos LOOP_MIN_FRACTION da duracao do clip. Com custo
+// acima de LOOP_MAX_COST (ou sem loop) a reproducao volta ao frame 0.
+// loopReady = 0 pede um novo calculo (clipChanged). Clips com mais de
+// LOOP_MAX_FRAMES frames nao sao analisados (o custo e quadratico)
+#define LOOP_MIN_FRACTION 0.5f
+#define LOOP_MAX_COST 12.0f
+#define LOOP_CANDIDATES 3
+#define LOOP_MAX_FRAMES 20000
+int useLoop = 1, loopReady = 0, loopIn = 0, loopOut = 0;
+
+// Poses ao vivo (opcao -l): receptor, estatisticas de latencia do ultimo
+// segundo e inicio dessa janela
+StreamReceiver *live = NULL;
+StreamStats liveStats;
+double liveWindow = 0;
+
+// Publicacao da pose em memoria compartilhada (opcao -p) ou NULL
+PosePublisher *publisher = NULL;
+
 // Funcoes para liberacao de memoria da hierarquia
 void freeTree();
-void freeNode(Node *node);
-void parseMotion(FILE *file);
 
 // Funcao externa para inicializacao da OpenGL
 void init();
 
-// Funcao de teste para criar um esqueleto inicial
-void initMaleSkel();
-
-// Funcoes para criacao de nodos e aplicacao dos valores de um frame
-Node *createNode(char *name, Node *parent, int numChannels, float ofx,
-                 float ofy, float ofz);
-void applyData(float data[], Node *n);
+// Aplica o frame atual aos nodos
 void apply();
 
 // **********************************************************************
-//  Cria um nodo novo para a hierarquia, fazendo também a ligacao com
-//  o seu pai (se houver)
-//  Parametros:
-//  - name: string com o nome do nodo
-//  - parent: ponteiro para o nodo pai (NULL se for a raiz)
-//  - numChannels: quantidade de canais de transformacao (3 ou 6)
-//  - ofx, ofy, ofz: offset (deslocamento) lido do arquivo
+//  Procura o loop do clip atual e mostra os melhores candidatos
 // **********************************************************************
-
-//
-// DADOS DE EXEMPLO DO PRIMEIRO FRAME
-//
-
-Node *createNode(char *name, Node *parent, int numChannels, float ofx,
-                 float ofy, float ofz) {
-  Node *aux = malloc(sizeof(Node));
-  aux->channels = numChannels;
-  aux->channelData = calloc(sizeof(float), numChannels);
-  strcpy(aux->name, name);
-  aux->offset[0] = ofx;
-  aux->offset[1] = ofy;
-  aux->offset[2] = ofz;
-  aux->numChildren = 0;
-  aux->children = NULL;
-  aux->parent = parent;
-  aux->next = NULL;
-  if (parent) {
-    if(parent->children == NULL) {
-      // printf("First child: %s\n", aux->name);
-      parent->children = aux;
-    }
-    else {
-      Node* ptr = parent->children;
-      while(ptr->next != NULL)
-        ptr = ptr->next;
-      // printf("Next child: %s\n", aux->name);
-      ptr->next = aux;
-    }
-    parent->numChildren++;
+void detectLoop() {
+  loopReady = 1;
+  loopIn = loopOut = 0;
+  if (live)
+    return; // um frame por vez: nao ha serie para comparar
+  if (totalFrames > LOOP_MAX_FRAMES) {
+    printf("Loops: %d frames, acima de %d; deteccao desligada\n",
+           totalFrames, LOOP_MAX_FRAMES);
+    return;
+  }
+  LoopParams params;
+  defaultLoopParams(&params);
+  params.minLength = totalFrames * clip->frameTime * LOOP_MIN_FRACTION;
+  LoopCandidate found[LOOP_CANDIDATES];
+  double start = nowSeconds();
+  int count = findLoops(clip, &params, found, LOOP_CANDIDATES);
+  printf("Loops (%.1f ms):", (nowSeconds() - start) * 1000);
+  for (int i = 0; i < count; i++)
+    printf(" %d-%d (custo %.2f)", found[i].in + 1, found[i].out + 1,
+           found[i].cost);
+  printf(count ? "\n" : " nenhum\n");
+  if (count && found[0].cost <= LOOP_MAX_COST) {
+    loopIn = found[0].in;
+    loopOut = found[0].out;
   }
-  printf("Created %s\n", name);
-  return aux;
 }
 
-void trimString(char *str) {
-    if (!str) return;
-    
-    // Remove espaços do início
-    char *start = str;
-    while (*start && (*start == ' ' || *start == '\t')) {
-        start++;
-    }
-    if (start != str) {
-        memmove(str, start, strlen(start) + 1);
-    }
-    
-    // Remove espaços e quebras de linha do final
-    char *end = str + strlen(str) - 1;
-    while (end > str && (*end == ' ' || *end == '\n' || *end == '\r' || *end == '\t')) {
-        *end = '\0';
-        end--;
-    }
+// **********************************************************************
+//  Frame seguinte (step = 1) ou anterior (step = -1) da reproducao: ao
+//  chegar em loopOut volta para loopIn (e vice-versa); fora do loop, ou
+//  sem ele, da a volta no clip inteiro
+// **********************************************************************
+int stepFrame(int frame, int step) {
+  if (useLoop && !loopReady)
+    detectLoop();
+  int next = frame + step;
+  if (useLoop && loopOut > loopIn) {
+    if (step > 0 && frame < loopOut && next >= loopOut)
+      return loopIn;
+    if (step < 0 && frame == loopIn)
+      return loopOut - 1;
+  }
+  if (next >= totalFrames)
+    return 0;
+  return next < 0 ? totalFrames - 1 : next;
 }
 
-void parseHierarchy(FILE *file) {
-    if (!file) {
-        printf("Erro: arquivo inválido\n");
-        return;
-    }
-
-    char line[MAX_LINE_LENGTH];
-    char name[MAX_NAME_LENGTH];
-    Node *currentNode = NULL;
-    int lineNumber = 0;
-    
-    while (fgets(line, sizeof(line), file)) {
-        lineNumber++;
-        trimString(line);  // Limpa a linha inteira antes de processá-la
-        
-        if (strlen(line) == 0) {
-            continue;  // Pula linhas vazias após o trim
-        }
-        
-        printf("\nProcessando linha %d: '%s'\n", lineNumber, line);
-        
-        if (strncmp(line, "ROOT", 4) == 0) {
-            char *nameStart = line + 4;  // Pula "ROOT"
-            trimString(nameStart);       // Limpa espaços extras antes do nome
-            if (sscanf(nameStart, "%s", name) == 1) {
-                root = createNode(name, NULL, 0, 0, 0, 0);
-                currentNode = root;
-                printf("ROOT criado: %s\n", name);
-            }
-        }
-        else if (strncmp(line, "JOINT", 5) == 0) {
-            char *nameStart = line + 5;  // Pula "JOINT"
-            trimString(nameStart);       // Limpa espaços extras antes do nome
-            if (sscanf(nameStart, "%s", name) == 1) {
-                Node *newNode = createNode(name, currentNode, 0, 0, 0, 0);
-                currentNode = newNode;
-                printf("JOINT criado: %s (pai: %s)\n", name, 
-                       currentNode->parent ? currentNode->parent->name : "NULL");
-            }
-        }
-        else if (strncmp(line, "OFFSET", 6) == 0) {
-            char *offsetValues = line + 6;  // Pula "OFFSET"
-            trimString(offsetValues);       // Limpa espaços extras antes dos valores
-            float x, y, z;
-            if (currentNode && sscanf(offsetValues, "%f %f %f", &x, &y, &z) == 3) {
-                currentNode->offset[0] = x;
-                currentNode->offset[1] = y;
-                currentNode->offset[2] = z;
-                printf("OFFSET definido para %s: %.2f %.2f %.2f\n", 
-                       currentNode->name, x, y, z);
-            }
-        }
-        else if (strncmp(line, "CHANNELS", 8) == 0) {
-            char *channelInfo = line + 8;  // Pula "CHANNELS"
-            trimString(channelInfo);       // Limpa espaços extras antes do número
-            if (currentNode) {
-                int numChannels;
-                if (sscanf(channelInfo, "%d", &numChannels) == 1) {
-                    currentNode->channels = numChannels;
-                    currentNode->channelData = calloc(numChannels, sizeof(float));
-                    if (currentNode->channelData) {
-                        totalChannels += numChannels;
-                        printf("CHANNELS configurado para %s: %d\n", 
-                               currentNode->name, numChannels);
-                    }
-                }
-            }
-        }
-        else if (strncmp(line, "End Site", 8) == 0) {
-            if (currentNode) {
-                printf("Processando End Site para nó %s\n", currentNode->name);
-                // Lê a próxima linha que deve ser "{"
-                if (fgets(line, sizeof(line), file)) {
-                    trimString(line);
-                    if (line[0] == '{') {
-                        // Lê a linha do OFFSET
-                        if (fgets(line, sizeof(line), file)) {
-                            trimString(line);
-                            float x, y, z;
-                            if (sscanf(line, "OFFSET %f %f %f", &x, &y, &z) == 3) {
-                                createNode("End Site", currentNode, 0, x, y, z);
-                            }
-                        }
-                        // Lê o "}" final
-                        fgets(line, sizeof(line), file);
-                        trimString(line);
-                    }
-                }
-            }
-        }
-        else if (strcmp(line, "}") == 0) {
-            if (currentNode && currentNode->parent) {
-                printf("Voltando do nó %s para o pai %s\n", 
-                       currentNode->name, 
-                       currentNode->parent->name);
-                currentNode = currentNode->parent;
-            }
-        }
-        else if (strcmp(line, "{") == 0) {
-            printf("Início de bloco encontrado\n");
-        }
-        else if (strncmp(line, "MOTION", 6) == 0) {
-            printf("MOTION encontrado - iniciando parsing dos frames\n");
-            parseMotion(file);
-        }
-        else {
-            printf("Aviso: linha não reconhecida: '%s'\n", line);
-        }
-    }
-    
-    printf("\nParsing da hierarquia concluído. Total de linhas processadas: %d\n", lineNumber);
+void toggleLoop() {
+  useLoop = !useLoop;
+  if (useLoop && !loopReady)
+    detectLoop();
+  apply();
 }
 
-void parseMotion(FILE *file) {
-    char line[1024]; // Buffer para leitura de linhas
-
-    // Lê a linha com "Frames: X"
-    if (fgets(line, sizeof(line), file)) {
-        trimString(line);
-        if (strncmp(line, "Frames:", 7) == 0) {
-            sscanf(line, "Frames: %d", &totalFrames);
-            printf("Total de frames: %d\n", totalFrames);
-        } else {
-            printf("Erro: Formato inesperado. Esperado 'Frames:'.\n");
-            return;
-        }
-    }
-
-    // Lê e ignora a linha "Frame Time: X"
-    if (fgets(line, sizeof(line), file)) {
-        trimString(line);
-        if (strncmp(line, "Frame Time:", 11) != 0) {
-            printf("Erro: Formato inesperado. Esperado 'Frame Time:'.\n");
-            return;
-        }
-        printf("Frame Time ignorado: %s\n", line);
-    }
-
-    // Aloca memória para a matriz de dados
-    data = (float **)malloc(totalFrames * sizeof(float *));
-    if (!data) {
-        printf("Erro: Falha ao alocar memória para as linhas da matriz.\n");
-        exit(1);
-    }
-
-    for (int i = 0; i < totalFrames; i++) {
-        data[i] = NULL; // Inicializa os ponteiros
-    }
-
-    // Variáveis de controle
-    int currentFrame = 0;
-
-    // Lê os dados de movimento
-    while (fgets(line, sizeof(line), file)) {
-        trimString(line);
-
-        // Divide a linha em tokens (valores de movimento)
-        char *token = strtok(line, " ");
-        int channelIndex = 0;
-
-        if (currentFrame == 0) {
-            // Conta o número de canais apenas na primeira linha
-            while (token != NULL) {
-                channelIndex++;
-                token = strtok(NULL, " ");
-            }
-            totalChannels = channelIndex;
-
-            // Aloca memória para as colunas
-            for (int i = 0; i < totalFrames; i++) {
-                data[i] = (float *)malloc(totalChannels * sizeof(float));
-                if (!data[i]) {
-                    printf("Erro: Falha ao alocar memória para as colunas da matriz.\n");
-                    exit(1);
-                }
-            }
-            printf("Total de canais: %d\n", totalChannels);
-
-            // Reinicia o token para processar a primeira linha novamente
-            token = strtok(line, " ");
-            channelIndex = 0;
-        }
-
-        // Processa a linha atual
-        while (token != NULL) {
-            if (channelIndex < totalChannels) {
-                data[currentFrame][channelIndex] = atof(token);
-                channelIndex++;
-            }
-            token = strtok(NULL, " ");
-        }
-
-        if (channelIndex != totalChannels) {
-            printf("Aviso: Dados incompletos no frame %d. Esperados: %d, Lidos: %d\n", currentFrame, totalChannels, channelIndex);
-        }
-
-        currentFrame++;
-    }
-
-    if (currentFrame != totalFrames) {
-        printf("Aviso: Número de frames lidos (%d) não corresponde ao total esperado (%d).\n", currentFrame, totalFrames);
-    }
-
-    printf("Dados de movimento carregados com sucesso.\n");
+// Aplica o frame atual e atualiza so as transformacoes que mudaram
+void apply() {
+  char title[160];
+  recomputedJoints = applyFrame(clip, curFrame);
+  if (publisher)
+    publishPose(publisher, clip, curFrame);
+  if (live)
+    sprintf(title,
+            "BVH Viewer - ao vivo - %ld frames - latencia %.1f ms (max %.1f)"
+            " - %ld descartados",
+            liveStats.frames, liveStats.display, liveStats.maxDisplay,
+            liveStats.skipped + liveStats.dropped);
+  else
+    sprintf(title, "BVH Viewer - frame %d/%d - %d juntas recalculadas%s%s",
+          curFrame + 1, totalFrames, recomputedJoints,
+          filter.type ? " - filtro " : "",
+          filter.type ? filterName(filter.type) : "");
+  if (!live && useLoop && loopOut > loopIn)
+    sprintf(title + strlen(title), " - loop %d-%d", loopIn + 1, loopOut);
+  glutSetWindowTitle(title);
 }
 
-void freeMotionData() {
-    if (data) {
-        for (int i = 0; i < totalFrames; i++) {
-            free(data[i]);
-        }
-        free(data);
-        data = NULL;
-    }
+void freeTree() {
+  freeSkinnedMesh(mesh);
+  freeClip(clip);
+  free(rawMotion);
 }
 
-void printHierarchy(Node *node, int depth) {
-    if (!node) return;
-
-    for (int i = 0; i < depth; i++) printf("  "); // Indentação
-    printf("%s (Canais: %d, Filhos: %d)\n", node->name, node->channels, node->numChildren);
-
-    Node *child = node->children;
-    while (child) {
-        printHierarchy(child, depth + 1);
-        child = child->next;
-    }
+// **********************************************************************
+//  Refaz clip->motion a partir do movimento original com o filtro atual
+// **********************************************************************
+void refilter() {
+  size_t size = (size_t)clip->totalFrames * clip->totalChannels;
+  if (!rawMotion) {
+    if (filter.type == FILTER_NONE)
+      return;
+    rawMotion = malloc(size * sizeof(float));
+    memcpy(rawMotion, clip->motion, size * sizeof(float));
+  }
+  double start = nowSeconds();
+  filterMotion(clip, rawMotion, clip->motion, &filter, 0);
+  if (useQuats)
+    buildQuatTracks(clip, 0);
+  printf("Filtro %s: %.2f ms\n", filterName(filter.type),
+         (nowSeconds() - start) * 1000);
+  if (mesh)
+    mesh->frame = -1;
 }
 
-// Pos. da aplicacao dos dados
-int dataPos;
+// Passa para o proximo filtro (nenhum -> savgol -> butter -> quat)
+void cycleFilter() {
+  if (live)
+    return; // um frame por vez: nao ha serie para filtrar
+  int type = (filter.type + 1) % FILTER_COUNT;
+  defaultFilterParams(&filter);
+  filter.type = type;
+  refilter();
+  clipChanged();
+  apply();
+  glutPostRedisplay();
+}
 
-void applyData(float data[], Node *n) {
-  // printf("%s:\n", n->name);
-  if (n->numChildren == 0)
+// **********************************************************************
+//  Avanca um frame da reproducao e agenda o proximo
+// **********************************************************************
+void playFrame(int run) {
+  if (!playing || run != playRun)
     return;
-  for (int c = 0; c < n->channels; c++) {
-    // printf("   %d -> %f\n", c, data[dataPos]);
-    n->channelData[c] = data[dataPos++];
-  }
-  Node* ptr = n->children;
-  while(ptr != NULL) {
-    applyData(data, ptr);
-    ptr = ptr->next;
-  }
+  curFrame = stepFrame(curFrame, 1);
+  frameDue = 1;
+  apply();
+  glutPostRedisplay();
+  glutTimerFunc((unsigned)(clip->frameTime * 1000 + 0.5f), playFrame, run);
 }
 
-void apply() {
-  dataPos = 0;
-  applyData(data[curFrame], root);
+void togglePlayback() {
+  playing = !playing;
+  if (playing)
+    glutTimerFunc(0, playFrame, ++playRun);
 }
 
-void initMaleSkel() {
-  root = createNode("Hips", NULL, 6, 0, 0, 0);
-
-  Node *toSpine =
-      createNode("ToSpine", root, 3, -2.69724, 7.43032, -0.144315);
-  Node *spine =
-      createNode("Spine", toSpine, 3, -0.0310711, 10.7595, 1.96963);
-  Node *spine1 = createNode("Spine1", spine, 3, 19.9056, 3.91189, 0.764692);
-
-  Node *neck = createNode("Neck", spine1, 3, 25.9749, 7.03908, -0.130764);
-  Node *head = createNode("Head", neck, 3, 9.52751, 0.295786, -0.907742);
-  Node *top = createNode("Top", head, 3, 16.4037, 0.713936, 2.7358);
-
-  /**/
-  Node *leftShoulder =
-      createNode("LeftShoulder", spine1, 3, 17.7449, 4.33886, 11.7777);
-  Node *leftArm =
-      createNode("LeftArm", leftShoulder, 3, 0.911315, 1.27913, 9.80584);
-  Node *leftForeArm =
-      createNode("LeftForeArm", leftArm, 3, 28.61265, 1.18197, -3.53199);
-  Node *leftHand =
-      createNode("LeftHand", leftForeArm, 3, 27.5088, 0.0218783, 0.327423);
-  Node *endLeftHand =
-      createNode("EndLHand", leftHand, 3, 18.6038, -0.000155887, 0.382096);
-
-  /**/
-  Node *rShoulder =
-      createNode("RShoulder", spine1, 3, 17.1009, 2.89543, -12.2328);
-  Node *rArm = createNode("RArm", rShoulder, 3, 1.4228, 0.178766, -10.211);
-  Node *rForeArm = createNode("RForeArm", rArm, 3, 28.733, 1.87905, 2.64907);
-  Node *rHand =
-      createNode("RHand", rForeArm, 3, 27.4588, 0.290562, -0.101845);
-  Node *endRHand =
-      createNode("RLHand", rHand, 3, 17.8396, -0.255518, -0.000602873);
-
-  Node *lUpLeg = createNode("LUpLeg", root, 3, -5.61296, -2.22332, -10.2353);
-  Node *lLeg = createNode("LLeg", lUpLeg, 3, 2.56703, -44.7417, -7.93097);
-  Node *lFoot = createNode("LFoot", lLeg, 3, 3.16933, -46.5642, -3.96578);
-  Node *lToe = createNode("LToe", lFoot, 3, 0.346054, -6.02161, 12.8035);
-  Node *lToe2 = createNode("LToe2", lToe, 3, 0.134235, -1.35082, 5.13018);
-
-  Node *rUpLeg = createNode("RUpLeg", root, 3, -5.7928, -1.72406, 10.6446);
-  Node *rLeg = createNode("RLeg", rUpLeg, 3, -2.57161, -44.7178, -7.85259);
-  Node *rFoot = createNode("RFoot", rLeg, 3, -3.10148, -46.5936, -4.03391);
-  Node *rToe = createNode("RToe", rFoot, 3, -0.0828122, -6.13587, 12.8035);
-  Node *rToe2 = createNode("RToe2", rToe, 3, -0.131328, -1.35082, 5.13018);
-
-  apply();
+// **********************************************************************
+//  Troca o clip pelo que foi recarregado em segundo plano, se houver,
+//  mantendo a posicao de reproducao. Roda entre dois frames (timer GLUT).
+// **********************************************************************
+void checkReload(int value) {
+  ReloadResult r;
+  if (takeReload(&r)) {
+    if (r.clip) {
+      // Hierarquia nova: a malha precisa ser religada ao esqueleto
+      freeSkinnedMesh(mesh);
+      freeClip(clip);
+      clip = r.clip;
+      root = clip->root;
+      mesh = meshPath ? loadSkinnedMesh(meshPath, weightsPath, clip) : NULL;
+    } else {
+      // Mesma hierarquia: so troca o buffer de movimento
+      recycleMotion(clip->motion, clip->data, clip->totalFrames,
+                    clip->totalChannels);
+      clip->motion = r.motion;
+      clip->data = r.data;
+      clip->totalFrames = r.totalFrames;
+      clip->frameTime = r.frameTime;
+      if (mesh)
+        mesh->frame = -1;
+    }
+    if (useQuats)
+      buildQuatTracks(clip, 0);
+    // O movimento novo e o original do arquivo
+    free(rawMotion);
+    rawMotion = NULL;
+    refilter();
+    data = clip->data;
+    totalFrames = clip->totalFrames;
+    if (curFrame >= totalFrames)
+      curFrame = totalFrames - 1;
+    clipChanged();
+    apply();
+    glutPostRedisplay();
+  }
+  glutTimerFunc(RELOAD_POLL_MS, checkReload, 0);
 }
 
-void freeTree() { freeNode(root); }
-
-void freeNode(Node *node) {
-  // printf("Freeing %s %p\n", node->name,node->children);
-  if (node == NULL)
-    return;
-  // printf("Freeing children...\n");
-  Node* ptr = node->children;
-  Node* aux;
-  while(ptr != NULL) {
-    aux = ptr->next;
-    freeNode(ptr);
-    ptr = aux;
+// **********************************************************************
+//  Modo ao vivo: troca a hierarquia quando chega uma nova e aplica o frame
+//  mais recente recebido. Roda na thread da GLUT (timer).
+// **********************************************************************
+void pollStream(int value) {
+  int changed = 0, posed = 0;
+  Clip *received = takeStreamClip(live);
+  if (received) {
+    freeClip(clip);
+    clip = received;
+    // O movimento original do filtro era do clip anterior (e o filtro fica
+    // desligado no modo ao vivo, ver cycleFilter)
+    free(rawMotion);
+    rawMotion = NULL;
+    root = clip->root;
+    data = clip->data;
+    totalFrames = clip->totalFrames;
+    curFrame = 0;
+    clipChanged();
+    changed = posed = 1;
+  }
+  if (takeStreamFrame(live, clip->motion, clip->totalChannels))
+    changed = posed = frameDue = 1;
+  double now = nowSeconds();
+  if (now - liveWindow >= 1) {
+    streamStats(live, &liveStats, 1);
+    liveWindow = now;
+    changed = 1; // atualiza o titulo
   }
-  // printf("Freeing channel data...\n");
-  free(node->channelData);
+  if (changed) {
+    // So o titulo mudou: a pose (e seus quaternions) continua a mesma
+    if (posed && useQuats)
+      buildQuatTracks(clip, 1);
+    apply();
+    glutPostRedisplay();
+  }
+  glutTimerFunc(LIVE_POLL_MS, pollStream, 0);
 }
 
 // **********************************************************************
@@ -435,13 +316,55 @@ void freeNode(Node *node) {
 // **********************************************************************
 int main(int argc, char **argv) {
 
-  FILE *file = fopen(argv[1], "r");
+  const char *usage = "Uso: %s [-q] [-p] [-v video.y4m|diretorio] [-s LxA] "
+                      "arquivo.bvh [malha.obj pesos.txt]\n"
+                      "     %s [-q] [-p] [-v video.y4m|diretorio] [-s LxA] "
+                      "-l endereco\n";
+  if (argc < 2) {
+    printf(usage, argv[0], argv[0]);
+    return 1;
+  }
+
   glutInit(&argc, argv);
+
+  // -q: rotacoes por quaternions pre-calculados
+  // -v: grava a reproducao desde o inicio (Y4M ou sequencia de PNGs)
+  // -s: tamanho da janela (ex.: 1920x1080)
+  // -p: publica a pose em memoria compartilhada (POSE_SHM_NAME)
+  // -l: poses ao vivo (porta UDP, host:porta ou socket Unix) em vez de
+  //     um arquivo
+  const char *liveAddress = NULL;
+  int first = 1, record = 0, winWidth = 650, winHeight = 500;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-q") == 0)
+      useQuats = 1;
+    else if (strcmp(argv[first], "-v") == 0 && first + 1 < argc) {
+      capturePath = argv[++first];
+      record = 1;
+    } else if (strcmp(argv[first], "-s") == 0 && first + 1 < argc &&
+               sscanf(argv[first + 1], "%dx%d", &winWidth, &winHeight) == 2)
+      first++;
+    else if (strcmp(argv[first], "-p") == 0) {
+      if (!publisher && !(publisher = createPosePublisher(POSE_SHM_NAME)))
+        return 1;
+    } else if (strcmp(argv[first], "-l") == 0 && first + 1 < argc)
+      liveAddress = argv[++first];
+    else {
+      printf(usage, argv[0], argv[0]);
+      return 1;
+    }
+    first++;
+  }
+  if (first >= argc && !liveAddress) {
+    printf(usage, argv[0], argv[0]);
+    return 1;
+  }
+
   glutInitDisplayMode(GLUT_DOUBLE | GLUT_DEPTH | GLUT_RGB);
   glutInitWindowPosition(0, 0);
 
   // Define o tamanho inicial da janela grafica do programa
-  glutInitWindowSize(650, 500);
+  glutInitWindowSize(winWidth, winHeight);
 
   // Cria a janela na tela, definindo o nome da
   // que aparecera na barra de título da janela.
@@ -450,18 +373,41 @@ int main(int argc, char **argv) {
   // executa algumas inicializações
   init();
 
-  // Exemplo: monta manualmente um esqueleto
-  // (no trabalho, deve-se ler do arquivo)
-  parseHierarchy(file);
+  if (liveAddress) {
+    // A hierarquia vem do emissor, antes do primeiro frame
+    bvhVerbose = 0;
+    live = startStreamReceiver(liveAddress);
+    if (!live)
+      return 1;
+    printf("Aguardando a hierarquia...\n");
+    clip = waitStreamClip(live);
+  } else {
+    // Le a hierarquia e o movimento do arquivo
+    clip = loadClip(argv[first]);
+    if (!clip)
+      return 1;
+  }
+  if (useQuats)
+    buildQuatTracks(clip, 0);
+  root = clip->root;
+  data = clip->data;
+  totalFrames = clip->totalFrames;
   printHierarchy(root, 0);
-
-    // Use o motionData conforme necessário
-    // Exemplo: imprimir o primeiro frame
-    for (int i = 0; i < frameDataSize; i++) {
-        printf("Canal %d: %.2f\n", i, motionData[i]);
-    }
   apply();
 
+  // Malha opcional, deformada por skinning a partir do esqueleto
+  if (!live && argc >= first + 3) {
+    meshPath = argv[first + 1];
+    weightsPath = argv[first + 2];
+    mesh = loadSkinnedMesh(meshPath, weightsPath, clip);
+  }
+
+  // Recarrega o arquivo automaticamente quando ele for reescrito
+  if (live)
+    glutTimerFunc(LIVE_POLL_MS, pollStream, 0);
+  else if (startWatcher(argv[first], clip))
+    glutTimerFunc(RELOAD_POLL_MS, checkReload, 0);
+
 
   // Define que o tratador de evento para
   // o redesenho da tela. A funcao "display"
@@ -501,6 +447,12 @@ int main(int argc, char **argv) {
   // Registra a função callback para eventos de movimento do mouse
   glutMotionFunc(move);
 
+  // -v: grava desde o primeiro frame, com a animacao rodando
+  if (record) {
+    toggleCapture();
+    togglePlayback();
+  }
+
   // inicia o tratamento dos eventos
   glutMainLoop();
 }
@@ -0,0 +1,121 @@
+// **********************************************************************
+//	names.c
+//  Tabela de nomes dos nodos: texto em blocos e hash com sondagem linear
+// **********************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "names.h"
+
+// Tamanho de um bloco de texto (nomes maiores ganham um bloco so seu)
+#define NAME_BLOCK 4096
+
+typedef struct {
+  const char *name; // NULL = posicao livre
+  unsigned hash;
+  int index; // nodo (-1 antes de indexNames)
+} NameEntry;
+
+struct NameTable {
+  char **blocks;
+  int numBlocks;
+  size_t used; // bytes ocupados no ultimo bloco
+  NameEntry *entries;
+  unsigned mask; // qtd de posicoes - 1 (potencia de 2)
+  int count;
+};
+
+// FNV-1a
+static unsigned hashName(const char *name) {
+  unsigned h = 2166136261u;
+  for (; *name; name++)
+    h = (h ^ (unsigned char)*name) * 16777619u;
+  return h;
+}
+
+NameTable *createNameTable() {
+  NameTable *t = calloc(1, sizeof(NameTable));
+  t->mask = 63;
+  t->entries = calloc(t->mask + 1, sizeof(NameEntry));
+  t->used = NAME_BLOCK; // o primeiro internName aloca um bloco
+  return t;
+}
+
+void freeNameTable(NameTable *t) {
+  if (!t)
+    return;
+  for (int i = 0; i < t->numBlocks; i++)
+    free(t->blocks[i]);
+  free(t->blocks);
+  free(t->entries);
+  free(t);
+}
+
+// Posicao do nome ou a posicao livre onde ele entraria
+static unsigned findSlot(const NameTable *t, const char *name, unsigned h) {
+  unsigned i = h & t->mask;
+  while (t->entries[i].name &&
+         !(t->entries[i].hash == h && strcmp(t->entries[i].name, name) == 0))
+    i = (i + 1) & t->mask;
+  return i;
+}
+
+// Dobra a tabela (ocupacao maxima de 1/2)
+static void grow(NameTable *t) {
+  NameEntry *old = t->entries;
+  unsigned size = t->mask + 1;
+  t->mask = size * 2 - 1;
+  t->entries = calloc(size * 2, sizeof(NameEntry));
+  for (unsigned i = 0; i < size; i++)
+    if (old[i].name)
+      t->entries[findSlot(t, old[i].name, old[i].hash)] = old[i];
+  free(old);
+}
+
+// Espaco para len bytes no ultimo bloco (ou num bloco novo)
+static char *allocText(NameTable *t, size_t len) {
+  if (t->used + len > NAME_BLOCK) {
+    size_t size = len > NAME_BLOCK ? len : NAME_BLOCK;
+    t->blocks = realloc(t->blocks, (t->numBlocks + 1) * sizeof(char *));
+    t->blocks[t->numBlocks++] = malloc(size);
+    t->used = 0;
+  }
+  char *text = t->blocks[t->numBlocks - 1] + t->used;
+  t->used += len;
+  return text;
+}
+
+const char *internName(NameTable *t, const char *name) {
+  unsigned h = hashName(name);
+  unsigned i = findSlot(t, name, h);
+  if (t->entries[i].name)
+    return t->entries[i].name;
+  if ((unsigned)(t->count + 1) * 2 > t->mask + 1) {
+    grow(t);
+    i = findSlot(t, name, h);
+  }
+  size_t len = strlen(name) + 1;
+  char *text = allocText(t, len);
+  memcpy(text, name, len);
+  t->entries[i] = (NameEntry){text, h, -1};
+  t->count++;
+  return text;
+}
+
+void indexNames(NameTable *t, Node *const *nodes, int numNodes) {
+  for (unsigned i = 0; i <= t->mask; i++)
+    t->entries[i].index = -1;
+  for (int n = 0; n < numNodes; n++) {
+    const char *name = nodes[n]->name;
+    NameEntry *e = &t->entries[findSlot(t, name, hashName(name))];
+    if (e->name && e->index < 0)
+      e->index = n;
+  }
+}
+
+int nameIndex(const NameTable *t, const char *name) {
+  const NameEntry *e = &t->entries[findSlot(t, name, hashName(name))];
+  return e->name ? e->index : -1;
+}
@@ -0,0 +1,24 @@
+#ifndef NAMES_H
+#define NAMES_H
+
+// Nomes dos nodos de uma hierarquia: cada nome distinto e guardado uma vez
+// num bloco de texto da tabela (sem limite de tamanho; os ponteiros valem
+// ate freeNameTable) e um hash com enderecamento aberto leva do nome ao
+// indice do nodo em Clip.nodes
+typedef struct NameTable NameTable;
+struct Node;
+
+NameTable *createNameTable();
+void freeNameTable(NameTable *t);
+
+// Copia do nome na tabela (a mesma para nomes iguais)
+const char *internName(NameTable *t, const char *name);
+
+// Associa cada nome ao primeiro nodo (em pre-ordem) que o usa, como a
+// busca recursiva de findNode
+void indexNames(NameTable *t, struct Node *const *nodes, int numNodes);
+
+// Indice do nodo com o nome (-1 se nao houver)
+int nameIndex(const NameTable *t, const char *name);
+
+#endif
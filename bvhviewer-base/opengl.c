@@ -3,7 +3,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bounds.h"
+#include "capture.h"
 #include "opengl.h"
+#include "parallel.h"
+#include "posepub.h"
+#include "stream.h"
 
 #ifdef WIN32
 #include "gl/glut.h"
@@ -25,10 +30,76 @@ extern int totalFrames;
 // Frame atual
 extern int curFrame;
 
+// Clip carregado e malha deformada por ele (NULL se nao houver)
+extern Clip *clip;
+extern SkinnedMesh *mesh;
+
+// Desenha a malha (1) ou o esqueleto (0)
+int showMesh = 1;
+
+// Trajetorias e fantasmas de +-TRAIL_RADIUS frames, um a cada GHOST_STEP
+#define TRAIL_RADIUS 60
+#define GHOST_STEP 10
+int showTrails = 0;
+PoseRing *ring = NULL;
+
+// Buffers de desenho da malha e das trajetorias (refeitos por clipChanged)
+GLuint meshVbo = 0, meshIbo = 0, trailVbo = 0;
+int uploadedMeshFrame = -1;
+float *trailVertices = NULL;
+unsigned int *ghostIndices = NULL;
+GLint *trailFirsts = NULL;
+GLsizei *trailCounts = NULL;
+int numGhostIndices = 0, uploadedFirst = -1, uploadedCount = -1;
+
+// Junta selecionada com o mouse (-1 = nenhuma) e as capsulas dos ossos
+// do frame atual, com a hierarquia de volumes usada na selecao
+int selectedJoint = -1;
+Capsule *pickCapsules = NULL;
+BoneBvh *pickBvh = NULL;
+
+// Gravacao de video em andamento (NULL se nao houver) e seu destino
+// (".y4m" ou diretorio de PNGs, opcao -v)
+Capture *capture = NULL;
+const char *capturePath = "captura.y4m";
+// Um frame novo foi mostrado e ainda nao foi gravado: o video so recebe
+// os frames reproduzidos, nao os redesenhos da camera ou do mouse
+int frameDue = 0;
+
+// Receptor de poses ao vivo (NULL se a pose vem de um arquivo)
+extern StreamReceiver *live;
+
+// Publicacao da pose em memoria compartilhada (NULL se desligada)
+extern PosePublisher *publisher;
+
+// Caixas envolventes dos frames do clip (refeitas por clipChanged; no modo
+// ao vivo a caixa sai da pose atual)
+ClipBounds *bounds = NULL;
+
+// Camera que acompanha o personagem (tecla 'c'): o foco segue o centro da
+// caixa do frame e a distancia enquadra a maior caixa numa janela de
+// +-CAMERA_WINDOW segundos, ambos suavizados com constante CAMERA_TAU
+#define CAMERA_WINDOW 1.0f
+#define CAMERA_TAU 0.35f
+#define CAMERA_FOV 60.0f
+int followCamera = 1;
+float camFocus[3] = {0, 0, 0}, camDist = 500;
+double camTime = 0; // 0 = a camera ainda nao foi posicionada
+
+// Folga das caixas no teste de visibilidade: espessura dos ossos e da malha
+#define CULL_MARGIN (BONE_RADIUS * 4)
+
 // Funcoes para liberacao de memoria da hierarquia
 void freeTree();
 void freeNode(Node *node);
 void apply();
+void cycleFilter();
+void togglePlayback();
+void toggleLoop();
+int stepFrame(int frame, int step);
+
+// Loop da reproducao recalculado quando o clip muda (main.c)
+extern int loopReady;
 
 // Variaveis globais para manipulacao da visualizacao 3D
 int width, height;
@@ -42,153 +113,277 @@ float Obs[3] = {0, 0, -500};
 float Alvo[3];
 float ObsIni[3];
 
-// Desenha um segmento do esqueleto (bone)
-void renderBone(float x0, float y0, float z0, float x1, float y1, float z1) {
-  GLdouble dir_x = x1 - x0;
-  GLdouble dir_y = y1 - y0;
-  GLdouble dir_z = z1 - z0;
-  GLdouble bone_length = sqrt(dir_x * dir_x + dir_y * dir_y + dir_z * dir_z);
-
-  static GLUquadricObj *quad_obj = NULL;
-  if (quad_obj == NULL)
-    quad_obj = gluNewQuadric();
-  gluQuadricDrawStyle(quad_obj, GLU_FILL);
-  gluQuadricNormals(quad_obj, GLU_SMOOTH);
+void drawSkeleton() { drawNode(root); }
 
-  glPushMatrix();
+// **********************************************************************
+//  Desenha a malha deformada. Os vertices sao reenviados a cada frame
+//  para um VBO de streaming (orphaning com glBufferData(NULL) antes do
+//  glBufferSubData, para nao esperar o frame anterior); os indices ficam
+//  num buffer estatico. No Windows, sem buffer objects, usa vertex arrays.
+// **********************************************************************
+void drawMesh(SkinnedMesh *mesh) {
+  const GLsizei stride = 8 * sizeof(float);
+  const float *vertices = mesh->vertices;
+  const unsigned int *indices = mesh->indices;
+
+#ifndef WIN32
+  if (meshVbo == 0) {
+    glGenBuffers(1, &meshVbo);
+    glGenBuffers(1, &meshIbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshIbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 mesh->numTriangles * 3 * sizeof(unsigned int), mesh->indices,
+                 GL_STATIC_DRAW);
+  }
+  GLsizeiptr size = (GLsizeiptr)mesh->numVertices * stride;
+  glBindBuffer(GL_ARRAY_BUFFER, meshVbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshIbo);
+  if (uploadedMeshFrame != mesh->frame) {
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, mesh->vertices);
+    uploadedMeshFrame = mesh->frame;
+  }
+  vertices = NULL;
+  indices = NULL;
+#endif
 
-  glTranslated(x0, y0, z0);
+  glEnable(GL_NORMALIZE);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glVertexPointer(3, GL_FLOAT, stride, vertices);
+  glNormalPointer(GL_FLOAT, stride,
+                  vertices ? vertices + 4 : (void *)(4 * sizeof(float)));
+  glDrawElements(GL_TRIANGLES, mesh->numTriangles * 3, GL_UNSIGNED_INT, indices);
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisable(GL_NORMALIZE);
+
+#ifndef WIN32
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+#endif
+}
 
-  double length;
-  length = sqrt(dir_x * dir_x + dir_y * dir_y + dir_z * dir_z);
-  if (length < 0.0001) {
-    dir_x = 0.0;
-    dir_y = 0.0;
-    dir_z = 1.0;
-    length = 1.0;
+// **********************************************************************
+//  Desenha as trajetorias das juntas e os esqueletos fantasmas da janela
+//  do buffer circular. Todas as posicoes vao para um unico VBO (junta-
+//  major); as trajetorias sao um glMultiDrawArrays de GL_LINE_STRIP e os
+//  fantasmas um unico glDrawElements de GL_LINES sobre o mesmo buffer, de
+//  modo que o custo quase nao depende da qtd de fantasmas.
+// **********************************************************************
+void drawTrails(PoseRing *ring, const Clip *clip) {
+  int numNodes = ring->numNodes;
+  int count = ring->count;
+
+  if (trailVertices == NULL) {
+    trailVertices = malloc((size_t)numNodes * ring->capacity * 3 * sizeof(float));
+    ghostIndices =
+        malloc((size_t)ring->capacity * numNodes * 2 * sizeof(unsigned int));
+    trailFirsts = malloc(numNodes * sizeof(GLint));
+    trailCounts = malloc(numNodes * sizeof(GLsizei));
   }
-  dir_x /= length;
-  dir_y /= length;
-  dir_z /= length;
-
-  GLdouble up_x, up_y, up_z;
-  up_x = 0.0;
-  up_y = 1.0;
-  up_z = 0.0;
-
-  double side_x, side_y, side_z;
-  side_x = up_y * dir_z - up_z * dir_y;
-  side_y = up_z * dir_x - up_x * dir_z;
-  side_z = up_x * dir_y - up_y * dir_x;
-
-  length = sqrt(side_x * side_x + side_y * side_y + side_z * side_z);
-  if (length < 0.0001) {
-    side_x = 1.0;
-    side_y = 0.0;
-    side_z = 0.0;
-    length = 1.0;
+
+  // Refaz os buffers so quando a janela muda
+  int changed = uploadedFirst != ring->first || uploadedCount != count;
+  if (changed) {
+    gatherTrails(ring, trailVertices);
+    for (int i = 0; i < numNodes; i++) {
+      trailFirsts[i] = i * count;
+      trailCounts[i] = count;
+    }
+    // Um fantasma a cada GHOST_STEP frames (alinhados ao frame 0)
+    numGhostIndices = 0;
+    for (int k = 0; k < count; k++) {
+      if ((ring->first + k) % GHOST_STEP != 0)
+        continue;
+      for (int i = 1; i < numNodes; i++) {
+        ghostIndices[numGhostIndices++] =
+            clip->nodes[i]->parent->index * count + k;
+        ghostIndices[numGhostIndices++] = i * count + k;
+      }
+    }
+    uploadedFirst = ring->first;
+    uploadedCount = count;
   }
-  side_x /= length;
-  side_y /= length;
-  side_z /= length;
 
-  up_x = dir_y * side_z - dir_z * side_y;
-  up_y = dir_z * side_x - dir_x * side_z;
-  up_z = dir_x * side_y - dir_y * side_x;
+  const float *pointer = trailVertices;
+#ifndef WIN32
+  if (trailVbo == 0)
+    glGenBuffers(1, &trailVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, trailVbo);
+  if (changed) {
+    GLsizeiptr size = (GLsizeiptr)numNodes * count * 3 * sizeof(float);
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, trailVertices);
+  }
+  pointer = NULL;
+#endif
 
-  GLdouble m[16] = {side_x, side_y, side_z, 0.0, up_x, up_y, up_z, 0.0,
-                    dir_x,  dir_y,  dir_z,  0.0, 0.0,  0.0,  0.0,  1.0};
-  glMultMatrixd(m);
+  glDisable(GL_LIGHTING);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, pointer);
 
-  GLdouble radius = 3;   // raio
-  GLdouble slices = 8.0; // fatias horizontais
-  GLdouble stack = 3.0;  // fatias verticais
+  glColor3f(0.9, 0.8, 0.1); // amarelo
+#ifndef WIN32
+  glMultiDrawArrays(GL_LINE_STRIP, trailFirsts, trailCounts, numNodes);
+#else
+  for (int i = 0; i < numNodes; i++)
+    glDrawArrays(GL_LINE_STRIP, trailFirsts[i], trailCounts[i]);
+#endif
 
-  // Desenha como cilindros
-  gluCylinder(quad_obj, radius, radius, bone_length, slices, stack);
+  glColor3f(0.3, 0.3, 0.3); // cinza
+  glDrawElements(GL_LINES, numGhostIndices, GL_UNSIGNED_INT, ghostIndices);
 
-  glPopMatrix();
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glEnable(GL_LIGHTING);
+#ifndef WIN32
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
 }
 
-// Desenha um nodo da hierarquia (chamada recursiva)
-void drawNode(Node *node) {
-  int c = 0;
-  glPushMatrix();
+// **********************************************************************
+//  Descarta tudo o que foi derivado do clip anterior (chamada quando o
+//  arquivo e recarregado)
+// **********************************************************************
+void clipChanged() {
+  freePoseRing(ring);
+  ring = NULL;
+  free(trailVertices);
+  free(ghostIndices);
+  free(trailFirsts);
+  free(trailCounts);
+  trailVertices = NULL;
+  ghostIndices = NULL;
+  trailFirsts = NULL;
+  trailCounts = NULL;
+  uploadedFirst = uploadedCount = -1;
+#ifndef WIN32
+  if (meshIbo)
+    glDeleteBuffers(1, &meshIbo);
+  if (meshVbo)
+    glDeleteBuffers(1, &meshVbo);
+#endif
+  meshVbo = meshIbo = 0;
+  uploadedMeshFrame = -1;
+  freeBoneBvh(pickBvh);
+  free(pickCapsules);
+  pickBvh = NULL;
+  pickCapsules = NULL;
+  selectedJoint = -1;
+  freeClipBounds(bounds);
+  bounds = NULL;
+  loopReady = 0;
+}
 
-  if (node->channels == 6) {
-    glTranslatef(node->channelData[0], node->channelData[1],
-                 node->channelData[2]);
-    c = 3;
-  } else
-    glTranslatef(node->offset[0], node->offset[1], node->offset[2]);
-  glRotatef(node->channelData[c++], 0, 0, 1);
-  glRotatef(node->channelData[c++], 1, 0, 0);
-  glRotatef(node->channelData[c++], 0, 1, 0);
-
-  if (node->numChildren == 0)
-    renderBone(0, 0, 0, node->offset[0], node->offset[1], node->offset[2]);
-  else if (node->numChildren == 1) {
-    Node *child = node->children;
-    renderBone(0, 0, 0, child->offset[0], child->offset[1], child->offset[2]);
-  } else {
-    int nc = 0;
-    float center[3] = {0.0f, 0.0f, 0.0f};
-    Node* child = node->children;
-    while(child) {
-      nc++;
-      center[0] += child->offset[0];
-      center[1] += child->offset[1];
-      center[2] += child->offset[2];
-      child = child->next;
+// **********************************************************************
+//  Caixa do personagem no frame atual
+// **********************************************************************
+void currentBounds(float *min, float *max) {
+  if (!live) {
+    if (!bounds)
+      bounds = computeClipBounds(clip, 0);
+    frameBounds(bounds, curFrame, min, max);
+    return;
+  }
+  for (int k = 0; k < 3; k++)
+    min[k] = max[k] = root->world[12 + k];
+  for (int i = 1; i < clip->numNodes; i++)
+    for (int k = 0; k < 3; k++) {
+      float v = clip->nodes[i]->world[12 + k];
+      min[k] = v < min[k] ? v : min[k];
+      max[k] = v > max[k] ? v : max[k];
     }
-    center[0] /= nc + 1;
-    center[1] /= nc + 1;
-    center[2] /= nc + 1;
-
-    renderBone(0.0f, 0.0f, 0.0f, center[0], center[1], center[2]);
+}
 
-    child = node->children;
-    while(child) {
-      renderBone(center[0], center[1], center[2], child->offset[0],
-                 child->offset[1], child->offset[2]);
-      child = child->next;
-    }
+// **********************************************************************
+//  Aproxima o foco e a distancia da camera do enquadramento do frame
+//  atual. Retorna zero quando a camera ja chegou la.
+// **********************************************************************
+int updateCamera() {
+  float min[3], max[3], focus[3], radius = 0;
+  currentBounds(min, max);
+  for (int k = 0; k < 3; k++)
+    focus[k] = (min[k] + max[k]) / 2;
+  if (!live) {
+    // Distancia pela maior caixa da janela, para nao pulsar a cada passo
+    int window = (int)(CAMERA_WINDOW / clip->frameTime);
+    rangeBounds(bounds, curFrame - window, curFrame + window, min, max);
   }
-
-  Node* child = node->children;
-  while(child) {
-    drawNode(child);
-    child = child->next;
+  for (int k = 0; k < 3; k++) {
+    float half = fmaxf(max[k] - focus[k], focus[k] - min[k]);
+    radius += half * half;
   }
-  glPopMatrix();
+  radius = sqrtf(radius) + CULL_MARGIN;
+  // A esfera de raio radius cabe no menor dos dois angulos de visao
+  float halfY = CAMERA_FOV * (float)M_PI / 360;
+  float halfX = atanf(tanf(halfY) * ratio);
+  float dist = radius / sinf(fminf(halfX, halfY));
+
+  double now = nowSeconds();
+  float alpha = 1;
+  if (camTime > 0) {
+    float dt = fminf(now - camTime, 0.1f);
+    alpha = 1 - expf(-dt / CAMERA_TAU);
+  }
+  camTime = now;
+  float moved = 0;
+  for (int k = 0; k < 3; k++) {
+    float step = (focus[k] - camFocus[k]) * alpha;
+    camFocus[k] += step;
+    moved = fmaxf(moved, fabsf(focus[k] - camFocus[k]));
+  }
+  camDist += (dist - camDist) * alpha;
+  moved = fmaxf(moved, fabsf(dist - camDist));
+  return moved > 0.05f;
 }
 
-void drawSkeleton() { drawNode(root); }
-
 // **********************************************************************
-//  Desenha um quadriculado para representar um piso
+//  Seleciona a junta sob o cursor: o raio sai do plano proximo, desfeita
+//  a projecao de posUser, e e testado contra as capsulas dos ossos do
+//  frame atual. A hierarquia de volumes e montada no primeiro clique e
+//  depois so reajustada a pose.
 // **********************************************************************
-void drawFloor() {
-  float size = 50;
-  int num_x = 100, num_z = 100;
-  double ox, oz;
-  glBegin(GL_QUADS);
-  glNormal3d(0.0, 1.0, 0.0);
-  ox = -(num_x * size) / 2;
-  for (int x = 0; x < num_x; x++, ox += size) {
-    oz = -(num_z * size) / 2;
-    for (int z = 0; z < num_z; z++, oz += size) {
-      if (((x + z) % 2) == 0)
-        glColor3f(1.0, 1.0, 1.0);
-      else
-        glColor3f(0.8, 0.8, 0.8);
-      glVertex3d(ox, 0.0, oz);
-      glVertex3d(ox, 0.0, oz + size);
-      glVertex3d(ox + size, 0.0, oz + size);
-      glVertex3d(ox + size, 0.0, oz);
+void pickJoint(int x, int y) {
+  int count = countCapsules(clip);
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  for (int i = 0; i < clip->numNodes; i++)
+    memcpy(world + i * 16, clip->nodes[i]->world, 16 * sizeof(float));
+  if (!pickCapsules)
+    pickCapsules = malloc(count * sizeof(Capsule));
+  buildCapsules(clip, world, NULL, BONE_RADIUS, 0, NULL, pickCapsules);
+  free(world);
+  if (!pickBvh)
+    pickBvh = createBoneBvh(pickCapsules, count);
+  else
+    refitBoneBvh(pickBvh);
+
+  GLdouble model[16], proj[16], nx, ny, nz, fx, fy, fz;
+  GLint view[4];
+  posUser();
+  glGetDoublev(GL_MODELVIEW_MATRIX, model);
+  glGetDoublev(GL_PROJECTION_MATRIX, proj);
+  glGetIntegerv(GL_VIEWPORT, view);
+  double wy = view[1] + view[3] - y - 1;
+  gluUnProject(x, wy, 0, model, proj, view, &nx, &ny, &nz);
+  gluUnProject(x, wy, 1, model, proj, view, &fx, &fy, &fz);
+  float origin[3] = {nx, ny, nz}, dir[3] = {fx - nx, fy - ny, fz - nz};
+
+  PickHit hit;
+  selectedJoint = -1;
+  if (pickRay(pickBvh, origin, dir, &hit)) {
+    // O osso atingido e girado pela junta pai do nodo
+    const Node *joint = clip->nodes[hit.node]->parent;
+    selectedJoint = joint->index;
+    printf("Junta %s (frame %d):", joint->name, curFrame + 1);
+    for (int c = 0; c < joint->channels && joint->channelOffset >= 0; c++) {
+      char axis = joint->channelOrder[c];
+      printf(" %c%s=%g", axis < 'a' ? axis : axis - 'a' + 'A',
+             axis < 'a' ? "rotation" : "position",
+             clip->data[curFrame][joint->channelOffset + c]);
     }
+    printf("\n");
   }
-  glEnd();
+  glutPostRedisplay();
 }
 
 // Função callback para eventos de botões do mouse
@@ -203,8 +398,12 @@ void mouse(int button, int state, int x, int y) {
     rotX_ini = rotX;
     rotY_ini = rotY;
     bot = button;
-  } else
+  } else {
+    // Clique sem arrastar: selecao
+    if (bot == GLUT_LEFT_BUTTON && abs(x - x_ini) <= 2 && abs(y - y_ini) <= 2)
+      pickJoint(x, y);
     bot = -1;
+  }
 }
 
 // Função callback para eventos de movimento do mouse
@@ -240,15 +439,26 @@ void posUser() {
   // Set the clipping volume
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
-  gluPerspective(60, ratio, 0.01, 2000);
+  if (!followCamera)
+    gluPerspective(CAMERA_FOV, ratio, 0.01, 2000);
+  else {
+    // O arrasto com o botao direito vira um fator sobre a distancia
+    float zoom = fmaxf(Obs[2] / -500.0f, 0.05f);
+    gluPerspective(CAMERA_FOV, ratio, 0.01, fmaxf(2000, camDist * zoom * 4));
+  }
 
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
 
   // Especifica posição do observador e do alvo
-  glTranslatef(Obs[0], Obs[1], Obs[2]);
+  if (!followCamera)
+    glTranslatef(Obs[0], Obs[1], Obs[2]);
+  else
+    glTranslatef(0, 0, -camDist * fmaxf(Obs[2] / -500.0f, 0.05f));
   glRotatef(rotX, 1, 0, 0);
   glRotatef(rotY, 0, 1, 0);
+  if (followCamera)
+    glTranslatef(-camFocus[0], -camFocus[1], -camFocus[2]);
 }
 
 // **********************************************************************
@@ -276,18 +486,76 @@ void reshape(int w, int h) {
 void display() {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+  // Continua redesenhando enquanto a camera se aproxima do personagem
+  if (followCamera && updateCamera())
+    glutPostRedisplay();
   posUser();
 
+  // Personagem fora do volume de visao: nao deforma nem desenha
+  float planes[6][4], proj[16], model[16], min[3], max[3];
+  glGetFloatv(GL_PROJECTION_MATRIX, proj);
+  glGetFloatv(GL_MODELVIEW_MATRIX, model);
+  frustumPlanes(proj, model, planes);
+  currentBounds(min, max);
+  for (int k = 0; k < 3; k++) {
+    min[k] -= CULL_MARGIN;
+    max[k] += CULL_MARGIN;
+  }
+  int visible = boxInFrustum(planes, min, max);
+
   glMatrixMode(GL_MODELVIEW);
 
   drawFloor();
 
+  if (showTrails) {
+    if (!ring)
+      ring = createPoseRing(clip, TRAIL_RADIUS);
+    updatePoseRing(ring, clip, curFrame);
+    drawTrails(ring, clip);
+  }
+
   glPushMatrix();
   glColor3f(0.7, 0.0, 0.0); // vermelho
-  drawSkeleton();
+  if (visible && mesh && showMesh) {
+    if (mesh->frame != curFrame)
+      skinMeshPose(mesh, clip, curFrame, 0);
+    drawMesh(mesh);
+  } else if (visible)
+    drawSkeleton();
   glPopMatrix();
 
+  if (selectedJoint >= 0 && visible) {
+    const float *w = clip->nodes[selectedJoint]->world;
+    glPushMatrix();
+    glTranslatef(w[12], w[13], w[14]);
+    glColor3f(1.0, 0.8, 0.0); // amarelo
+    glutSolidSphere(BONE_RADIUS * 1.8, 12, 12);
+    glPopMatrix();
+  }
+
+  if (capture && frameDue)
+    captureFrame(capture);
+  frameDue = 0;
+
   glutSwapBuffers();
+
+  if (live)
+    markStreamDisplayed(live);
+}
+
+// **********************************************************************
+//  Inicia ou termina a gravacao da janela, na taxa de quadros do clip
+// **********************************************************************
+void toggleCapture() {
+  if (capture) {
+    stopCapture(capture);
+    capture = NULL;
+    return;
+  }
+  capture = startCapture(capturePath, glutGet(GLUT_WINDOW_WIDTH),
+                         glutGet(GLUT_WINDOW_HEIGHT), 1.0f / clip->frameTime);
+  frameDue = 1;
+  glutPostRedisplay();
 }
 
 // **********************************************************************
@@ -296,10 +564,46 @@ void display() {
 void keyboard(unsigned char key, int x, int y) {
   switch (key) {
   case 27: // Termina o programa qdo
+    stopCapture(capture);
+    stopStreamReceiver(live);
+    freePosePublisher(publisher);
+    freePoseRing(ring);
     freeTree();
     exit(0); // a tecla ESC for pressionada
     break;
 
+  case 't': // Liga/desliga trajetorias e fantasmas
+    showTrails = !showTrails;
+    glutPostRedisplay();
+    break;
+
+  case 'm': // Alterna entre malha e esqueleto
+    showMesh = !showMesh;
+    glutPostRedisplay();
+    break;
+
+  case 'f': // Proximo filtro de suavizacao do movimento
+    cycleFilter();
+    break;
+
+  case 'p': // Reproduz/pausa a animacao
+    togglePlayback();
+    break;
+
+  case 'v': // Liga/desliga a gravacao de video
+    toggleCapture();
+    break;
+
+  case 'l': // Liga/desliga o loop detectado
+    toggleLoop();
+    glutPostRedisplay();
+    break;
+
+  case 'c': // Liga/desliga a camera que acompanha o personagem
+    followCamera = !followCamera;
+    glutPostRedisplay();
+    break;
+
   default:
     break;
   }
@@ -312,14 +616,14 @@ void arrow_keys(int a_keys, int x, int y) {
   float passo = 3.0;
   switch (a_keys) {
   case GLUT_KEY_RIGHT:
-    if (++curFrame >= totalFrames)
-      curFrame = 0;
+    curFrame = stepFrame(curFrame, 1);
+    frameDue = 1;
     apply();
     glutPostRedisplay();
     break;
   case GLUT_KEY_LEFT:
-    if (--curFrame < 0)
-      curFrame = totalFrames - 1;
+    curFrame = stepFrame(curFrame, -1);
+    frameDue = 1;
     apply();
     glutPostRedisplay();
     break;
@@ -340,27 +644,7 @@ void arrow_keys(int a_keys, int x, int y) {
 //	Inicializa os parâmetros globais de OpenGL
 // **********************************************************************
 void init() {
-  // Parametros da fonte de luz
-  float light0_position[] = {10.0, 100.0, 100.0, 1.0};
-  float light0_diffuse[] = {0.8, 0.8, 0.8, 1.0};
-  float light0_specular[] = {1.0, 1.0, 1.0, 1.0};
-  float light0_ambient[] = {0.1, 0.1, 0.1, 1.0};
-
-  // Ajusta
-  glLightfv(GL_LIGHT0, GL_POSITION, light0_position);
-  glLightfv(GL_LIGHT0, GL_DIFFUSE, light0_diffuse);
-  glLightfv(GL_LIGHT0, GL_SPECULAR, light0_specular);
-  glLightfv(GL_LIGHT0, GL_AMBIENT, light0_ambient);
-
-  // Habilita estados necessarios
-  glEnable(GL_LIGHT0);
-  glEnable(GL_LIGHTING);
-  glEnable(GL_COLOR_MATERIAL);
-  glEnable(GL_DEPTH_TEST);
-  glCullFace(GL_BACK);
-  glEnable(GL_CULL_FACE);
-
-  glClearColor(0.5, 0.5, 0.8, 0.0);
+  setupScene();
 
   angX = 0.0;
   angY = 0.0;
@@ -6,6 +6,16 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bvh.h"
+#include "pick.h"
+#include "skin.h"
+#include "trail.h"
+
+// Funcoes de buffer object (OpenGL 1.5) declaradas pelo glext.h
+#ifndef WIN32
+#define GL_GLEXT_PROTOTYPES
+#endif
+
 #ifdef WIN32
 #include "gl/glut.h"
 #include <windows.h> // somente no Windows
@@ -17,23 +27,16 @@
 #include <GL/glut.h>
 #endif
 
-typedef struct Node Node;
-
-struct Node {
-  char name[20];      // nome
-  float offset[3];    // offset (deslocamento)
-  int channels;       // qtd de canais (3 ou 6)
-  float *channelData; // vetor com os dados dos canais
-  int numChildren;    // qtd de filhos
-  Node *parent;       // ponteiro para o pai
-  Node *children;     // ponteiro para o primeiro filho (ou NULL)
-  Node *next;         // ponteiro para o próximo filho (ou NULL)
-};
-
-void renderBone(float x0, float y0, float z0, float x1, float y1, float z1);
-void drawNode(Node *node);
+#include "draw.h"
+
 void drawSkeleton();
-void drawFloor();
+void drawMesh(SkinnedMesh *mesh);
+void drawTrails(PoseRing *ring, const Clip *clip);
+void clipChanged();
+void currentBounds(float *min, float *max);
+int updateCamera();
+void pickJoint(int x, int y);
+void toggleCapture();
 void mouse(int button, int state, int x, int y);
 void move(int x, int y);
 void posUser();
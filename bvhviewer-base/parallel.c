@@ -0,0 +1,187 @@
+// **********************************************************************
+//	parallel.c
+//  Laco paralelo simples sobre pthreads, usado pelas ferramentas que
+//  processam a biblioteca inteira de clips
+// **********************************************************************
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+typedef struct {
+  int n;
+  atomic_int nextItem;
+  ParallelFn fn;
+  void *ctx;
+} ParallelJob;
+
+typedef struct {
+  ParallelJob *job;
+  int thread;
+} Worker;
+
+int defaultThreads() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+
+static void *workerLoop(void *arg) {
+  Worker *w = arg;
+  ParallelJob *job = w->job;
+  int i;
+  while ((i = atomic_fetch_add(&job->nextItem, 1)) < job->n)
+    job->fn(i, w->thread, job->ctx);
+  return NULL;
+}
+
+void parallelFor(int n, int numThreads, ParallelFn fn, void *ctx) {
+  if (numThreads <= 0)
+    numThreads = defaultThreads();
+  if (numThreads > n)
+    numThreads = n;
+  if (numThreads <= 1) {
+    for (int i = 0; i < n; i++)
+      fn(i, 0, ctx);
+    return;
+  }
+
+  ParallelJob job = {.n = n, .fn = fn, .ctx = ctx};
+  atomic_init(&job.nextItem, 0);
+  pthread_t *threads = malloc(numThreads * sizeof(pthread_t));
+  Worker *workers = malloc(numThreads * sizeof(Worker));
+
+  // A thread atual tambem trabalha (como thread 0)
+  for (int t = 1; t < numThreads; t++) {
+    workers[t].job = &job;
+    workers[t].thread = t;
+    pthread_create(&threads[t], NULL, workerLoop, &workers[t]);
+  }
+  workers[0].job = &job;
+  workers[0].thread = 0;
+  workerLoop(&workers[0]);
+  for (int t = 1; t < numThreads; t++)
+    pthread_join(threads[t], NULL);
+
+  free(threads);
+  free(workers);
+}
+
+// **********************************************************************
+//  Pool de threads persistentes
+// **********************************************************************
+
+typedef struct {
+  WorkerPool *pool;
+  int thread;
+} PoolWorker;
+
+struct WorkerPool {
+  int numThreads;
+  pthread_t *threads;
+  PoolWorker *workers;
+  pthread_mutex_t lock;
+  pthread_cond_t start, done;
+  ParallelJob *job;    // laco atual
+  unsigned generation; // incrementado a cada poolFor
+  int busy;            // threads que ainda nao terminaram o laco atual
+  int quit;
+};
+
+static void *poolLoop(void *arg) {
+  PoolWorker *w = arg;
+  WorkerPool *pool = w->pool;
+  unsigned seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->quit && pool->generation == seen)
+      pthread_cond_wait(&pool->start, &pool->lock);
+    if (pool->quit)
+      break;
+    seen = pool->generation;
+    ParallelJob *job = pool->job;
+    pthread_mutex_unlock(&pool->lock);
+
+    int i;
+    while ((i = atomic_fetch_add(&job->nextItem, 1)) < job->n)
+      job->fn(i, w->thread, job->ctx);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0)
+      pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+WorkerPool *createWorkerPool(int numThreads) {
+  WorkerPool *pool = calloc(1, sizeof(WorkerPool));
+  pool->numThreads = numThreads > 0 ? numThreads : defaultThreads();
+  pool->threads = malloc(pool->numThreads * sizeof(pthread_t));
+  pool->workers = malloc(pool->numThreads * sizeof(PoolWorker));
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for (int t = 1; t < pool->numThreads; t++) {
+    pool->workers[t].pool = pool;
+    pool->workers[t].thread = t;
+    if (pthread_create(&pool->threads[t], NULL, poolLoop,
+                       &pool->workers[t]) != 0) {
+      pool->numThreads = t; // segue com as que foram criadas
+      break;
+    }
+  }
+  return pool;
+}
+
+void freeWorkerPool(WorkerPool *pool) {
+  if (!pool)
+    return;
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+  for (int t = 1; t < pool->numThreads; t++)
+    pthread_join(pool->threads[t], NULL);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->start);
+  pthread_cond_destroy(&pool->done);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool);
+}
+
+int poolThreads(const WorkerPool *pool) { return pool->numThreads; }
+
+void poolFor(WorkerPool *pool, int n, ParallelFn fn, void *ctx) {
+  if (pool->numThreads <= 1 || n <= 1) {
+    for (int i = 0; i < n; i++)
+      fn(i, 0, ctx);
+    return;
+  }
+  ParallelJob job = {.n = n, .fn = fn, .ctx = ctx};
+  atomic_init(&job.nextItem, 0);
+  pthread_mutex_lock(&pool->lock);
+  pool->job = &job;
+  pool->busy = pool->numThreads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  Worker self = {&job, 0};
+  workerLoop(&self);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,31 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Corpo de um laco paralelo: processa o item i (thread = indice da thread)
+typedef void (*ParallelFn)(int i, int thread, void *ctx);
+
+// Qtd de threads padrao (numero de processadores disponiveis)
+int defaultThreads();
+
+// Executa fn(i) para i em [0, n) distribuindo os itens dinamicamente entre
+// numThreads threads (numThreads <= 0 usa defaultThreads()). Retorna apos
+// todos os itens terem sido processados.
+void parallelFor(int n, int numThreads, ParallelFn fn, void *ctx);
+
+// Threads persistentes para lacos curtos repetidos (ex.: um por frame no
+// viewer), sem o custo de criar e juntar threads a cada chamada
+typedef struct WorkerPool WorkerPool;
+
+// numThreads <= 0 usa defaultThreads(); a thread que chama poolFor conta
+// como uma delas
+WorkerPool *createWorkerPool(int numThreads);
+void freeWorkerPool(WorkerPool *pool);
+int poolThreads(const WorkerPool *pool);
+
+// Como parallelFor, com as threads do pool. Uma chamada por vez
+void poolFor(WorkerPool *pool, int n, ParallelFn fn, void *ctx);
+
+// Relogio monotonico em segundos (para medicoes de tempo)
+double nowSeconds();
+
+#endif
@@ -0,0 +1,325 @@
+// **********************************************************************
+//	pick.c
+//  Selecao de ossos por raio: hierarquia de AABBs com refit incremental
+//  e intersecao raio-capsula
+// **********************************************************************
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pick.h"
+
+// Capsulas por folha
+#define LEAF_SIZE 4
+// Remonta quando a soma das areas das caixas passar deste fator da
+// soma na ultima montagem
+#define REBUILD_FACTOR 2.0f
+#define MAX_DEPTH 64
+
+typedef struct {
+  float min[3], max[3];
+  int right; // filho direito (o esquerdo e o nodo seguinte); -1 em folhas
+  int first, count; // folha: capsulas order[first, first + count)
+} BvhNode;
+
+struct BoneBvh {
+  const Capsule *capsules;
+  int count;
+  int *order; // capsulas agrupadas por folha
+  BvhNode *nodes;
+  int numNodes;
+  float builtArea; // soma das areas na ultima montagem
+};
+
+// min/max sem o tratamento de NaN de fminf/fmaxf (viram minss/maxss)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+static void capsuleBounds(const Capsule *c, float *min, float *max) {
+  for (int k = 0; k < 3; k++) {
+    min[k] = MIN(c->a[k], c->b[k]) - c->radius;
+    max[k] = MAX(c->a[k], c->b[k]) + c->radius;
+  }
+}
+
+static float boxArea(const BvhNode *n) {
+  float dx = n->max[0] - n->min[0], dy = n->max[1] - n->min[1];
+  float dz = n->max[2] - n->min[2];
+  return 2 * (dx * dy + dy * dz + dz * dx);
+}
+
+// Caixa de uma folha a partir das suas capsulas
+static void leafBounds(const BoneBvh *bvh, BvhNode *n) {
+  for (int k = 0; k < 3; k++) {
+    n->min[k] = FLT_MAX;
+    n->max[k] = -FLT_MAX;
+  }
+  for (int i = n->first; i < n->first + n->count; i++) {
+    float min[3], max[3];
+    capsuleBounds(&bvh->capsules[bvh->order[i]], min, max);
+    for (int k = 0; k < 3; k++) {
+      n->min[k] = MIN(n->min[k], min[k]);
+      n->max[k] = MAX(n->max[k], max[k]);
+    }
+  }
+}
+
+static float centroid(const Capsule *c, int axis) {
+  return 0.5f * (c->a[axis] + c->b[axis]);
+}
+
+// Divide order[first, first + count) pela mediana dos centros no eixo
+// mais longo; os nodos ficam em pre-ordem (pais antes dos filhos)
+static int buildNode(BoneBvh *bvh, int first, int count) {
+  int index = bvh->numNodes++;
+  BvhNode *n = &bvh->nodes[index];
+  n->first = first;
+  n->count = count;
+  n->right = -1;
+  leafBounds(bvh, n);
+  if (count <= LEAF_SIZE)
+    return index;
+
+  int axis = 0;
+  float cmin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float cmax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = first; i < first + count; i++)
+    for (int k = 0; k < 3; k++) {
+      float c = centroid(&bvh->capsules[bvh->order[i]], k);
+      cmin[k] = fminf(cmin[k], c);
+      cmax[k] = fmaxf(cmax[k], c);
+    }
+  for (int k = 1; k < 3; k++)
+    if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+      axis = k;
+
+  // Selecao do elemento mediano (quickselect)
+  int *o = bvh->order + first, lo = 0, hi = count - 1, mid = count / 2;
+  while (lo < hi) {
+    float pivot = centroid(&bvh->capsules[o[(lo + hi) / 2]], axis);
+    int i = lo, j = hi;
+    while (i <= j) {
+      while (centroid(&bvh->capsules[o[i]], axis) < pivot)
+        i++;
+      while (centroid(&bvh->capsules[o[j]], axis) > pivot)
+        j--;
+      if (i <= j) {
+        int t = o[i];
+        o[i++] = o[j];
+        o[j--] = t;
+      }
+    }
+    if (mid <= j)
+      hi = j;
+    else if (mid >= i)
+      lo = i;
+    else
+      break;
+  }
+
+  n->count = 0;
+  buildNode(bvh, first, mid);
+  int right = buildNode(bvh, first + mid, count - mid);
+  bvh->nodes[index].right = right;
+  return index;
+}
+
+static float totalArea(const BoneBvh *bvh) {
+  float area = 0;
+  for (int i = 0; i < bvh->numNodes; i++)
+    area += boxArea(&bvh->nodes[i]);
+  return area;
+}
+
+static void rebuild(BoneBvh *bvh) {
+  bvh->numNodes = 0;
+  if (bvh->count > 0)
+    buildNode(bvh, 0, bvh->count);
+  bvh->builtArea = totalArea(bvh);
+}
+
+BoneBvh *createBoneBvh(const Capsule *capsules, int count) {
+  BoneBvh *bvh = calloc(1, sizeof(BoneBvh));
+  bvh->capsules = capsules;
+  bvh->count = count;
+  bvh->order = malloc((count > 0 ? count : 1) * sizeof(int));
+  for (int i = 0; i < count; i++)
+    bvh->order[i] = i;
+  // Uma arvore binaria com folhas de ate LEAF_SIZE tem menos de 2 * count
+  // nodos
+  bvh->nodes = malloc((2 * count + 1) * sizeof(BvhNode));
+  rebuild(bvh);
+  return bvh;
+}
+
+void freeBoneBvh(BoneBvh *bvh) {
+  if (!bvh)
+    return;
+  free(bvh->order);
+  free(bvh->nodes);
+  free(bvh);
+}
+
+int refitBoneBvh(BoneBvh *bvh) {
+  // Pre-ordem: percorrendo de tras para frente os filhos vem antes dos pais
+  float area = 0;
+  for (int i = bvh->numNodes - 1; i >= 0; i--) {
+    BvhNode *n = &bvh->nodes[i];
+    if (n->right < 0)
+      leafBounds(bvh, n);
+    else {
+      const BvhNode *l = &bvh->nodes[i + 1], *r = &bvh->nodes[n->right];
+      for (int k = 0; k < 3; k++) {
+        n->min[k] = MIN(l->min[k], r->min[k]);
+        n->max[k] = MAX(l->max[k], r->max[k]);
+      }
+    }
+    area += boxArea(n);
+  }
+  if (area > REBUILD_FACTOR * bvh->builtArea) {
+    rebuild(bvh);
+    return 1;
+  }
+  return 0;
+}
+
+// **********************************************************************
+//  Intersecoes
+// **********************************************************************
+
+static float dot3(const float *a, const float *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Entrada do raio numa esfera (dir normalizada); -1 se nao atinge
+static float raySphere(const float *origin, const float *dir,
+                       const float *center, float radius) {
+  float oc[3] = {origin[0] - center[0], origin[1] - center[1],
+                 origin[2] - center[2]};
+  float b = dot3(dir, oc), c = dot3(oc, oc) - radius * radius;
+  float h = b * b - c;
+  if (h < 0)
+    return -1;
+  return -b - sqrtf(h);
+}
+
+// Entrada do raio na capsula (dir normalizada); -1 se nao atinge
+static float rayCapsule(const float *origin, const float *dir,
+                        const Capsule *c) {
+  float ba[3] = {c->b[0] - c->a[0], c->b[1] - c->a[1], c->b[2] - c->a[2]};
+  float oa[3] = {origin[0] - c->a[0], origin[1] - c->a[1],
+                 origin[2] - c->a[2]};
+  float baba = dot3(ba, ba), bard = dot3(ba, dir), baoa = dot3(ba, oa);
+  float rdoa = dot3(dir, oa), oaoa = dot3(oa, oa);
+  // Cilindro infinito: a t^2 + 2 b t + c = 0
+  float a = baba - bard * bard;
+  float b = baba * rdoa - baoa * bard;
+  float cc = baba * oaoa - baoa * baoa - c->radius * c->radius * baba;
+  if (a > 1e-6f * baba) {
+    float h = b * b - a * cc;
+    if (h < 0)
+      return -1;
+    float t = (-b - sqrtf(h)) / a;
+    float y = baoa + t * bard;
+    if (y > 0 && y < baba)
+      return t;
+  }
+  // Tampas esfericas
+  float t0 = raySphere(origin, dir, c->a, c->radius);
+  float t1 = raySphere(origin, dir, c->b, c->radius);
+  if (t0 < 0)
+    return t1;
+  return t1 < 0 || t0 < t1 ? t0 : t1;
+}
+
+static int rayBox(const BvhNode *n, const float *origin, const float *inv,
+                  float maxT) {
+  float t0 = 0, t1 = maxT;
+  for (int k = 0; k < 3; k++) {
+    float a = (n->min[k] - origin[k]) * inv[k];
+    float b = (n->max[k] - origin[k]) * inv[k];
+    t0 = fmaxf(t0, fminf(a, b));
+    t1 = fminf(t1, fmaxf(a, b));
+  }
+  return t0 <= t1;
+}
+
+static void fillHit(const Capsule *capsules, int index, float t,
+                    const float *origin, const float *dir, PickHit *hit) {
+  hit->t = t;
+  hit->capsule = index;
+  hit->owner = capsules[index].owner;
+  hit->node = capsules[index].node;
+  for (int k = 0; k < 3; k++)
+    hit->point[k] = origin[k] + dir[k] * t;
+}
+
+static void normalizeRay(const float *dir, float *out) {
+  float len = sqrtf(dot3(dir, dir));
+  for (int k = 0; k < 3; k++)
+    out[k] = dir[k] / len;
+}
+
+int pickRay(const BoneBvh *bvh, const float *origin, const float *dir,
+            PickHit *hit) {
+  if (bvh->numNodes == 0)
+    return 0;
+  float d[3], inv[3];
+  normalizeRay(dir, d);
+  for (int k = 0; k < 3; k++)
+    inv[k] = 1.0f / d[k];
+
+  float best = FLT_MAX;
+  int bestIndex = -1;
+  int stack[MAX_DEPTH * 2], top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const BvhNode *n = &bvh->nodes[stack[--top]];
+    if (!rayBox(n, origin, inv, best))
+      continue;
+    if (n->right < 0) {
+      for (int i = n->first; i < n->first + n->count; i++) {
+        float t = rayCapsule(origin, d, &bvh->capsules[bvh->order[i]]);
+        if (t >= 0 && t < best) {
+          best = t;
+          bestIndex = bvh->order[i];
+        }
+      }
+    } else if (top + 2 <= MAX_DEPTH * 2) {
+      // Visita primeiro o filho mais proximo da origem do raio
+      int left = (int)(n - bvh->nodes) + 1, right = n->right;
+      const BvhNode *l = &bvh->nodes[left], *r = &bvh->nodes[right];
+      float dl = 0, dr = 0;
+      for (int k = 0; k < 3; k++) {
+        dl += (l->min[k] + l->max[k] - 2 * origin[k]) * d[k];
+        dr += (r->min[k] + r->max[k] - 2 * origin[k]) * d[k];
+      }
+      stack[top++] = dl < dr ? right : left;
+      stack[top++] = dl < dr ? left : right;
+    }
+  }
+  if (bestIndex < 0)
+    return 0;
+  fillHit(bvh->capsules, bestIndex, best, origin, d, hit);
+  return 1;
+}
+
+int pickRayBrute(const Capsule *capsules, int count, const float *origin,
+                 const float *dir, PickHit *hit) {
+  float d[3], best = FLT_MAX;
+  int bestIndex = -1;
+  normalizeRay(dir, d);
+  for (int i = 0; i < count; i++) {
+    float t = rayCapsule(origin, d, &capsules[i]);
+    if (t >= 0 && t < best) {
+      best = t;
+      bestIndex = i;
+    }
+  }
+  if (bestIndex < 0)
+    return 0;
+  fillHit(capsules, bestIndex, best, origin, d, hit);
+  return 1;
+}
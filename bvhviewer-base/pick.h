@@ -0,0 +1,33 @@
+#ifndef PICK_H
+#define PICK_H
+
+#include "capsule.h"
+
+// Hierarquia de volumes (AABBs) sobre as capsulas dos ossos. E montada uma
+// vez e, a cada frame, so tem as caixas reajustadas (refit) de baixo para
+// cima; se as caixas incharem demais em relacao a montagem, e remontada.
+typedef struct BoneBvh BoneBvh;
+
+typedef struct {
+  float t;        // distancia ao longo do raio (direcao normalizada)
+  float point[3]; // ponto atingido
+  int capsule;    // indice em capsules
+  int owner, node; // copiados da capsula
+} PickHit;
+
+// capsules deve continuar valido enquanto a hierarquia for usada; as
+// posicoes podem mudar entre refits, a quantidade e a ordem nao
+BoneBvh *createBoneBvh(const Capsule *capsules, int count);
+void freeBoneBvh(BoneBvh *bvh);
+// Reajusta as caixas as posicoes atuais das capsulas. Retorna 1 se a
+// hierarquia foi remontada
+int refitBoneBvh(BoneBvh *bvh);
+
+// Capsula mais proxima atingida pelo raio (0 se nenhuma)
+int pickRay(const BoneBvh *bvh, const float *origin, const float *dir,
+            PickHit *hit);
+// Idem, testando todas as capsulas (referencia para conferencia)
+int pickRayBrute(const Capsule *capsules, int count, const float *origin,
+                 const float *dir, PickHit *hit);
+
+#endif
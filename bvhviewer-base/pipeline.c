@@ -0,0 +1,275 @@
+// **********************************************************************
+//	pipeline.c
+//  Estagios com threads proprias ligados por filas limitadas (mutex e
+//  variaveis de condicao, varios produtores e consumidores)
+// **********************************************************************
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "pipeline.h"
+
+// Item em transito: seq e a ordem de envio (data NULL = descartado)
+typedef struct {
+  long seq;
+  void *data;
+} Slot;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty, notFull;
+  Slot *slots;  // anel de capacity posicoes
+  int capacity, head, count, maxCount;
+  int closed;
+  int ordered;
+  long next; // proximo seq esperado (filas ordenadas)
+} StageQueue;
+
+typedef struct {
+  PipelineStage def;
+  StageQueue in;
+  pthread_t *threads;
+  atomic_int live; // threads ainda rodando (a ultima fecha a proxima fila)
+  StageStats stats;
+} Stage;
+
+typedef struct {
+  Pipeline *p;
+  int stage, worker;
+} WorkerArg;
+
+// Os estagios ordenados esperam um item especifico; se a fila deles
+// pudesse lotar com itens posteriores, as threads do estagio anterior
+// ficariam presas segurando esses itens enquanto o esperado ainda esta na
+// fila delas. Por isso os itens em transito sao limitados a uma janela e
+// as filas ordenadas tem a capacidade da janela: nunca bloqueiam, e a
+// contrapressao de um estagio ordenado lento chega ao envio pela janela.
+struct Pipeline {
+  int numStages;
+  Stage *stages;
+  WorkerArg *args;
+  long submitted;
+  pthread_mutex_t flightLock;
+  pthread_cond_t flightDone;
+  int inFlight, window; // itens enviados que nao sairam do ultimo estagio
+  double start, elapsed;
+};
+
+static void initStageQueue(StageQueue *q, int capacity, int ordered) {
+  pthread_mutex_init(&q->lock, NULL);
+  pthread_cond_init(&q->notEmpty, NULL);
+  pthread_cond_init(&q->notFull, NULL);
+  q->capacity = capacity;
+  q->slots = malloc(capacity * sizeof(Slot));
+  q->head = q->count = q->maxCount = 0;
+  q->closed = 0;
+  q->ordered = ordered;
+  q->next = 0;
+}
+
+static void destroyStageQueue(StageQueue *q) {
+  pthread_mutex_destroy(&q->lock);
+  pthread_cond_destroy(&q->notEmpty);
+  pthread_cond_destroy(&q->notFull);
+  free(q->slots);
+}
+
+// Insere o item, esperando vaga. Retorna o tempo bloqueado
+static double queuePut(StageQueue *q, Slot s) {
+  double waited = 0;
+  pthread_mutex_lock(&q->lock);
+  while (q->count >= q->capacity) {
+    double start = nowSeconds();
+    pthread_cond_wait(&q->notFull, &q->lock);
+    waited += nowSeconds() - start;
+  }
+  q->slots[(q->head + q->count) % q->capacity] = s;
+  if (++q->count > q->maxCount)
+    q->maxCount = q->count;
+  // Numa fila ordenada o consumidor pode esperar um item especifico
+  if (q->ordered)
+    pthread_cond_broadcast(&q->notEmpty);
+  else
+    pthread_cond_signal(&q->notEmpty);
+  pthread_mutex_unlock(&q->lock);
+  return waited;
+}
+
+// Posicao do item que pode sair (-1 se nenhum)
+static int readySlot(const StageQueue *q) {
+  if (!q->ordered)
+    return q->count ? q->head : -1;
+  for (int i = 0; i < q->count; i++) {
+    int k = (q->head + i) % q->capacity;
+    if (q->slots[k].seq == q->next)
+      return k;
+  }
+  return -1;
+}
+
+// Retira um item, esperando se preciso. Retorna 0 quando a fila foi
+// fechada e esvaziada
+static int queueTake(StageQueue *q, Slot *s, double *waited) {
+  int k;
+  pthread_mutex_lock(&q->lock);
+  while ((k = readySlot(q)) < 0 && !(q->closed && q->count == 0)) {
+    double start = nowSeconds();
+    pthread_cond_wait(&q->notEmpty, &q->lock);
+    *waited += nowSeconds() - start;
+  }
+  if (k < 0) {
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+  }
+  // Tira da posicao k trocando-a com a cabeca do anel
+  *s = q->slots[k];
+  q->slots[k] = q->slots[q->head];
+  q->head = (q->head + 1) % q->capacity;
+  q->count--;
+  q->next++;
+  pthread_cond_signal(&q->notFull);
+  // Outro consumidor pode estar esperando o item seguinte
+  if (q->ordered)
+    pthread_cond_broadcast(&q->notEmpty);
+  pthread_mutex_unlock(&q->lock);
+  return 1;
+}
+
+static void closeStageQueue(StageQueue *q) {
+  pthread_mutex_lock(&q->lock);
+  q->closed = 1;
+  pthread_cond_broadcast(&q->notEmpty);
+  pthread_mutex_unlock(&q->lock);
+}
+
+static void *stageLoop(void *arg) {
+  WorkerArg *w = arg;
+  Pipeline *p = w->p;
+  Stage *st = &p->stages[w->stage];
+  Stage *next = w->stage + 1 < p->numStages ? st + 1 : NULL;
+  long items = 0;
+  double busy = 0, starved = 0, blocked = 0;
+  Slot s;
+  while (queueTake(&st->in, &s, &starved)) {
+    if (s.data) {
+      double start = nowSeconds();
+      s.data = st->def.fn(s.data, w->worker, st->def.ctx);
+      busy += nowSeconds() - start;
+      items++;
+    }
+    if (next)
+      blocked += queuePut(&next->in, s);
+    else {
+      pthread_mutex_lock(&p->flightLock);
+      p->inFlight--;
+      pthread_cond_signal(&p->flightDone);
+      pthread_mutex_unlock(&p->flightLock);
+    }
+  }
+
+  pthread_mutex_lock(&st->in.lock);
+  st->stats.items += items;
+  st->stats.busy += busy;
+  st->stats.starved += starved;
+  st->stats.blocked += blocked;
+  pthread_mutex_unlock(&st->in.lock);
+  if (atomic_fetch_sub(&st->live, 1) == 1 && next)
+    closeStageQueue(&next->in);
+  return NULL;
+}
+
+Pipeline *startPipeline(const PipelineStage *stages, int numStages,
+                        int capacity) {
+  Pipeline *p = calloc(1, sizeof(Pipeline));
+  p->numStages = numStages;
+  p->stages = calloc(numStages, sizeof(Stage));
+  p->start = nowSeconds();
+  capacity = capacity > 0 ? capacity : 1;
+  p->window = capacity * numStages;
+  pthread_mutex_init(&p->flightLock, NULL);
+  pthread_cond_init(&p->flightDone, NULL);
+  int total = 0;
+  for (int i = 0; i < numStages; i++) {
+    Stage *st = &p->stages[i];
+    st->def = stages[i];
+    if (st->def.workers <= 0)
+      st->def.workers = defaultThreads();
+    initStageQueue(&st->in, st->def.ordered ? p->window : capacity,
+                   st->def.ordered);
+    atomic_init(&st->live, st->def.workers);
+    st->stats.name = st->def.name;
+    st->stats.workers = st->def.workers;
+    total += st->def.workers;
+  }
+  p->args = malloc(total * sizeof(WorkerArg));
+  WorkerArg *arg = p->args;
+  for (int i = 0; i < numStages; i++) {
+    Stage *st = &p->stages[i];
+    st->threads = malloc(st->def.workers * sizeof(pthread_t));
+    for (int t = 0; t < st->def.workers; t++, arg++) {
+      arg->p = p;
+      arg->stage = i;
+      arg->worker = t;
+      pthread_create(&st->threads[t], NULL, stageLoop, arg);
+    }
+  }
+  return p;
+}
+
+void pipelineSubmit(Pipeline *p, void *item) {
+  pthread_mutex_lock(&p->flightLock);
+  while (p->inFlight >= p->window)
+    pthread_cond_wait(&p->flightDone, &p->flightLock);
+  p->inFlight++;
+  pthread_mutex_unlock(&p->flightLock);
+  Slot s = {p->submitted++, item};
+  queuePut(&p->stages[0].in, s);
+}
+
+double finishPipeline(Pipeline *p) {
+  closeStageQueue(&p->stages[0].in);
+  for (int i = 0; i < p->numStages; i++) {
+    Stage *st = &p->stages[i];
+    for (int t = 0; t < st->def.workers; t++)
+      pthread_join(st->threads[t], NULL);
+    st->stats.maxQueued = st->in.maxCount;
+  }
+  p->elapsed = nowSeconds() - p->start;
+  return p->elapsed;
+}
+
+int pipelineStats(const Pipeline *p, StageStats *out) {
+  for (int i = 0; i < p->numStages; i++)
+    out[i] = p->stages[i].stats;
+  return p->numStages;
+}
+
+void printPipelineStats(const Pipeline *p, FILE *out) {
+  fprintf(out, "%-12s %7s %7s %8s %9s %9s %6s\n", "estagio", "threads",
+          "itens", "ocupacao", "sem-itens", "bloqueado", "fila");
+  for (int i = 0; i < p->numStages; i++) {
+    const StageStats *s = &p->stages[i].stats;
+    double available = p->elapsed * s->workers;
+    fprintf(out, "%-12s %7d %7ld %7.1f%% %8.3fs %8.3fs %3d/%d\n", s->name,
+            s->workers, s->items, available > 0 ? 100 * s->busy / available : 0,
+            s->starved, s->blocked, s->maxQueued, p->stages[i].in.capacity);
+  }
+  fprintf(out, "total: %.3f s\n", p->elapsed);
+}
+
+void freePipeline(Pipeline *p) {
+  if (!p)
+    return;
+  for (int i = 0; i < p->numStages; i++) {
+    destroyStageQueue(&p->stages[i].in);
+    free(p->stages[i].threads);
+  }
+  pthread_mutex_destroy(&p->flightLock);
+  pthread_cond_destroy(&p->flightDone);
+  free(p->stages);
+  free(p->args);
+  free(p);
+}
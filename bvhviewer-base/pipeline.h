@@ -0,0 +1,57 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+
+// Pipeline de estagios ligados por filas limitadas. Cada estagio tem as
+// suas threads; um estagio lento enche a fila de entrada e bloqueia quem
+// produz para ele (contrapressao), ate o envio inicial.
+
+// Corpo de um estagio: recebe o item e retorna o que segue para o proximo
+// (NULL descarta; o item vira um buraco que so mantem a ordem)
+typedef void *(*StageFn)(void *item, int worker, void *ctx);
+
+typedef struct PipelineStage {
+  const char *name;
+  StageFn fn;
+  void *ctx;
+  int workers; // threads do estagio (<= 0: defaultThreads())
+  int ordered; // recebe os itens na ordem de envio (ex.: saida)
+} PipelineStage;
+
+// Medidas de um estagio (somadas entre as threads, em segundos)
+typedef struct StageStats {
+  const char *name;
+  int workers;
+  long items;     // itens processados (chamadas de fn)
+  double busy;    // tempo dentro de fn
+  double starved; // tempo esperando a fila de entrada
+  double blocked; // tempo esperando vaga na fila do proximo estagio
+  int maxQueued;  // maior ocupacao da fila de entrada
+} StageStats;
+
+typedef struct Pipeline Pipeline;
+
+// Inicia as threads; capacity e o tamanho de cada fila. No maximo
+// capacity * numStages itens ficam em transito (e esse e o tamanho das
+// filas dos estagios ordenados, que por isso nunca bloqueiam)
+Pipeline *startPipeline(const PipelineStage *stages, int numStages,
+                        int capacity);
+
+// Envia um item ao primeiro estagio (bloqueia se a fila estiver cheia).
+// Deve ser chamada por uma so thread
+void pipelineSubmit(Pipeline *p, void *item);
+
+// Fecha a entrada e espera todos os itens passarem por todos os estagios.
+// Retorna o tempo total desde startPipeline
+double finishPipeline(Pipeline *p);
+
+// Medidas dos estagios (apos finishPipeline); retorna a qtd de estagios
+int pipelineStats(const Pipeline *p, StageStats *out);
+
+// Tabela com a ocupacao de cada estagio (busy / (tempo * threads))
+void printPipelineStats(const Pipeline *p, FILE *out);
+
+void freePipeline(Pipeline *p);
+
+#endif
@@ -0,0 +1,137 @@
+// **********************************************************************
+//	posepub.c
+//  Publica a pose atual em memoria compartilhada POSIX (seqlock), para
+//  que outros processos a leiam sem locks (ver poseshm.h)
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "posepub.h"
+#include "skeleton.h"
+
+struct PosePublisher {
+  char *name;
+  PoseShm *shm;
+  // Clip da ultima publicacao: o esqueleto so e reescrito quando muda
+  const Clip *clip;
+  const Node *root;
+};
+
+#ifndef WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+PosePublisher *createPosePublisher(const char *name) {
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    printf("Erro: nao foi possivel criar a memoria compartilhada %s\n", name);
+    return NULL;
+  }
+  if (ftruncate(fd, sizeof(PoseShm)) != 0) {
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  void *p = mmap(NULL, sizeof(PoseShm), PROT_READ | PROT_WRITE, MAP_SHARED,
+                 fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    shm_unlink(name);
+    return NULL;
+  }
+  // O segmento novo vem zerado; magic por ultimo, quando o resto ja vale
+  PoseShm *shm = p;
+  shm->version = POSE_SHM_VERSION;
+  shm->size = sizeof(PoseShm);
+  atomic_store_explicit(&shm->seq, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  shm->magic = POSE_SHM_MAGIC;
+
+  PosePublisher *pub = calloc(1, sizeof(PosePublisher));
+  pub->name = strdup(name);
+  pub->shm = shm;
+  return pub;
+}
+
+void freePosePublisher(PosePublisher *p) {
+  if (!p)
+    return;
+  munmap(p->shm, sizeof(PoseShm));
+  shm_unlink(p->name);
+  free(p->name);
+  free(p);
+}
+
+// Nomes e pais em pre-ordem (dentro da escrita protegida por seq). O
+// i-esimo nome e o do nodo i: um nome que nao cabe e truncado, sempre com
+// o '\0' e reservando ao menos 1 byte para cada nodo seguinte (com
+// POSE_SHM_MAX_NODES nodos sobram 32 bytes por nome)
+static void writeSkeleton(PoseShm *shm, const Clip *clip) {
+  char *names = shm->skeleton.names;
+  size_t used = 0;
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    shm->skeleton.parent[i] = node->parent ? node->parent->index : -1;
+    size_t room = POSE_SHM_NAMES_BYTES - used - (clip->numNodes - 1 - i);
+    size_t n = strlen(node->name);
+    if (n + 1 > room)
+      n = room - 1;
+    memcpy(names + used, node->name, n);
+    names[used + n] = '\0';
+    used += n + 1;
+  }
+  memset(names + used, 0, POSE_SHM_NAMES_BYTES - used);
+  shm->pose.hierarchy = (uint32_t)skeletonHash(clip->root, SKELETON_TOLERANCE);
+}
+
+int publishPose(PosePublisher *p, const Clip *clip, int frame) {
+  if (clip->numNodes > POSE_SHM_MAX_NODES ||
+      clip->totalChannels > POSE_SHM_MAX_CHANNELS)
+    return 0;
+  PoseShm *shm = p->shm;
+  PoseShmPose *pose = &shm->pose;
+
+  // seq impar: escrita em andamento. A barreira impede que os dados
+  // fiquem visiveis antes do incremento.
+  uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+  atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  if (clip != p->clip || clip->root != p->root) {
+    writeSkeleton(shm, clip);
+    p->clip = clip;
+    p->root = clip->root;
+  }
+  pose->numNodes = clip->numNodes;
+  pose->numChannels = clip->totalChannels;
+  pose->frame = frame;
+  pose->frameTime = clip->frameTime;
+  pose->time = nowSeconds();
+  pose->count++;
+  for (int i = 0; i < clip->numNodes; i++)
+    memcpy(pose->world[i], clip->nodes[i]->world, 16 * sizeof(float));
+  memcpy(pose->channels, clip->data[frame],
+         clip->totalChannels * sizeof(float));
+
+  atomic_store_explicit(&shm->seq, seq + 2, memory_order_release);
+  return 1;
+}
+
+#else
+
+PosePublisher *createPosePublisher(const char *name) {
+  printf("Erro: memoria compartilhada POSIX indisponivel no Windows\n");
+  return NULL;
+}
+
+void freePosePublisher(PosePublisher *p) {}
+
+int publishPose(PosePublisher *p, const Clip *clip, int frame) { return 0; }
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef POSEPUB_H
+#define POSEPUB_H
+
+#include "bvh.h"
+#include "poseshm.h"
+
+// Escritor do segmento de poseshm.h (um por nome)
+typedef struct PosePublisher PosePublisher;
+
+// Cria (ou recria) o segmento. Retorna NULL em caso de erro
+PosePublisher *createPosePublisher(const char *name);
+// Remove o segmento; leitores que ja o mapearam continuam lendo a ultima pose
+void freePosePublisher(PosePublisher *p);
+
+// Publica as matrizes globais dos nodos (node->world, ja atualizadas por
+// applyFrame) e os canais do frame. Retorna 0 se o clip nao couber
+int publishPose(PosePublisher *p, const Clip *clip, int frame);
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef POSESHM_H
+#define POSESHM_H
+
+// **********************************************************************
+//  Pose atual do viewer em memoria compartilhada POSIX (opcao -p).
+//  Este cabecalho nao depende do resto do projeto: outros programas
+//  (C11) o incluem para ler a pose sem locks.
+//
+//  O segmento e protegido por um seqlock: o escritor incrementa seq antes
+//  e depois de cada atualizacao, de modo que seq impar indica escrita em
+//  andamento. O leitor le seq, le os dados direto do mapeamento e confere
+//  se seq nao mudou; se mudou, tenta de novo. Leitores nunca bloqueiam o
+//  escritor, e qualquer qtd deles pode ler ao mesmo tempo.
+//
+//    const PoseShm *s = poseShmOpen(POSE_SHM_NAME);
+//    uint32_t seq;
+//    do {
+//      seq = poseShmBegin(s);
+//      x = s->pose.world[j][12];   // so os campos necessarios, sem copia
+//    } while (poseShmRetry(s, seq));
+//
+//  (ou poseShmRead para copiar a pose inteira de forma consistente)
+//
+//  Linux: ligar com -lrt em glibc anterior a 2.34
+// **********************************************************************
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define POSE_SHM_NAME "/bvhviewer-pose"
+#define POSE_SHM_MAGIC 0x45534f50 // "POSE"
+#define POSE_SHM_VERSION 1
+
+#define POSE_SHM_MAX_NODES 256
+#define POSE_SHM_MAX_CHANNELS 1024
+#define POSE_SHM_NAMES_BYTES 8192
+
+// Dados de cada frame
+typedef struct PoseShmPose {
+  uint32_t hierarchy;  // identificador do esqueleto (muda com o clip)
+  int32_t numNodes;    // inclui os End Site
+  int32_t numChannels;
+  int32_t frame;       // frame do clip
+  float frameTime;
+  uint32_t reserved;
+  double time;         // relogio monotonico do escritor (segundos)
+  uint64_t count;      // qtd de publicacoes desde a criacao
+  // Matriz global 4x4 de cada nodo (coluna-major, pre-ordem: pai antes
+  // dos filhos; a posicao da junta esta em world[i][12..14])
+  float world[POSE_SHM_MAX_NODES][16];
+  float channels[POSE_SHM_MAX_CHANNELS]; // valores de canal do frame
+} PoseShmPose;
+
+// Esqueleto (so muda junto com pose.hierarchy)
+typedef struct PoseShmSkeleton {
+  int16_t parent[POSE_SHM_MAX_NODES];  // indice do pai (-1 na raiz)
+  char names[POSE_SHM_NAMES_BYTES];    // nomes em pre-ordem, separados
+                                       // por '\0' (truncados se nao
+                                       // couberem todos)
+} PoseShmSkeleton;
+
+typedef struct PoseShm {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;       // sizeof(PoseShm) do escritor
+  uint32_t reserved;
+  _Alignas(64) _Atomic uint32_t seq;
+  _Alignas(64) PoseShmPose pose;
+  PoseShmSkeleton skeleton;
+} PoseShm;
+
+#ifndef WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Mapeia o segmento somente para leitura (NULL se nao existir ou se for de
+// outra versao)
+static inline const PoseShm *poseShmOpen(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  void *p = mmap(NULL, sizeof(PoseShm), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return NULL;
+  const PoseShm *s = (const PoseShm *)p;
+  if (s->magic != POSE_SHM_MAGIC || s->version != POSE_SHM_VERSION ||
+      s->size != sizeof(PoseShm)) {
+    munmap(p, sizeof(PoseShm));
+    return NULL;
+  }
+  return s;
+}
+
+static inline void poseShmClose(const PoseShm *s) {
+  if (s)
+    munmap((void *)s, sizeof(PoseShm));
+}
+
+// Inicio de uma leitura: espera o escritor terminar e devolve seq
+static inline uint32_t poseShmBegin(const PoseShm *s) {
+  uint32_t seq;
+  while ((seq = atomic_load_explicit((_Atomic uint32_t *)&s->seq,
+                                     memory_order_acquire)) & 1)
+    ;
+  return seq;
+}
+
+// Fim de uma leitura: 1 se os dados lidos podem estar misturados (repetir)
+static inline int poseShmRetry(const PoseShm *s, uint32_t seq) {
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit((_Atomic uint32_t *)&s->seq,
+                              memory_order_relaxed) != seq;
+}
+
+// Copia consistente da pose (so os nodos e canais usados). Retorna a qtd
+// de tentativas que foram necessarias
+static inline int poseShmRead(const PoseShm *s, PoseShmPose *out) {
+  const size_t head = offsetof(PoseShmPose, world);
+  uint32_t seq;
+  int tries = 0;
+  do {
+    seq = poseShmBegin(s);
+    tries++;
+    memcpy(out, &s->pose, head);
+    int nodes = out->numNodes, channels = out->numChannels;
+    if (nodes < 0 || nodes > POSE_SHM_MAX_NODES || channels < 0 ||
+        channels > POSE_SHM_MAX_CHANNELS)
+      continue; // lido no meio de uma escrita: poseShmRetry confirma
+    memcpy(out->world, s->pose.world, nodes * sizeof(out->world[0]));
+    memcpy(out->channels, s->pose.channels, channels * sizeof(float));
+  } while (poseShmRetry(s, seq));
+  return tries;
+}
+
+// Copia consistente do esqueleto; hierarchy recebe o identificador lido
+static inline void poseShmReadSkeleton(const PoseShm *s, PoseShmSkeleton *out,
+                                       uint32_t *hierarchy) {
+  uint32_t seq;
+  do {
+    seq = poseShmBegin(s);
+    *hierarchy = s->pose.hierarchy;
+    memcpy(out, &s->skeleton, sizeof(*out));
+  } while (poseShmRetry(s, seq));
+}
+
+#endif
+
+#endif
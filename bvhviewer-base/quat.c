@@ -0,0 +1,232 @@
+// **********************************************************************
+//	quat.c
+//  Conversao de angulos de Euler em quaternions (escalar e SSE) e
+//  trilhas de quaternions pre-calculadas de um clip
+// **********************************************************************
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "parallel.h"
+#include "quat.h"
+
+#define HALF_DEG_TO_RAD ((float)(M_PI / 360.0))
+
+void quatMul(const float *a, const float *b, float *out) {
+  float r[4];
+  r[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+  r[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+  r[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+  r[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+  memcpy(out, r, sizeof(r));
+}
+
+void eulerToQuat(const float *angles, const char *order, float *q) {
+  q[0] = q[1] = q[2] = 0;
+  q[3] = 1;
+  for (int k = 0; k < 3; k++) {
+    float h = angles[k] * HALF_DEG_TO_RAD;
+    float axis[4] = {0, 0, 0, cosf(h)};
+    axis[order[k] - 'X'] = sinf(h);
+    quatMul(q, axis, q);
+  }
+}
+
+void quatToEuler(const float *q, const char *order, float *angles) {
+  // Matriz de rotacao (linha, coluna) do quaternion
+  float x = q[0], y = q[1], z = q[2], w = q[3], m[3][3];
+  m[0][0] = 1 - 2 * (y * y + z * z);
+  m[0][1] = 2 * (x * y - z * w);
+  m[0][2] = 2 * (x * z + y * w);
+  m[1][0] = 2 * (x * y + z * w);
+  m[1][1] = 1 - 2 * (x * x + z * z);
+  m[1][2] = 2 * (y * z - x * w);
+  m[2][0] = 2 * (x * z - y * w);
+  m[2][1] = 2 * (y * z + x * w);
+  m[2][2] = 1 - 2 * (x * x + y * y);
+
+  // R = Ra * Rb * Rc; s = +1 se (a, b, c) for uma permutacao ciclica
+  int i = order[0] - 'X', j = order[1] - 'X', k = order[2] - 'X';
+  float s = (j - i + 3) % 3 == 1 ? 1.0f : -1.0f;
+  float sb = s * m[i][k];
+  sb = sb > 1 ? 1 : sb < -1 ? -1 : sb;
+  const float toDeg = (float)(180.0 / M_PI);
+  angles[0] = atan2f(-s * m[j][k], m[k][k]) * toDeg;
+  angles[1] = asinf(sb) * toDeg;
+  angles[2] = atan2f(-s * m[i][j], m[i][i]) * toDeg;
+}
+
+#ifdef __SSE2__
+
+// Seno e cosseno de 4 valores (reducao para [-pi/4, pi/4] e polinomios
+// minimax, como na cephes; erro ~1e-7 para |x| < 8192)
+static void sincos4(__m128 x, __m128 *s, __m128 *c) {
+  const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+  __m128 signSin = _mm_and_ps(x, signMask);
+  x = _mm_andnot_ps(signMask, x);
+
+  __m128 y = _mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)); // 4 / pi
+  __m128i j = _mm_cvttps_epi32(y);
+  j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+  y = _mm_cvtepi32_ps(j);
+
+  __m128 swapSin =
+      _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+  __m128 polyMask = _mm_castsi128_ps(
+      _mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+  __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)),
+      29));
+  signSin = _mm_xor_ps(signSin, swapSin);
+
+  // x = x - y * pi/4, em tres partes para nao perder precisao
+  x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+  x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+  x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 pc = _mm_set1_ps(2.443315711809948e-5f);
+  pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(-1.388731625493765e-3f));
+  pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+  pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+  pc = _mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  pc = _mm_add_ps(pc, _mm_set1_ps(1.0f));
+
+  __m128 ps = _mm_set1_ps(-1.9515295891e-4f);
+  ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(8.3321608736e-3f));
+  ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+  ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+  // Em octantes alternados seno e cosseno trocam de polinomio
+  __m128 sinv = _mm_or_ps(_mm_and_ps(polyMask, ps), _mm_andnot_ps(polyMask, pc));
+  __m128 cosv = _mm_or_ps(_mm_and_ps(polyMask, pc), _mm_andnot_ps(polyMask, ps));
+  *s = _mm_xor_ps(sinv, signSin);
+  *c = _mm_xor_ps(cosv, signCos);
+}
+
+static __m128 gather4(const float *p, int stride) {
+  return _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+}
+
+#endif
+
+void eulerToQuats(const float *angles, int stride, const char *order, int n,
+                  float *out, int outStride) {
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 half = _mm_set1_ps(HALF_DEG_TO_RAD);
+  for (; i + 4 <= n; i += 4) {
+    const float *a = angles + (long)i * stride;
+    // q = produto das rotacoes de cada eixo, 4 itens por registrador (SoA)
+    __m128 q[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(),
+                   _mm_set1_ps(1.0f)};
+    for (int k = 0; k < 3; k++) {
+      __m128 s, c;
+      sincos4(_mm_mul_ps(gather4(a + k, stride), half), &s, &c);
+      // q * (s no eixo e, c): so sobrevivem os termos com o eixo e
+      int e = order[k] - 'X', e1 = (e + 1) % 3, e2 = (e + 2) % 3;
+      __m128 r[4];
+      r[e] = _mm_add_ps(_mm_mul_ps(q[3], s), _mm_mul_ps(q[e], c));
+      r[e1] = _mm_add_ps(_mm_mul_ps(q[e1], c), _mm_mul_ps(q[e2], s));
+      r[e2] = _mm_sub_ps(_mm_mul_ps(q[e2], c), _mm_mul_ps(q[e1], s));
+      r[3] = _mm_sub_ps(_mm_mul_ps(q[3], c), _mm_mul_ps(q[e], s));
+      memcpy(q, r, sizeof(q));
+    }
+    // SoA -> AoS (x, y, z, w de cada item)
+    _MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+    for (int k = 0; k < 4; k++)
+      _mm_storeu_ps(out + (long)(i + k) * outStride, q[k]);
+  }
+#endif
+  for (; i < n; i++)
+    eulerToQuat(angles + (long)i * stride, order, out + (long)i * outStride);
+
+  // Mantem a continuidade do sinal (q e -q sao a mesma rotacao)
+  for (i = 1; i < n; i++) {
+    float *q = out + (long)i * outStride, *p = q - outStride;
+    if (p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3] < 0)
+      for (int k = 0; k < 4; k++)
+        q[k] = -q[k];
+  }
+}
+
+void quatNlerp(const float *a, const float *b, float t, float *out) {
+  float sign =
+      a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0 ? -1.0f : 1.0f;
+  float len = 0;
+  for (int k = 0; k < 4; k++) {
+    out[k] = a[k] + (sign * b[k] - a[k]) * t;
+    len += out[k] * out[k];
+  }
+  len = 1.0f / sqrtf(len);
+  for (int k = 0; k < 4; k++)
+    out[k] *= len;
+}
+
+// **********************************************************************
+//  Trilhas de quaternions
+// **********************************************************************
+
+typedef struct {
+  Clip *clip;
+  Node **joints; // nodo de cada trilha
+} QuatJob;
+
+static void convertJoint(int r, int thread, void *ctx) {
+  QuatJob *job = ctx;
+  Clip *clip = job->clip;
+  const Node *node = job->joints[r];
+  eulerToQuats(clip->motion + node->channelOffset + node->rotationChannel,
+               clip->totalChannels, node->rotationOrder, clip->totalFrames,
+               clip->quats + r * 4, clip->numRotations * 4);
+}
+
+void buildQuatTracks(Clip *clip, int numThreads) {
+  QuatJob job = {clip, malloc(clip->numNodes * sizeof(Node *))};
+  int count = 0;
+  for (int i = 0; i < clip->numNodes; i++) {
+    Node *node = clip->nodes[i];
+    node->quatIndex = -1;
+    if (node->channelOffset >= 0 && node->rotationChannel >= 0) {
+      node->quatIndex = count;
+      node->dirty = 1;
+      job.joints[count++] = node;
+    }
+  }
+  free(clip->quats);
+  clip->numRotations = count;
+  clip->quats = malloc((size_t)clip->totalFrames * count * 4 * sizeof(float));
+  parallelFor(count, numThreads, convertJoint, &job);
+  free(job.joints);
+}
+
+const float *frameQuats(const Clip *clip, int frame) {
+  return clip->quats + (size_t)frame * clip->numRotations * 4;
+}
+
+void blendQuatPoses(const float *a, const float *b, int numRotations, float w,
+                    float *out) {
+  for (int r = 0; r < numRotations; r++)
+    quatNlerp(a + r * 4, b + r * 4, w, out + r * 4);
+}
+
+void computePoseQuat(const Clip *clip, const float *values, const float *quats,
+                     float *world) {
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    float *m = world + i * 16;
+    if (node->quatIndex >= 0) {
+      float t[3];
+      nodeTranslation(node, values, t);
+      quatMatrix(quats + node->quatIndex * 4, t, m);
+    } else
+      localMatrix(node, values, m);
+    if (node->parent)
+      matMul(world + node->parent->index * 16, m, m);
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef QUAT_H
+#define QUAT_H
+
+#include "bvh.h"
+
+// Quaternions no formato (x, y, z, w), o mesmo do glTF
+
+// Rotacoes em torno dos eixos de order (ex.: "ZXY"), compostas na ordem
+// em que aparecem (a mesma de drawNode), angulos em graus
+void eulerToQuat(const float *angles, const char *order, float *q);
+// Inversa de eulerToQuat (angulos em [-180, 180], o do meio em [-90, 90])
+void quatToEuler(const float *q, const char *order, float *angles);
+
+// Converte n trincas de angulos (graus) em quaternions. A trinca do item i
+// comeca em angles + i * stride e o quaternion vai para out + i * outStride.
+// Usa SSE (4 itens por vez, com seno/cosseno vetorizados) quando
+// disponivel. Quaternions consecutivos ficam no mesmo hemisferio, para que
+// a interpolacao entre eles seja a mais curta.
+void eulerToQuats(const float *angles, int stride, const char *order, int n,
+                  float *out, int outStride);
+
+// out = a * b (out pode ser a ou b)
+void quatMul(const float *a, const float *b, float *out);
+
+// Interpolacao linear normalizada entre dois quaternions
+void quatNlerp(const float *a, const float *b, float t, float *out);
+
+// **********************************************************************
+//  Trilhas de quaternions de um clip (conversao feita uma vez na carga)
+// **********************************************************************
+
+// Converte todos os canais de rotacao em clip->quats, em paralelo entre
+// as juntas, e marca os nodos para que updatePose use os quaternions
+void buildQuatTracks(Clip *clip, int numThreads);
+
+// Quaternions do frame (clip->numRotations * 4 floats)
+const float *frameQuats(const Clip *clip, int frame);
+
+// Mistura duas poses de quaternions (peso w da pose b)
+void blendQuatPoses(const float *a, const float *b, int numRotations, float w,
+                    float *out);
+
+// Como computePose, mas com as rotacoes tiradas de quats
+void computePoseQuat(const Clip *clip, const float *values, const float *quats,
+                     float *world);
+
+#endif
@@ -0,0 +1,53 @@
+// **********************************************************************
+//	queue.c
+//  Fila circular limitada sem locks (um produtor, um consumidor), usada
+//  para passar buffers entre a thread da GLUT e threads de trabalho
+// **********************************************************************
+
+#include <stdlib.h>
+
+#include "queue.h"
+
+int initQueue(SpscQueue *q, int capacity) {
+  unsigned size = 1;
+  while (size < (unsigned)capacity)
+    size <<= 1;
+  q->items = malloc(size * sizeof(void *));
+  if (!q->items)
+    return 0;
+  q->mask = size - 1;
+  atomic_init(&q->head, 0);
+  atomic_init(&q->tail, 0);
+  return 1;
+}
+
+void destroyQueue(SpscQueue *q) {
+  free(q->items);
+  q->items = NULL;
+}
+
+int queuePush(SpscQueue *q, void *item) {
+  unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+  if (tail - head > q->mask)
+    return 0;
+  q->items[tail & q->mask] = item;
+  atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+  return 1;
+}
+
+void *queuePop(SpscQueue *q) {
+  unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+  if (head == tail)
+    return NULL;
+  void *item = q->items[head & q->mask];
+  atomic_store_explicit(&q->head, head + 1, memory_order_release);
+  return item;
+}
+
+int queueCount(SpscQueue *q) {
+  unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+  unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+  return (int)(tail - head);
+}
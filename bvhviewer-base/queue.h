@@ -0,0 +1,31 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdatomic.h>
+
+// Fila circular limitada sem locks para um produtor e um consumidor
+// (SPSC). Guarda ponteiros; cada lado so escreve o seu indice, e a ordem
+// acquire/release garante que o item ja esta visivel quando o outro lado
+// enxerga o indice novo. Os indices ficam em linhas de cache separadas.
+typedef struct SpscQueue {
+  void **items;
+  unsigned mask; // capacidade - 1 (capacidade e potencia de 2)
+  _Alignas(64) atomic_uint head; // proximo item a retirar (consumidor)
+  _Alignas(64) atomic_uint tail; // proxima posicao livre (produtor)
+} SpscQueue;
+
+// Capacidade arredondada para cima ate uma potencia de 2. Retorna 0 em
+// caso de erro
+int initQueue(SpscQueue *q, int capacity);
+void destroyQueue(SpscQueue *q);
+
+// Produtor: retorna 0 se a fila estiver cheia
+int queuePush(SpscQueue *q, void *item);
+
+// Consumidor: retorna NULL se a fila estiver vazia
+void *queuePop(SpscQueue *q);
+
+// Qtd de itens na fila (aproximada se chamada durante push/pop)
+int queueCount(SpscQueue *q);
+
+#endif
@@ -0,0 +1,279 @@
+// **********************************************************************
+//	reload.c
+//  Recarga automatica do arquivo aberto quando ele e reescrito (inotify).
+//  A leitura acontece numa thread separada; a troca do clip e feita pela
+//  thread da GLUT entre dois frames (ver takeReload).
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reload.h"
+
+#ifdef __linux__
+
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static char *watchedPath = NULL;
+static char *watchedDir = NULL;
+static const char *watchedName = NULL;
+
+// Secao HIERARCHY do arquivo atual (tudo antes de MOTION) e seus canais
+static char *hierarchyText = NULL;
+static size_t hierarchyLength = 0;
+static int hierarchyChannels = 0;
+
+// Protege a recarga pendente e o buffer de movimento reaproveitavel
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static ReloadResult pending;
+static int hasPending = 0;
+static float *spareMotion = NULL;
+static float **spareData = NULL;
+static size_t spareValues = 0;
+static int spareFrames = 0;
+
+static char *readFile(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return NULL;
+  // ftell falha (-1) em algo que nao e um arquivo comum
+  long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+  char *text = size >= 0 && fseek(file, 0, SEEK_SET) == 0
+                   ? malloc((size_t)size + 1)
+                   : NULL;
+  if (!text) {
+    fclose(file);
+    return NULL;
+  }
+  *length = fread(text, 1, size, file);
+  text[*length] = '\0';
+  fclose(file);
+  return text;
+}
+
+// Inicio da linha "MOTION" (NULL se nao existir)
+static const char *findMotion(const char *text) {
+  const char *ptr = text;
+  while ((ptr = strstr(ptr, "MOTION")) != NULL) {
+    if (ptr == text || ptr[-1] == '\n')
+      return ptr;
+    ptr += 6;
+  }
+  return NULL;
+}
+
+static void rememberHierarchy(const char *text, size_t length, int channels) {
+  free(hierarchyText);
+  hierarchyText = malloc(length);
+  memcpy(hierarchyText, text, length);
+  hierarchyLength = length;
+  hierarchyChannels = channels;
+}
+
+static void discardResult(ReloadResult *r) {
+  if (r->clip)
+    freeClip(r->clip);
+  else {
+    free(r->motion);
+    free(r->data);
+  }
+}
+
+// Rele so a secao MOTION, reaproveitando o buffer devolvido por
+// recycleMotion quando ele for grande o bastante
+static int reloadMotion(const char *motionText, ReloadResult *r) {
+  const char *frames = strstr(motionText, "Frames:");
+  const char *frameTime = strstr(motionText, "Frame Time:");
+  if (!frames || !frameTime ||
+      sscanf(frames, "Frames: %d", &r->totalFrames) != 1 ||
+      sscanf(frameTime, "Frame Time: %f", &r->frameTime) != 1 ||
+      r->totalFrames <= 0) {
+    printf("Erro: cabecalho MOTION invalido\n");
+    return 0;
+  }
+  const char *values = strchr(frameTime, '\n');
+  if (!values)
+    return 0;
+
+  size_t numValues = (size_t)r->totalFrames * hierarchyChannels;
+  pthread_mutex_lock(&lock);
+  if (spareMotion && spareValues >= numValues &&
+      spareFrames >= r->totalFrames) {
+    r->motion = spareMotion;
+    r->data = spareData;
+  } else {
+    free(spareMotion);
+    free(spareData);
+    r->motion = malloc(numValues * sizeof(float));
+    r->data = malloc(r->totalFrames * sizeof(float *));
+  }
+  spareMotion = NULL;
+  spareData = NULL;
+  pthread_mutex_unlock(&lock);
+
+  size_t read = parseValues(values, r->motion, numValues);
+  int framesRead = (int)(read / hierarchyChannels);
+  if (framesRead == 0) {
+    free(r->motion);
+    free(r->data);
+    return 0;
+  }
+  r->totalFrames = framesRead;
+  for (int i = 0; i < framesRead; i++)
+    r->data[i] = r->motion + (size_t)i * hierarchyChannels;
+  return 1;
+}
+
+static void reloadFile() {
+  size_t length;
+  char *text = readFile(watchedPath, &length);
+  if (!text)
+    return;
+  const char *motion = findMotion(text);
+  if (!motion) {
+    printf("Aviso: %s sem MOTION (ainda sendo escrito?)\n", watchedPath);
+    free(text);
+    return;
+  }
+
+  ReloadResult r = {0};
+  size_t headerLength = motion - text;
+  int ok;
+  if (hierarchyText && headerLength == hierarchyLength &&
+      memcmp(text, hierarchyText, headerLength) == 0) {
+    ok = reloadMotion(motion, &r);
+    if (ok)
+      printf("%s: movimento recarregado (%d frames)\n", watchedPath,
+             r.totalFrames);
+  } else {
+    r.clip = loadClip(watchedPath);
+    ok = r.clip != NULL;
+    if (ok) {
+      rememberHierarchy(text, headerLength, r.clip->totalChannels);
+      printf("%s: hierarquia mudou, arquivo recarregado\n", watchedPath);
+    }
+  }
+  free(text);
+  if (!ok)
+    return;
+
+  // A recarga mais recente substitui uma que ainda nao foi trocada. Se a
+  // pendente traz uma hierarquia nova, ela continua valendo (o clip atual
+  // ainda tem a antiga) e so recebe o movimento novo
+  pthread_mutex_lock(&lock);
+  if (hasPending && pending.clip && !r.clip) {
+    Clip *c = pending.clip;
+    free(c->motion);
+    free(c->data);
+    c->motion = r.motion;
+    c->data = r.data;
+    c->totalFrames = r.totalFrames;
+    c->frameTime = r.frameTime;
+  } else {
+    if (hasPending)
+      discardResult(&pending);
+    pending = r;
+  }
+  hasPending = 1;
+  pthread_mutex_unlock(&lock);
+}
+
+static void *watchLoop(void *arg) {
+  int fd = *(int *)arg;
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    int changed = 0;
+    for (char *ptr = buf; ptr < buf + n;) {
+      struct inotify_event *event = (struct inotify_event *)ptr;
+      if (event->len && strcmp(event->name, watchedName) == 0)
+        changed = 1;
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+    if (changed)
+      reloadFile();
+  }
+  return NULL;
+}
+
+int startWatcher(const char *path, const Clip *clip) {
+  static int fd;
+  watchedPath = strdup(path);
+  watchedDir = strdup(path);
+  char *slash = strrchr(watchedDir, '/');
+  if (slash) {
+    *slash = '\0';
+    watchedName = watchedPath + (slash + 1 - watchedDir);
+  } else {
+    strcpy(watchedDir, ".");
+    watchedName = watchedPath;
+  }
+
+  size_t length;
+  char *text = readFile(path, &length);
+  const char *motion = text ? findMotion(text) : NULL;
+  if (motion)
+    rememberHierarchy(text, motion - text, clip->totalChannels);
+  free(text);
+
+  // Observa o diretorio: editores e scripts costumam substituir o arquivo
+  // (rename), o que invalidaria um watch no proprio arquivo
+  fd = inotify_init();
+  if (fd < 0 ||
+      inotify_add_watch(fd, watchedDir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    printf("Aviso: nao foi possivel observar %s\n", path);
+    return 0;
+  }
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, watchLoop, &fd) != 0)
+    return 0;
+  pthread_detach(thread);
+  printf("Observando %s para recarga automatica\n", path);
+  return 1;
+}
+
+int takeReload(ReloadResult *out) {
+  int taken = 0;
+  pthread_mutex_lock(&lock);
+  if (hasPending) {
+    *out = pending;
+    hasPending = 0;
+    taken = 1;
+  }
+  pthread_mutex_unlock(&lock);
+  return taken;
+}
+
+void recycleMotion(float *motion, float **data, int totalFrames,
+                   int totalChannels) {
+  pthread_mutex_lock(&lock);
+  free(spareMotion);
+  free(spareData);
+  spareMotion = motion;
+  spareData = data;
+  spareValues = (size_t)totalFrames * totalChannels;
+  spareFrames = totalFrames;
+  pthread_mutex_unlock(&lock);
+}
+
+#else
+
+int startWatcher(const char *path, const Clip *clip) {
+  printf("Aviso: recarga automatica so esta disponivel no Linux\n");
+  return 0;
+}
+
+int takeReload(ReloadResult *out) { return 0; }
+
+void recycleMotion(float *motion, float **data, int totalFrames,
+                   int totalChannels) {
+  free(motion);
+  free(data);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include "bvh.h"
+
+// Resultado de uma recarga feita em segundo plano. Se a secao HIERARCHY
+// nao mudou, so o movimento e relido (clip == NULL) e deve ser trocado no
+// clip atual; caso contrario, clip traz o arquivo completo.
+typedef struct ReloadResult {
+  Clip *clip;
+  float *motion;
+  float **data;
+  int totalFrames;
+  float frameTime;
+} ReloadResult;
+
+// Observa o arquivo com inotify e o recarrega numa thread quando ele for
+// reescrito. clip e o conteudo atual do arquivo. Retorna 0 se nao for
+// possivel (ou fora do Linux)
+int startWatcher(const char *path, const Clip *clip);
+
+// Pega a recarga pendente, se houver (chamar na thread da GLUT, entre frames)
+int takeReload(ReloadResult *out);
+
+// Devolve o buffer de movimento substituido para ser reaproveitado
+void recycleMotion(float *motion, float **data, int totalFrames,
+                   int totalChannels);
+
+#endif
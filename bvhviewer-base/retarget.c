@@ -0,0 +1,293 @@
+// **********************************************************************
+//	retarget.c
+//  Transferencia de movimento entre esqueletos (retargeting): preserva a
+//  orientacao global de cada osso e escala a translacao da raiz
+// **********************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "quat.h"
+#include "retarget.h"
+#include "skeleton.h"
+
+// Frames por tarefa de parallelFor
+#define RETARGET_BLOCK 256
+
+RetargetMap *loadRetargetMap(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    printf("Erro: nao foi possivel abrir %s\n", path);
+    return NULL;
+  }
+  RetargetMap *map = calloc(1, sizeof(RetargetMap));
+  int cap = 0;
+  char line[256], from[128], to[128];
+  while (fgets(line, sizeof(line), file)) {
+    char *comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+    int n = sscanf(line, "%127s %127s", from, to);
+    if (n <= 0)
+      continue;
+    if (n != 2) {
+      printf("Erro: linha invalida em %s: %s\n", path, from);
+      fclose(file);
+      freeRetargetMap(map);
+      return NULL;
+    }
+    if (map->count == cap) {
+      cap = cap ? cap * 2 : 32;
+      map->from = realloc(map->from, cap * sizeof(char *));
+      map->to = realloc(map->to, cap * sizeof(char *));
+    }
+    map->from[map->count] = strdup(from);
+    map->to[map->count++] = strdup(to);
+  }
+  fclose(file);
+  return map;
+}
+
+void freeRetargetMap(RetargetMap *map) {
+  if (!map)
+    return;
+  for (int i = 0; i < map->count; i++) {
+    free(map->from[i]);
+    free(map->to[i]);
+  }
+  free(map->from);
+  free(map->to);
+  free(map);
+}
+
+// Nodo de origem associado a um nodo de destino
+static const Node *matchNode(const Clip *source, const Node *node,
+                             const RetargetMap *map) {
+  if (!map)
+    return findClipNode(source, node->name);
+  for (int i = 0; i < map->count; i++)
+    if (strcmp(map->to[i], node->name) == 0)
+      return findClipNode(source, map->from[i]);
+  return NULL;
+}
+
+// Menor rotacao que leva a direcao a para a direcao b
+static void rotationBetween(const float *a, const float *b, float *q) {
+  float la = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+  float lb = sqrtf(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+  q[0] = q[1] = q[2] = 0;
+  q[3] = 1;
+  if (la < 1e-6f || lb < 1e-6f)
+    return;
+  float d = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / (la * lb);
+  if (d < -0.9999f) {
+    // Sentidos opostos: meia volta em torno de um eixo perpendicular a a
+    // (a x X, ou a x Y se a for quase paralelo a X)
+    float axis[3] = {0, a[2], -a[1]};
+    if (fabsf(a[0]) > 0.9f * la) {
+      axis[0] = -a[2];
+      axis[1] = 0;
+      axis[2] = a[0];
+    }
+    float len =
+        sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int k = 0; k < 3; k++)
+      q[k] = axis[k] / len;
+    q[3] = 0;
+    return;
+  }
+  q[0] = (a[1] * b[2] - a[2] * b[1]) / (la * lb);
+  q[1] = (a[2] * b[0] - a[0] * b[2]) / (la * lb);
+  q[2] = (a[0] * b[1] - a[1] * b[0]) / (la * lb);
+  q[3] = 1 + d;
+  float len = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int k = 0; k < 4; k++)
+    q[k] /= len;
+}
+
+// Posicoes de repouso (canais zerados) de todos os nodos
+static float *restPositions(const Clip *clip) {
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  float *pos = malloc(clip->numNodes * 3 * sizeof(float));
+  const float *rest = restPose(clip, world);
+  for (int i = 0; i < clip->numNodes; i++)
+    memcpy(pos + i * 3, rest + i * 16 + 12, 3 * sizeof(float));
+  free(world);
+  return pos;
+}
+
+// Altura da raiz acima do nodo mais baixo na pose de repouso
+static float hipHeight(const Clip *clip, const float *pos) {
+  float low = pos[1];
+  for (int i = 1; i < clip->numNodes; i++)
+    if (pos[i * 3 + 1] < low)
+      low = pos[i * 3 + 1];
+  return pos[1] - low;
+}
+
+Retarget *createRetarget(const Clip *source, const Clip *target,
+                         const RetargetMap *map) {
+  Retarget *rt = calloc(1, sizeof(Retarget));
+  rt->source = source;
+  rt->target = target;
+  rt->match = malloc(target->numNodes * sizeof(int));
+  rt->align = malloc(target->numNodes * 4 * sizeof(float));
+
+  for (int i = 0; i < target->numNodes; i++) {
+    const Node *node = target->nodes[i];
+    const Node *from = NULL;
+    if (node->numChildren > 0)
+      from = matchNode(source, node, map);
+    rt->match[i] = from ? from->index : -1;
+  }
+
+  float *srcPos = restPositions(source), *dstPos = restPositions(target);
+  float srcHeight = hipHeight(source, srcPos);
+  float dstHeight = hipHeight(target, dstPos);
+  rt->rootScale = srcHeight > 1e-6f ? dstHeight / srcHeight : 1.0f;
+
+  // Direcao de cada osso: do nodo ate o primeiro filho que tenha par na
+  // origem (End Sites correspondem ao End Site do nodo associado)
+  for (int i = 0; i < target->numNodes; i++) {
+    float *q = rt->align + i * 4;
+    q[0] = q[1] = q[2] = 0;
+    q[3] = 1;
+    if (rt->match[i] < 0)
+      continue;
+    const Node *from = source->nodes[rt->match[i]];
+    for (const Node *child = target->nodes[i]->children; child;
+         child = child->next) {
+      int other = rt->match[child->index];
+      if (other < 0 && child->numChildren == 0)
+        for (const Node *c = from->children; c; c = c->next)
+          if (c->numChildren == 0)
+            other = c->index;
+      if (other < 0)
+        continue;
+      float a[3], b[3];
+      for (int k = 0; k < 3; k++) {
+        a[k] = dstPos[child->index * 3 + k] - dstPos[i * 3 + k];
+        b[k] = srcPos[other * 3 + k] - srcPos[from->index * 3 + k];
+      }
+      rotationBetween(a, b, q);
+      break;
+    }
+  }
+  free(srcPos);
+  free(dstPos);
+  return rt;
+}
+
+void freeRetarget(Retarget *rt) {
+  if (!rt)
+    return;
+  free(rt->match);
+  free(rt->align);
+  free(rt);
+}
+
+typedef struct {
+  const Retarget *rt;
+  const Clip *source;
+  float *out;
+  int *channels; // canais de rotacao do destino
+} RetargetJob;
+
+static void retargetBlock(int b, int thread, void *ctx) {
+  RetargetJob *job = ctx;
+  const Retarget *rt = job->rt;
+  const Clip *src = job->source, *dst = rt->target;
+  // Rotacoes globais dos nodos da origem e do destino
+  float *srcGlobal = malloc((src->numNodes + dst->numNodes) * 4 * sizeof(float));
+  float *dstGlobal = srcGlobal + src->numNodes * 4;
+  const float identity[4] = {0, 0, 0, 1};
+
+  int end = (b + 1) * RETARGET_BLOCK;
+  if (end > src->totalFrames)
+    end = src->totalFrames;
+  for (int f = b * RETARGET_BLOCK; f < end; f++) {
+    const float *values = src->data[f], *quats = frameQuats(src, f);
+    for (int i = 0; i < src->numNodes; i++) {
+      const Node *node = src->nodes[i];
+      const float *local = node->quatIndex >= 0 ? quats + node->quatIndex * 4
+                                                : identity;
+      if (node->parent)
+        quatMul(srcGlobal + node->parent->index * 4, local, srcGlobal + i * 4);
+      else
+        memcpy(srcGlobal + i * 4, local, 4 * sizeof(float));
+    }
+
+    float *row = job->out + (size_t)f * dst->totalChannels;
+    for (int i = 0; i < dst->numNodes; i++) {
+      const Node *node = dst->nodes[i];
+      const float *parent =
+          node->parent ? dstGlobal + node->parent->index * 4 : identity;
+      float *global = dstGlobal + i * 4;
+      // Sem par, o nodo so acompanha o pai (rotacao local nula)
+      if (rt->match[i] >= 0)
+        quatMul(srcGlobal + rt->match[i] * 4, rt->align + i * 4, global);
+      else
+        memcpy(global, parent, 4 * sizeof(float));
+      if (node->channelOffset < 0)
+        continue;
+
+      float local[4], angles[3], t[3];
+      const float inverse[4] = {-parent[0], -parent[1], -parent[2], parent[3]};
+      quatMul(inverse, global, local);
+      quatToEuler(local, node->rotationOrder, angles);
+      memcpy(t, node->offset, sizeof(t));
+      if (rt->match[i] >= 0 && !node->parent) {
+        nodeTranslation(src->nodes[rt->match[i]], values, t);
+        for (int k = 0; k < 3; k++)
+          t[k] *= rt->rootScale;
+      }
+
+      float *ch = row + node->channelOffset;
+      for (int c = 0, r = 0; node->channelOrder[c]; c++) {
+        char axis = node->channelOrder[c];
+        ch[c] = axis >= 'a' ? t[axis - 'x'] : r < 3 ? angles[r++] : 0;
+      }
+    }
+  }
+  free(srcGlobal);
+}
+
+// Desfaz os saltos de 360 graus de um canal de rotacao ao longo dos frames
+static void unwrapChannel(int k, int thread, void *ctx) {
+  RetargetJob *job = ctx;
+  int stride = job->rt->target->totalChannels;
+  float *v = job->out + job->channels[k];
+  for (int f = 1; f < job->source->totalFrames; f++) {
+    float prev = v[(size_t)(f - 1) * stride], *cur = v + (size_t)f * stride;
+    *cur -= 360.0f * roundf((*cur - prev) / 360.0f);
+  }
+}
+
+float *retargetMotion(const Retarget *rt, Clip *source, int numThreads) {
+  if (!source->quats)
+    buildQuatTracks(source, numThreads);
+  const Clip *dst = rt->target;
+  RetargetJob job = {rt, source,
+                     malloc((size_t)source->totalFrames * dst->totalChannels *
+                            sizeof(float)),
+                     malloc(dst->totalChannels * sizeof(int))};
+  int blocks = (source->totalFrames + RETARGET_BLOCK - 1) / RETARGET_BLOCK;
+  parallelFor(blocks, numThreads, retargetBlock, &job);
+
+  // quatToEuler devolve angulos em [-180, 180]; a continuidade entre
+  // frames e restaurada canal a canal
+  int count = 0;
+  for (int i = 0; i < dst->numNodes; i++) {
+    const Node *node = dst->nodes[i];
+    if (node->channelOffset >= 0)
+      for (int c = 0; node->channelOrder[c]; c++)
+        if (node->channelOrder[c] < 'a')
+          job.channels[count++] = node->channelOffset + c;
+  }
+  parallelFor(count, numThreads, unwrapChannel, &job);
+  free(job.channels);
+  return job.out;
+}
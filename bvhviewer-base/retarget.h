@@ -0,0 +1,40 @@
+#ifndef RETARGET_H
+#define RETARGET_H
+
+#include "bvh.h"
+
+// Pares "junta de origem -> junta de destino"
+typedef struct {
+  int count;
+  char **from, **to;
+} RetargetMap;
+
+// Le um arquivo de mapeamento: uma linha "origem destino" por junta,
+// '#' inicia comentario. NULL em caso de erro
+RetargetMap *loadRetargetMap(const char *path);
+void freeRetargetMap(RetargetMap *map);
+
+// Correspondencia entre dois esqueletos, calculada a partir das poses de
+// repouso (todos os canais zerados)
+typedef struct {
+  const Clip *source, *target;
+  int *match;      // por nodo de destino: indice do nodo de origem ou -1
+  float *align;    // por nodo de destino: quaternion que leva a direcao do
+                   // osso no destino para a direcao no origem
+  float rootScale; // altura do quadril no destino / na origem
+} Retarget;
+
+// map = NULL associa as juntas pelo nome. Os dois clips precisam existir
+// enquanto o Retarget for usado
+Retarget *createRetarget(const Clip *source, const Clip *target,
+                         const RetargetMap *map);
+void freeRetarget(Retarget *rt);
+
+// Converte o movimento da origem para os canais do destino: as rotacoes
+// globais de cada osso sao preservadas (corrigidas pela diferenca entre as
+// poses de repouso) e a translacao da raiz e escalada pela altura do
+// quadril. Devolve source->totalFrames x target->totalChannels valores.
+// Cria as trilhas de quaternions da origem se ainda nao existirem.
+float *retargetMotion(const Retarget *rt, Clip *source, int numThreads);
+
+#endif
@@ -0,0 +1,227 @@
+// **********************************************************************
+//	rootmotion.c
+//  Trajetoria da raiz (posicao no plano, heading, velocidades) e poses
+//  relativas a ela, calculadas uma vez por clip
+// **********************************************************************
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "parallel.h"
+#include "quat.h"
+#include "rootmotion.h"
+
+// Frames por tarefa de parallelFor
+#define ROOT_BLOCK 256
+
+typedef struct {
+  Clip *clip;
+  const float *quats; // rotacao da raiz em cada frame (NULL = sem rotacao)
+  int posX, posZ;     // canais de posicao da raiz (-1 se nao houver)
+  float side[3];      // direcao da direita para a esquerda, local a raiz
+  float *dirX, *dirZ; // direcao do heading (seno e cosseno)
+} RootJob;
+
+// Posicao do canal de posicao axis ('x', 'y' ou 'z') da raiz, -1 se nao
+// houver
+static int positionChannel(const Node *root, char axis) {
+  const char *c = strchr(root->channelOrder, axis);
+  return c && root->channelOffset >= 0 ? root->channelOffset +
+                                             (int)(c - root->channelOrder)
+                                       : -1;
+}
+
+static void rootBlock(int block, int thread, void *ctx) {
+  RootJob *job = ctx;
+  Clip *clip = job->clip;
+  const Node *root = clip->root;
+  int first = block * ROOT_BLOCK;
+  int last = first + ROOT_BLOCK < clip->totalFrames ? first + ROOT_BLOCK
+                                                    : clip->totalFrames;
+  float *x = clip->trajectory + ROOT_X * (size_t)clip->totalFrames;
+  float *z = clip->trajectory + ROOT_Z * (size_t)clip->totalFrames;
+  float *heading = clip->trajectory + ROOT_HEADING * (size_t)clip->totalFrames;
+  for (int f = first; f < last; f++) {
+    const float *in = clip->data[f];
+    float *out = clip->relative + (size_t)f * clip->totalChannels;
+    memcpy(out, in, clip->totalChannels * sizeof(float));
+    x[f] = job->posX >= 0 ? in[job->posX] : 0;
+    z[f] = job->posZ >= 0 ? in[job->posZ] : 0;
+    if (job->posX >= 0)
+      out[job->posX] = 0;
+    if (job->posZ >= 0)
+      out[job->posZ] = 0;
+    if (!job->quats) {
+      heading[f] = 0;
+      job->dirX[f] = 0;
+      job->dirZ[f] = 1;
+      continue;
+    }
+
+    // Eixo lateral girado pela raiz; a frente e ele x Y, no plano
+    const float *q = job->quats + f * 4, *v = job->side;
+    float sx = (1 - 2 * (q[1] * q[1] + q[2] * q[2])) * v[0] +
+               2 * (q[0] * q[1] - q[2] * q[3]) * v[1] +
+               2 * (q[0] * q[2] + q[1] * q[3]) * v[2];
+    float sz = 2 * (q[0] * q[2] - q[1] * q[3]) * v[0] +
+               2 * (q[1] * q[2] + q[0] * q[3]) * v[1] +
+               (1 - 2 * (q[0] * q[0] + q[1] * q[1])) * v[2];
+    float h = atan2f(-sz, sx);
+    heading[f] = h;
+    job->dirX[f] = sinf(h);
+    job->dirZ[f] = cosf(h);
+
+    // Rotacao relativa: tira o giro do heading em torno de Y
+    float yaw[4] = {0, -sinf(h / 2), 0, cosf(h / 2)}, rel[4], angles[3];
+    quatMul(yaw, q, rel);
+    quatToEuler(rel, root->rotationOrder, angles);
+    memcpy(out + root->channelOffset + root->rotationChannel, angles,
+           sizeof(angles));
+  }
+}
+
+// Nome com prefixo de lado esquerdo ("LeftUpLeg", "L_Hip", "LHip"), depois
+// de um eventual namespace ("mixamorig:LeftUpLeg"). "LowerBack" nao conta
+static int isLeft(const char *name) {
+  const char *colon = strrchr(name, ':');
+  if (colon)
+    name = colon + 1;
+  return strncmp(name, "Left", 4) == 0 || strncmp(name, "left", 4) == 0 ||
+         ((name[0] == 'L' || name[0] == 'l') && name[1] == '_') ||
+         (name[0] == 'L' && name[1] >= 'A' && name[1] <= 'Z');
+}
+
+// Eixo lateral do esqueleto no referencial da raiz: os dois filhos da
+// raiz mais afastados entre si (os quadris), do direito para o esquerdo.
+// Sem eles, o eixo X local
+static void lateralAxis(const Node *root, float *side) {
+  float best = 0;
+  side[0] = 1;
+  side[1] = side[2] = 0;
+  for (const Node *a = root->children; a; a = a->next)
+    for (const Node *b = a->next; b; b = b->next) {
+      float d[3], len = 0;
+      for (int k = 0; k < 3; k++) {
+        d[k] = a->offset[k] - b->offset[k];
+        len += d[k] * d[k];
+      }
+      if (len <= best)
+        continue;
+      // d aponta de b para a: inverte se b for o esquerdo
+      float sign = isLeft(b->name) && !isLeft(a->name) ? -1.0f : 1.0f;
+      best = len;
+      for (int k = 0; k < 3; k++)
+        side[k] = sign * d[k] / sqrtf(len);
+    }
+}
+
+// d[f] = (v[f + 1] - v[f - 1]) / (2 dt), com diferencas simples nas pontas
+static void derivative(const float *v, int n, float dt, float *d) {
+  if (n < 2) {
+    if (n == 1)
+      d[0] = 0;
+    return;
+  }
+  float half = 0.5f / dt;
+  int f = 1;
+#ifdef __SSE__
+  __m128 h4 = _mm_set1_ps(half);
+  for (; f + 4 <= n - 1; f += 4)
+    _mm_storeu_ps(d + f, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(v + f + 1),
+                                               _mm_loadu_ps(v + f - 1)),
+                                    h4));
+#endif
+  for (; f < n - 1; f++)
+    d[f] = (v[f + 1] - v[f - 1]) * half;
+  d[0] = (v[1] - v[0]) / dt;
+  d[n - 1] = (v[n - 1] - v[n - 2]) / dt;
+}
+
+void buildRootMotion(Clip *clip, int numThreads) {
+  int n = clip->totalFrames;
+  const Node *root = clip->root;
+  free(clip->trajectory);
+  free(clip->relative);
+  clip->trajectory = malloc((size_t)ROOT_TRACKS * n * sizeof(float));
+  clip->relative = malloc((size_t)n * clip->totalChannels * sizeof(float));
+
+  // Quaternions da raiz de todos os frames de uma vez (SSE, 4 por vez)
+  RootJob job = {.clip = clip,
+                 .posX = positionChannel(root, 'x'),
+                 .posZ = positionChannel(root, 'z'),
+                 .dirX = malloc(n * sizeof(float)),
+                 .dirZ = malloc(n * sizeof(float))};
+  lateralAxis(root, job.side);
+  float *quats = NULL;
+  if (root->channelOffset >= 0 && root->rotationChannel >= 0) {
+    quats = malloc((size_t)n * 4 * sizeof(float));
+    eulerToQuats(clip->motion + root->channelOffset + root->rotationChannel,
+                 clip->totalChannels, root->rotationOrder, n, quats, 4);
+    job.quats = quats;
+  }
+  parallelFor((n + ROOT_BLOCK - 1) / ROOT_BLOCK, numThreads, rootBlock, &job);
+  free(quats);
+
+  float *track[ROOT_TRACKS];
+  for (int t = 0; t < ROOT_TRACKS; t++)
+    track[t] = clip->trajectory + (size_t)t * n;
+
+  // Heading continuo (atan2 salta de pi para -pi)
+  for (int f = 1; f < n; f++) {
+    float step = track[ROOT_HEADING][f] - track[ROOT_HEADING][f - 1];
+    track[ROOT_HEADING][f] -= 2 * (float)M_PI * roundf(step / (2 * (float)M_PI));
+  }
+
+  float dt = clip->frameTime > 0 ? clip->frameTime : 1;
+  derivative(track[ROOT_X], n, dt, track[ROOT_VX]);
+  derivative(track[ROOT_Z], n, dt, track[ROOT_VZ]);
+  derivative(track[ROOT_HEADING], n, dt, track[ROOT_TURN]);
+
+  // Velocidade no referencial do heading: frente = (sen h, cos h) e o
+  // esquerda = (cos h, -sen h)
+  const float *vx = track[ROOT_VX], *vz = track[ROOT_VZ];
+  const float *dx = job.dirX, *dz = job.dirZ;
+  float *fwd = track[ROOT_FORWARD], *lat = track[ROOT_LATERAL];
+  int f = 0;
+#ifdef __SSE__
+  for (; f + 4 <= n; f += 4) {
+    __m128 x4 = _mm_loadu_ps(vx + f), z4 = _mm_loadu_ps(vz + f);
+    __m128 s4 = _mm_loadu_ps(dx + f), c4 = _mm_loadu_ps(dz + f);
+    _mm_storeu_ps(fwd + f, _mm_add_ps(_mm_mul_ps(x4, s4), _mm_mul_ps(z4, c4)));
+    _mm_storeu_ps(lat + f, _mm_sub_ps(_mm_mul_ps(x4, c4), _mm_mul_ps(z4, s4)));
+  }
+#endif
+  for (; f < n; f++) {
+    fwd[f] = vx[f] * dx[f] + vz[f] * dz[f];
+    lat[f] = vx[f] * dz[f] - vz[f] * dx[f];
+  }
+  free(job.dirX);
+  free(job.dirZ);
+}
+
+const float *rootTrack(const Clip *clip, int track) {
+  return clip->trajectory + (size_t)track * clip->totalFrames;
+}
+
+const float *relativeFrame(const Clip *clip, int frame) {
+  return clip->relative + (size_t)frame * clip->totalChannels;
+}
+
+void rootTransform(const Clip *clip, int frame, float *out) {
+  float h = rootTrack(clip, ROOT_HEADING)[frame];
+  float c = cosf(h), s = sinf(h);
+  memset(out, 0, 16 * sizeof(float));
+  out[0] = c;
+  out[2] = -s;
+  out[5] = 1;
+  out[8] = s;
+  out[10] = c;
+  out[12] = rootTrack(clip, ROOT_X)[frame];
+  out[14] = rootTrack(clip, ROOT_Z)[frame];
+  out[15] = 1;
+}
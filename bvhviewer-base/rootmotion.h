@@ -0,0 +1,40 @@
+#ifndef ROOTMOTION_H
+#define ROOTMOTION_H
+
+#include "bvh.h"
+
+// Trilhas da trajetoria da raiz (Y para cima), uma linha de totalFrames
+// floats cada em clip->trajectory
+enum {
+  ROOT_X,       // posicao no plano do chao
+  ROOT_Z,
+  ROOT_HEADING, // direcao (radianos, continua: sem saltos de 2 pi)
+  ROOT_VX,      // velocidade no plano (unidades/s)
+  ROOT_VZ,
+  ROOT_FORWARD, // velocidade na direcao do heading
+  ROOT_LATERAL, // velocidade para a esquerda do heading
+  ROOT_TURN,    // velocidade angular do heading (radianos/s)
+  ROOT_TRACKS
+};
+
+// Separa o movimento da raiz: clip->trajectory recebe as trilhas acima e
+// clip->relative as poses com a raiz na origem do plano (a altura fica)
+// e virada para +Z. O heading vem do eixo entre os quadris (os dois
+// filhos da raiz mais afastados): a frente e esse eixo girado de 90 graus
+// no plano, que continua definida com o tronco inclinado (ao engatinhar,
+// por exemplo). Converte as rotacoes por blocos
+// de frames em paralelo (numThreads <= 0: todas); refazer sempre que
+// clip->motion mudar
+void buildRootMotion(Clip *clip, int numThreads);
+
+// Trilha ROOT_* (clip->totalFrames valores)
+const float *rootTrack(const Clip *clip, int track);
+
+// Canais do frame relativos a raiz (para computePose)
+const float *relativeFrame(const Clip *clip, int frame);
+
+// Matriz (colunas) que leva a pose relativa do frame a pose original:
+// translacao no plano seguida da rotacao do heading em torno de Y
+void rootTransform(const Clip *clip, int frame, float *out);
+
+#endif
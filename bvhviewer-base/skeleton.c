@@ -0,0 +1,154 @@
+// **********************************************************************
+//	skeleton.c
+//  Esqueletos compartilhados entre clips (hash-consing da hierarquia)
+// **********************************************************************
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "names.h"
+#include "skeleton.h"
+
+struct SkeletonCache {
+  float tolerance;
+  pthread_mutex_t lock;
+  Skeleton *skeletons;
+  int count;
+};
+
+SkeletonCache *createSkeletonCache(float tolerance) {
+  SkeletonCache *cache = calloc(1, sizeof(SkeletonCache));
+  cache->tolerance = tolerance;
+  pthread_mutex_init(&cache->lock, NULL);
+  return cache;
+}
+
+void freeSkeletonCache(SkeletonCache *cache) {
+  if (!cache)
+    return;
+  Skeleton *s = cache->skeletons;
+  while (s) {
+    Skeleton *next = s->next;
+    freeNode(s->root);
+    free(s->nodes);
+    freeNameTable(s->names);
+    free(s->bindWorld);
+    free(s->boneLengths);
+    free(s);
+    s = next;
+  }
+  pthread_mutex_destroy(&cache->lock);
+  free(cache);
+}
+
+int skeletonCount(SkeletonCache *cache) {
+  pthread_mutex_lock(&cache->lock);
+  int count = cache->count;
+  pthread_mutex_unlock(&cache->lock);
+  return count;
+}
+
+// Hash de nomes, topologia e ordem dos canais. Os offsets ficam de fora:
+// dois offsets dentro da tolerancia podem cair em lados diferentes de
+// qualquer arredondamento, entao quem decide sobre eles e sameNode
+static unsigned long long structureHash(const Node *node,
+                                        unsigned long long hash) {
+  hash = hashBytes(node->name, strlen(node->name) + 1, hash);
+  hash = hashBytes(node->channelOrder, strlen(node->channelOrder) + 1, hash);
+  hash = hashBytes(&node->numChildren, sizeof(int), hash);
+  for (const Node *child = node->children; child; child = child->next)
+    hash = structureHash(child, hash);
+  return hash;
+}
+
+// Mesma estrutura, com offsets dentro da tolerancia (os de nodos com
+// canais de posicao nao contam, como em skeletonHash)
+static int sameNode(const Node *a, const Node *b, float tolerance) {
+  if (strcmp(a->name, b->name) != 0 ||
+      strcmp(a->channelOrder, b->channelOrder) != 0 ||
+      a->numChildren != b->numChildren)
+    return 0;
+  if (!strpbrk(a->channelOrder, "xyz"))
+    for (int k = 0; k < 3; k++)
+      if (fabsf(a->offset[k] - b->offset[k]) > tolerance)
+        return 0;
+  const Node *ca = a->children, *cb = b->children;
+  for (; ca && cb; ca = ca->next, cb = cb->next)
+    if (!sameNode(ca, cb, tolerance))
+      return 0;
+  return 1;
+}
+
+// Precalculos por esqueleto
+static void prepareSkeleton(Skeleton *s, const Clip *clip) {
+  float *zeros = calloc(clip->totalChannels + 1, sizeof(float));
+  s->bindWorld = malloc(s->numNodes * 16 * sizeof(float));
+  computePose(clip, zeros, s->bindWorld);
+  free(zeros);
+  s->boneLengths = malloc(s->numNodes * sizeof(float));
+  for (int i = 0; i < s->numNodes; i++) {
+    const float *o = s->nodes[i]->offset;
+    s->boneLengths[i] =
+        s->nodes[i]->parent ? sqrtf(o[0] * o[0] + o[1] * o[1] + o[2] * o[2])
+                            : 0;
+  }
+}
+
+Skeleton *shareSkeleton(SkeletonCache *cache, Clip *clip) {
+  if (clip->skeleton)
+    return clip->skeleton;
+  // O hash separa os candidatos; a comparacao completa resolve colisoes e
+  // decide os offsets
+  unsigned long long hash = structureHash(clip->root, HASH_SEED);
+
+  pthread_mutex_lock(&cache->lock);
+  Skeleton *s = cache->skeletons;
+  while (s && !(s->hash == hash &&
+                s->totalChannels == clip->totalChannels &&
+                sameNode(s->root, clip->root, cache->tolerance)))
+    s = s->next;
+  if (!s) {
+    // Primeiro clip com esta estrutura: a hierarquia dele vira a canonica
+    s = calloc(1, sizeof(Skeleton));
+    s->hash = hash;
+    s->root = clip->root;
+    s->nodes = clip->nodes;
+    s->names = clip->names;
+    s->numNodes = clip->numNodes;
+    s->totalChannels = clip->totalChannels;
+    prepareSkeleton(s, clip);
+    s->next = cache->skeletons;
+    cache->skeletons = s;
+    cache->count++;
+  } else {
+    freeNode(clip->root);
+    free(clip->nodes);
+    freeNameTable(clip->names);
+  }
+  s->numClips++;
+  pthread_mutex_unlock(&cache->lock);
+
+  clip->root = s->root;
+  clip->nodes = s->nodes;
+  clip->names = s->names;
+  clip->skeleton = s;
+  return s;
+}
+
+Clip *loadSharedClip(SkeletonCache *cache, const char *path) {
+  Clip *clip = loadClip(path);
+  if (clip)
+    shareSkeleton(cache, clip);
+  return clip;
+}
+
+const float *restPose(const Clip *clip, float *world) {
+  if (clip->skeleton)
+    return clip->skeleton->bindWorld;
+  float *zeros = calloc(clip->totalChannels + 1, sizeof(float));
+  computePose(clip, zeros, world);
+  free(zeros);
+  return world;
+}
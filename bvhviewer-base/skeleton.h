@@ -0,0 +1,51 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include "bvh.h"
+
+// Tolerancia padrao para considerar dois offsets iguais
+#define SKELETON_TOLERANCE 0.001f
+
+// Hierarquia canonica, compartilhada por todos os clips com a mesma
+// estrutura (nomes, topologia, canais e offsets dentro da tolerancia).
+// Os precalculos de repouso (bindWorld, boneLengths) sao feitos uma vez
+// por esqueleto.
+// Os clips apontam root/nodes para ela e guardam so o movimento.
+//
+// Os campos de definicao dos nodos sao somente leitura. As caches de pose
+// (channelData, local, world, quat) passam a ser do esqueleto: so um clip
+// por vez deve usar applyFrame/updatePose; computeWorld/computePose nao
+// escrevem nos nodos e podem ser usados de varias threads.
+// O offset canonico de nodos com canais de posicao (a raiz) e o do
+// primeiro clip; ele nao afeta a pose, ja que as posicoes o substituem.
+typedef struct Skeleton {
+  unsigned long long hash; // hash de nomes, topologia e canais (sem offsets)
+  Node *root;
+  Node **nodes;
+  struct NameTable *names;
+  int numNodes, totalChannels;
+  int numClips;       // clips que ja usaram o esqueleto
+  float *bindWorld;   // numNodes x 16: pose com canais zerados
+  float *boneLengths; // numNodes: distancia de cada nodo ao pai
+  struct Skeleton *next;
+} Skeleton;
+
+typedef struct SkeletonCache SkeletonCache;
+
+// tolerance: diferenca maxima entre offsets (unidades do arquivo)
+SkeletonCache *createSkeletonCache(float tolerance);
+// Libera os esqueletos; os clips que os usam devem ser liberados antes
+void freeSkeletonCache(SkeletonCache *cache);
+int skeletonCount(SkeletonCache *cache);
+
+// Troca a hierarquia do clip pela canonica (criando-a se for nova) e
+// libera a do clip. Pode ser chamada de varias threads
+Skeleton *shareSkeleton(SkeletonCache *cache, Clip *clip);
+// loadClip + shareSkeleton
+Clip *loadSharedClip(SkeletonCache *cache, const char *path);
+
+// Pose de repouso do clip (canais zerados, numNodes x 16): a do esqueleto
+// compartilhado ou, se o clip nao tiver um, calculada em world
+const float *restPose(const Clip *clip, float *world);
+
+#endif
@@ -0,0 +1,439 @@
+// **********************************************************************
+//	skin.c
+//  Linear blend skinning em CPU: carrega uma malha OBJ com pesos por
+//  vertice e a deforma a cada frame com as matrizes da cinematica direta
+// **********************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "parallel.h"
+#include "skin.h"
+
+// Qtd de vertices processados por item do laco paralelo
+#define SKIN_CHUNK 4096
+
+// Malha de teste: vertices por anel em volta de cada osso e raio do tubo
+#define TEST_RING 16
+#define TEST_RADIUS 3.0f
+
+#define MAX_LINE_LENGTH 1024
+
+typedef struct {
+  float *data;
+  int count, cap;
+} FloatArray;
+
+typedef struct {
+  unsigned int *data;
+  int count, cap;
+} IndexArray;
+
+static void pushFloat(FloatArray *a, float v) {
+  if (a->count == a->cap) {
+    a->cap = a->cap ? a->cap * 2 : 1024;
+    a->data = realloc(a->data, a->cap * sizeof(float));
+  }
+  a->data[a->count++] = v;
+}
+
+static void pushIndex(IndexArray *a, unsigned int v) {
+  if (a->count == a->cap) {
+    a->cap = a->cap ? a->cap * 2 : 1024;
+    a->data = realloc(a->data, a->cap * sizeof(unsigned int));
+  }
+  a->data[a->count++] = v;
+}
+
+// Le os vertices e faces de um OBJ (as faces sao trianguladas em leque)
+static int loadObj(const char *path, FloatArray *pos, IndexArray *tris) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    printf("Erro: nao foi possivel abrir %s\n", path);
+    return 0;
+  }
+  char line[MAX_LINE_LENGTH];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == 'v' && line[1] == ' ') {
+      float x, y, z;
+      if (sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3) {
+        pushFloat(pos, x);
+        pushFloat(pos, y);
+        pushFloat(pos, z);
+      }
+    } else if (line[0] == 'f' && line[1] == ' ') {
+      int numVertices = pos->count / 3;
+      long first = -1, prev = -1;
+      char *ptr = line + 2, *end;
+      for (;;) {
+        long v = strtol(ptr, &end, 10);
+        if (end == ptr)
+          break;
+        // Ignora as referencias de textura/normal (v/vt/vn)
+        while (*end && *end != ' ' && *end != '\t' && *end != '\n' &&
+               *end != '\r')
+          end++;
+        ptr = end;
+        v = v < 0 ? numVertices + v : v - 1;
+        if (v < 0 || v >= numVertices) {
+          printf("Erro: indice de vertice invalido em %s\n", path);
+          fclose(file);
+          return 0;
+        }
+        if (first < 0)
+          first = v;
+        else if (prev >= 0 && prev != first) {
+          pushIndex(tris, first);
+          pushIndex(tris, prev);
+          pushIndex(tris, v);
+        }
+        prev = v;
+      }
+    }
+  }
+  fclose(file);
+  return 1;
+}
+
+// Le o arquivo de pesos: uma linha por vertice com pares "junta peso"
+static int loadWeights(const char *path, SkinnedMesh *mesh, const Clip *clip) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    printf("Erro: nao foi possivel abrir %s\n", path);
+    return 0;
+  }
+  char line[MAX_LINE_LENGTH];
+  char name[128];
+  int v = 0;
+  while (v < mesh->numVertices && fgets(line, sizeof(line), file)) {
+    trimString(line);
+    if (line[0] == '\0' || line[0] == '#')
+      continue;
+    int *joints = mesh->joints + v * SKIN_INFLUENCES;
+    float *weights = mesh->weights + v * SKIN_INFLUENCES;
+    float total = 0;
+    int k = 0, n;
+    char *ptr = line;
+    float w;
+    while (k < SKIN_INFLUENCES &&
+           sscanf(ptr, "%127s %f%n", name, &w, &n) == 2) {
+      ptr += n;
+      Node *node = findClipNode(clip, name);
+      if (!node) {
+        printf("Erro: junta '%s' (vertice %d) nao existe no esqueleto\n",
+               name, v);
+        fclose(file);
+        return 0;
+      }
+      joints[k] = node->index;
+      weights[k] = w;
+      total += w;
+      k++;
+    }
+    // Normaliza os pesos; vertices sem pesos seguem a raiz
+    if (total <= 0) {
+      joints[0] = 0;
+      weights[0] = total = 1;
+      k = 1;
+    }
+    for (int i = 0; i < k; i++)
+      weights[i] /= total;
+    for (; k < SKIN_INFLUENCES; k++) {
+      joints[k] = joints[0];
+      weights[k] = 0;
+    }
+    v++;
+  }
+  fclose(file);
+  if (v < mesh->numVertices) {
+    printf("Erro: %s tem pesos para %d de %d vertices\n", path, v,
+           mesh->numVertices);
+    return 0;
+  }
+  return 1;
+}
+
+// Normais de bind pela media das normais das faces (ponderada pela area)
+static void computeNormals(SkinnedMesh *mesh) {
+  float *n = mesh->bindNormals;
+  const float *p = mesh->bindPositions;
+  memset(n, 0, mesh->numVertices * 4 * sizeof(float));
+  for (int t = 0; t < mesh->numTriangles; t++) {
+    const unsigned int *tri = mesh->indices + t * 3;
+    const float *a = p + tri[0] * 4, *b = p + tri[1] * 4, *c = p + tri[2] * 4;
+    float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float fn[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                   e1[2] * e2[0] - e1[0] * e2[2],
+                   e1[0] * e2[1] - e1[1] * e2[0]};
+    for (int k = 0; k < 3; k++)
+      for (int i = 0; i < 3; i++)
+        n[tri[k] * 4 + i] += fn[i];
+  }
+  for (int v = 0; v < mesh->numVertices; v++) {
+    float *nv = n + v * 4;
+    float len = sqrtf(nv[0] * nv[0] + nv[1] * nv[1] + nv[2] * nv[2]);
+    if (len > 0) {
+      nv[0] /= len;
+      nv[1] /= len;
+      nv[2] /= len;
+    }
+  }
+}
+
+static void prepareBind(SkinnedMesh *mesh, const Clip *clip);
+
+SkinnedMesh *loadSkinnedMesh(const char *objPath, const char *weightsPath,
+                             const Clip *clip) {
+  FloatArray pos = {0};
+  IndexArray tris = {0};
+  if (!loadObj(objPath, &pos, &tris) || pos.count == 0) {
+    free(pos.data);
+    free(tris.data);
+    return NULL;
+  }
+
+  SkinnedMesh *mesh = calloc(1, sizeof(SkinnedMesh));
+  mesh->numVertices = pos.count / 3;
+  mesh->numTriangles = tris.count / 3;
+  mesh->indices = tris.data;
+  mesh->bindPositions = malloc(mesh->numVertices * 4 * sizeof(float));
+  mesh->bindNormals = malloc(mesh->numVertices * 4 * sizeof(float));
+  for (int v = 0; v < mesh->numVertices; v++) {
+    memcpy(mesh->bindPositions + v * 4, pos.data + v * 3, 3 * sizeof(float));
+    mesh->bindPositions[v * 4 + 3] = 1;
+  }
+  free(pos.data);
+  computeNormals(mesh);
+
+  mesh->joints = malloc(mesh->numVertices * SKIN_INFLUENCES * sizeof(int));
+  mesh->weights = malloc(mesh->numVertices * SKIN_INFLUENCES * sizeof(float));
+  if (!loadWeights(weightsPath, mesh, clip)) {
+    freeSkinnedMesh(mesh);
+    return NULL;
+  }
+
+  prepareBind(mesh, clip);
+  printf("Malha %s: %d vertices, %d triangulos\n", objPath, mesh->numVertices,
+         mesh->numTriangles);
+  return mesh;
+}
+
+// Matrizes de bind e buffers de saida de uma malha com vertices e pesos
+static void prepareBind(SkinnedMesh *mesh, const Clip *clip) {
+  // Pose de bind: rotacoes nulas e a raiz no seu OFFSET
+  mesh->numNodes = clip->numNodes;
+  mesh->invBind = malloc(clip->numNodes * 16 * sizeof(float));
+  mesh->world = malloc(clip->numNodes * 16 * sizeof(float));
+  mesh->skinMatrices = malloc(clip->numNodes * 16 * sizeof(float));
+  float *bindValues = calloc(clip->totalChannels, sizeof(float));
+  if (clip->root->channels == 6)
+    memcpy(bindValues, clip->root->offset, 3 * sizeof(float));
+  computePose(clip, bindValues, mesh->world);
+  for (int i = 0; i < clip->numNodes; i++)
+    rigidInverse(mesh->world + i * 16, mesh->invBind + i * 16);
+  free(bindValues);
+
+  mesh->vertices = malloc(mesh->numVertices * 8 * sizeof(float));
+  mesh->frame = -1;
+}
+
+SkinnedMesh *createTestMesh(const Clip *clip, int numVertices) {
+  float *zeros = calloc(clip->totalChannels + 1, sizeof(float));
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  if (clip->root->channels == 6)
+    memcpy(zeros, clip->root->offset, 3 * sizeof(float));
+  computePose(clip, zeros, world);
+  free(zeros);
+  int bones = 0;
+  for (int i = 0; i < clip->numNodes; i++)
+    bones += clip->nodes[i]->parent != NULL;
+  int rings = numVertices / (bones * TEST_RING);
+  if (rings < 2)
+    rings = 2;
+
+  SkinnedMesh *mesh = calloc(1, sizeof(SkinnedMesh));
+  mesh->numVertices = bones * rings * TEST_RING;
+  mesh->numTriangles = bones * (rings - 1) * TEST_RING * 2;
+  mesh->bindPositions = malloc(mesh->numVertices * 4 * sizeof(float));
+  mesh->bindNormals = malloc(mesh->numVertices * 4 * sizeof(float));
+  mesh->indices = malloc(mesh->numTriangles * 3 * sizeof(unsigned int));
+  mesh->joints = calloc(mesh->numVertices * SKIN_INFLUENCES, sizeof(int));
+  mesh->weights = calloc(mesh->numVertices * SKIN_INFLUENCES, sizeof(float));
+
+  // Um tubo por osso, da junta pai ao nodo, com os pesos passando da
+  // junta que gira o osso para a seguinte ao longo do comprimento
+  int v = 0, t = 0;
+  for (int i = 0; i < clip->numNodes; i++) {
+    const Node *node = clip->nodes[i];
+    if (!node->parent)
+      continue;
+    const float *a = world + node->parent->index * 16 + 12;
+    const float *b = world + i * 16 + 12;
+    float axis[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float side[3] = {axis[1], -axis[0], 0}; // perpendicular ao osso
+    if (fabsf(side[0]) + fabsf(side[1]) < 1e-6f)
+      side[0] = 1;
+    float up[3] = {axis[1] * side[2] - axis[2] * side[1],
+                   axis[2] * side[0] - axis[0] * side[2],
+                   axis[0] * side[1] - axis[1] * side[0]};
+    float ls = sqrtf(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+    float lu = sqrtf(up[0] * up[0] + up[1] * up[1] + up[2] * up[2]);
+    if (lu < 1e-6f)
+      lu = 1;
+
+    int first = v;
+    for (int r = 0; r < rings; r++) {
+      float s = (float)r / (rings - 1);
+      for (int k = 0; k < TEST_RING; k++, v++) {
+        float angle = 2 * (float)M_PI * k / TEST_RING;
+        float c = cosf(angle), sn = sinf(angle);
+        float *p = mesh->bindPositions + v * 4, *n = mesh->bindNormals + v * 4;
+        for (int e = 0; e < 3; e++) {
+          n[e] = c * side[e] / ls + sn * up[e] / lu;
+          p[e] = a[e] + axis[e] * s + TEST_RADIUS * n[e];
+        }
+        p[3] = 1;
+        n[3] = 0;
+        mesh->joints[v * SKIN_INFLUENCES] = node->parent->index;
+        mesh->joints[v * SKIN_INFLUENCES + 1] = i;
+        mesh->weights[v * SKIN_INFLUENCES] = 1 - 0.5f * s;
+        mesh->weights[v * SKIN_INFLUENCES + 1] = 0.5f * s;
+      }
+    }
+    for (int r = 0; r + 1 < rings; r++)
+      for (int k = 0; k < TEST_RING; k++) {
+        unsigned p0 = first + r * TEST_RING + k;
+        unsigned p1 = first + r * TEST_RING + (k + 1) % TEST_RING;
+        unsigned *tri = mesh->indices + t * 3;
+        tri[0] = p0;
+        tri[1] = p1;
+        tri[2] = p0 + TEST_RING;
+        tri[3] = p1;
+        tri[4] = p1 + TEST_RING;
+        tri[5] = p0 + TEST_RING;
+        t += 2;
+      }
+  }
+  free(world);
+  prepareBind(mesh, clip);
+  return mesh;
+}
+
+void freeSkinnedMesh(SkinnedMesh *mesh) {
+  if (!mesh)
+    return;
+  free(mesh->bindPositions);
+  free(mesh->bindNormals);
+  free(mesh->indices);
+  free(mesh->joints);
+  free(mesh->weights);
+  free(mesh->invBind);
+  free(mesh->world);
+  free(mesh->skinMatrices);
+  free(mesh->vertices);
+  freeWorkerPool(mesh->pool);
+  free(mesh);
+}
+
+// Deforma os vertices [begin, end): cada vertice mistura as colunas das
+// matrizes das suas juntas e transforma posicao e normal
+static void skinRange(const SkinnedMesh *mesh, int begin, int end) {
+  const float *skin = mesh->skinMatrices;
+#ifdef __SSE__
+  for (int v = begin; v < end; v++) {
+    const int *j = mesh->joints + v * SKIN_INFLUENCES;
+    const float *w = mesh->weights + v * SKIN_INFLUENCES;
+    __m128 c0 = _mm_setzero_ps(), c1 = c0, c2 = c0, c3 = c0;
+    for (int k = 0; k < SKIN_INFLUENCES; k++) {
+      const float *m = skin + j[k] * 16;
+      __m128 wk = _mm_set1_ps(w[k]);
+      c0 = _mm_add_ps(c0, _mm_mul_ps(wk, _mm_loadu_ps(m)));
+      c1 = _mm_add_ps(c1, _mm_mul_ps(wk, _mm_loadu_ps(m + 4)));
+      c2 = _mm_add_ps(c2, _mm_mul_ps(wk, _mm_loadu_ps(m + 8)));
+      c3 = _mm_add_ps(c3, _mm_mul_ps(wk, _mm_loadu_ps(m + 12)));
+    }
+    const float *p = mesh->bindPositions + v * 4;
+    const float *n = mesh->bindNormals + v * 4;
+    __m128 pos = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])),
+                   _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+        _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), c3));
+    __m128 nrm = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(n[0])),
+                                       _mm_mul_ps(c1, _mm_set1_ps(n[1]))),
+                            _mm_mul_ps(c2, _mm_set1_ps(n[2])));
+    _mm_storeu_ps(mesh->vertices + v * 8, pos);
+    _mm_storeu_ps(mesh->vertices + v * 8 + 4, nrm);
+  }
+#else
+  for (int v = begin; v < end; v++) {
+    const int *j = mesh->joints + v * SKIN_INFLUENCES;
+    const float *w = mesh->weights + v * SKIN_INFLUENCES;
+    float c[16] = {0};
+    for (int k = 0; k < SKIN_INFLUENCES; k++) {
+      const float *m = skin + j[k] * 16;
+      for (int i = 0; i < 16; i++)
+        c[i] += w[k] * m[i];
+    }
+    const float *p = mesh->bindPositions + v * 4;
+    const float *n = mesh->bindNormals + v * 4;
+    float *out = mesh->vertices + v * 8;
+    for (int i = 0; i < 4; i++) {
+      out[i] = c[i] * p[0] + c[4 + i] * p[1] + c[8 + i] * p[2] + c[12 + i];
+      out[4 + i] = c[i] * n[0] + c[4 + i] * n[1] + c[8 + i] * n[2];
+    }
+  }
+#endif
+}
+
+static void skinChunk(int i, int thread, void *ctx) {
+  const SkinnedMesh *mesh = ctx;
+  int begin = i * SKIN_CHUNK;
+  int end = begin + SKIN_CHUNK;
+  if (end > mesh->numVertices)
+    end = mesh->numVertices;
+  skinRange(mesh, begin, end);
+}
+
+// Deforma todos os vertices a partir de mesh->world
+static void skinWorld(SkinnedMesh *mesh, int numThreads) {
+  for (int i = 0; i < mesh->numNodes; i++)
+    matMul(mesh->world + i * 16, mesh->invBind + i * 16,
+           mesh->skinMatrices + i * 16);
+  int chunks = (mesh->numVertices + SKIN_CHUNK - 1) / SKIN_CHUNK;
+  if (chunks <= 1 || numThreads == 1) {
+    skinRange(mesh, 0, mesh->numVertices);
+    return;
+  }
+  // As threads ficam com a malha: o viewer deforma a cada redesenho e
+  // criar threads a cada chamada custaria mais que a propria deformacao
+  if (mesh->pool && numThreads > 0 && poolThreads(mesh->pool) != numThreads) {
+    freeWorkerPool(mesh->pool);
+    mesh->pool = NULL;
+  }
+  if (!mesh->pool)
+    mesh->pool = createWorkerPool(numThreads);
+  poolFor(mesh->pool, chunks, skinChunk, mesh);
+}
+
+void skinMesh(SkinnedMesh *mesh, const Clip *clip, int frame, int numThreads) {
+  if (mesh->frame == frame)
+    return;
+  computeWorld(clip, frame, mesh->world);
+  skinWorld(mesh, numThreads);
+  mesh->frame = frame;
+}
+
+void skinMeshPose(SkinnedMesh *mesh, const Clip *clip, int frame,
+                  int numThreads) {
+  for (int i = 0; i < mesh->numNodes; i++)
+    memcpy(mesh->world + i * 16, clip->nodes[i]->world, 16 * sizeof(float));
+  skinWorld(mesh, numThreads);
+  mesh->frame = frame;
+}
@@ -0,0 +1,49 @@
+#ifndef SKIN_H
+#define SKIN_H
+
+#include "bvh.h"
+
+// Qtd maxima de juntas que influenciam um vertice
+#define SKIN_INFLUENCES 4
+
+// Malha deformada por linear blend skinning a partir do esqueleto de um clip
+typedef struct SkinnedMesh {
+  int numVertices;
+  int numTriangles;
+  float *bindPositions;  // 4 floats por vertice (x, y, z, 1) na pose de bind
+  float *bindNormals;    // 4 floats por vertice (x, y, z, 0) na pose de bind
+  unsigned int *indices; // 3 indices por triangulo
+  int *joints;           // SKIN_INFLUENCES indices de nodo por vertice
+  float *weights;        // SKIN_INFLUENCES pesos por vertice (soma 1)
+  int numNodes;
+  float *invBind;        // inversa da matriz global de bind de cada nodo
+  float *world;          // matrizes globais do frame atual
+  float *skinMatrices;   // world * invBind de cada nodo
+  float *vertices;       // saida: 8 floats por vertice (posicao, normal)
+  int frame;             // frame deformado em vertices (-1 = nenhum)
+  struct WorkerPool *pool; // threads da deformacao (criadas no 1o frame)
+} SkinnedMesh;
+
+// Carrega uma malha OBJ (v/f) e o arquivo de pesos correspondente.
+// O arquivo de pesos tem uma linha por vertice, na ordem do OBJ, com ate
+// SKIN_INFLUENCES pares "nomeDaJunta peso" ('#' inicia comentario).
+// A malha deve estar modelada na pose de bind: todas as rotacoes nulas e
+// a raiz no seu OFFSET.
+SkinnedMesh *loadSkinnedMesh(const char *objPath, const char *weightsPath,
+                             const Clip *clip);
+void freeSkinnedMesh(SkinnedMesh *mesh);
+
+// Malha sintetica para medicoes: um tubo de ~numVertices / ossos vertices
+// em volta de cada osso, pesado entre as duas juntas do osso
+SkinnedMesh *createTestMesh(const Clip *clip, int numVertices);
+
+// Deforma a malha para um frame do clip, dividindo os vertices entre
+// numThreads threads (<= 0: todos os processadores; as threads sao
+// criadas uma vez e reaproveitadas nas chamadas seguintes)
+void skinMesh(SkinnedMesh *mesh, const Clip *clip, int frame, int numThreads);
+// Idem, reaproveitando as matrizes globais ja calculadas nos nodos por
+// updatePose (frame so identifica a pose deformada)
+void skinMeshPose(SkinnedMesh *mesh, const Clip *clip, int frame,
+                  int numThreads);
+
+#endif
@@ -0,0 +1,472 @@
+// **********************************************************************
+//	stats.c
+//  Estatisticas cinematicas de um clip (faixa, media, variancia, picos de
+//  velocidade e aceleracao) e deteccao de spikes e flips de Euler.
+//  As series ficam em colunas contiguas (canal-major) e sao reduzidas por
+//  kernels SSE.
+// **********************************************************************
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "quat.h"
+#include "stats.h"
+
+#define RAD_TO_DEG ((float)(180.0 / M_PI))
+
+// Somas parciais em float sao despejadas em double a cada bloco, para nao
+// perder precisao em clips longos
+#define SUM_BLOCK 1024
+
+void defaultStatsParams(StatsParams *p) {
+  p->spikeFactor = 10.0f;
+  p->spikeMin = 2.0f;
+  p->flipAngle = 90.0f;
+  p->jumpAngle = 30.0f;
+}
+
+// **********************************************************************
+//  Kernels de coluna
+// **********************************************************************
+
+#ifdef __SSE2__
+static double sum4(__m128 v) {
+  float t[4];
+  _mm_storeu_ps(t, v);
+  return (double)t[0] + t[1] + t[2] + t[3];
+}
+#endif
+
+// min, max, media e variancia (em duas passadas) de x[0..n)
+static void seriesMoments(const float *x, int n, SeriesStats *s) {
+  s->min = s->max = s->mean = s->variance = 0;
+  if (n <= 0)
+    return;
+  float mn = x[0], mx = x[0];
+  double sum = 0;
+  int i = 0;
+#ifdef __SSE2__
+  __m128 vmin = _mm_set1_ps(x[0]), vmax = vmin;
+  while (i + 4 <= n) {
+    __m128 vsum = _mm_setzero_ps();
+    for (int end = i + SUM_BLOCK; i + 4 <= n && i < end; i += 4) {
+      __m128 v = _mm_loadu_ps(x + i);
+      vmin = _mm_min_ps(vmin, v);
+      vmax = _mm_max_ps(vmax, v);
+      vsum = _mm_add_ps(vsum, v);
+    }
+    sum += sum4(vsum);
+  }
+  float t[4];
+  _mm_storeu_ps(t, vmin);
+  for (int k = 0; k < 4; k++)
+    mn = t[k] < mn ? t[k] : mn;
+  _mm_storeu_ps(t, vmax);
+  for (int k = 0; k < 4; k++)
+    mx = t[k] > mx ? t[k] : mx;
+#endif
+  for (; i < n; i++) {
+    mn = x[i] < mn ? x[i] : mn;
+    mx = x[i] > mx ? x[i] : mx;
+    sum += x[i];
+  }
+  float mean = (float)(sum / n);
+
+  double var = 0;
+  i = 0;
+#ifdef __SSE2__
+  const __m128 vmean = _mm_set1_ps(mean);
+  while (i + 4 <= n) {
+    __m128 acc = _mm_setzero_ps();
+    for (int end = i + SUM_BLOCK; i + 4 <= n && i < end; i += 4) {
+      __m128 d = _mm_sub_ps(_mm_loadu_ps(x + i), vmean);
+      acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+    }
+    var += sum4(acc);
+  }
+#endif
+  for (; i < n; i++)
+    var += (double)(x[i] - mean) * (x[i] - mean);
+
+  s->min = mn;
+  s->max = mx;
+  s->mean = mean;
+  s->variance = (float)(var / n);
+}
+
+// Maior |x[f+1] - x[f]| (e seu frame f); meanStep recebe a media dos passos
+static float stepPeak(const float *x, int n, int *frame, float *meanStep) {
+  *frame = 0;
+  *meanStep = 0;
+  if (n < 2)
+    return 0;
+  int m = n - 1, i = 0;
+  float best = -1;
+  double sum = 0;
+#ifdef __SSE2__
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 four = _mm_set1_ps(4);
+  __m128 vbest = _mm_set1_ps(-1), vframe = _mm_setzero_ps();
+  __m128 idx = _mm_setr_ps(0, 1, 2, 3);
+  while (i + 4 <= m) {
+    __m128 vsum = _mm_setzero_ps();
+    for (int end = i + SUM_BLOCK; i + 4 <= m && i < end; i += 4) {
+      __m128 d = _mm_and_ps(absMask, _mm_sub_ps(_mm_loadu_ps(x + i + 1),
+                                                _mm_loadu_ps(x + i)));
+      __m128 gt = _mm_cmpgt_ps(d, vbest);
+      vbest = _mm_or_ps(_mm_and_ps(gt, d), _mm_andnot_ps(gt, vbest));
+      vframe = _mm_or_ps(_mm_and_ps(gt, idx), _mm_andnot_ps(gt, vframe));
+      idx = _mm_add_ps(idx, four);
+      vsum = _mm_add_ps(vsum, d);
+    }
+    sum += sum4(vsum);
+  }
+  float b[4], f[4];
+  _mm_storeu_ps(b, vbest);
+  _mm_storeu_ps(f, vframe);
+  for (int k = 0; k < 4; k++)
+    if (b[k] > best || (b[k] == best && (int)f[k] < *frame)) {
+      best = b[k];
+      *frame = (int)f[k];
+    }
+#endif
+  for (; i < m; i++) {
+    float d = fabsf(x[i + 1] - x[i]);
+    if (d > best) {
+      best = d;
+      *frame = i;
+    }
+    sum += d;
+  }
+  *meanStep = (float)(sum / m);
+  return best;
+}
+
+static void addEvent(ClipStats *st, int type, int series, int frame,
+                     float value) {
+  if (st->numEvents % 64 == 0)
+    st->events =
+        realloc(st->events, (st->numEvents + 64) * sizeof(StatEvent));
+  StatEvent *e = &st->events[st->numEvents++];
+  e->type = type;
+  e->series = series;
+  e->frame = frame;
+  e->value = value;
+  st->series[series].events++;
+}
+
+// Spike: o frame f se afasta dos dois vizinhos no mesmo sentido (passos de
+// sinais opostos) por mais que threshold. Degraus nao contam.
+static void findSpikes(ClipStats *st, int series, const float *x, int n,
+                       float threshold) {
+  int f = 1;
+#ifdef __SSE2__
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 zero = _mm_setzero_ps(), vthr = _mm_set1_ps(threshold);
+  for (; f + 4 <= n - 1; f += 4) {
+    __m128 prev = _mm_loadu_ps(x + f - 1), cur = _mm_loadu_ps(x + f),
+           next = _mm_loadu_ps(x + f + 1);
+    __m128 d1 = _mm_sub_ps(cur, prev), d2 = _mm_sub_ps(next, cur);
+    __m128 opposite = _mm_cmplt_ps(_mm_mul_ps(d1, d2), zero);
+    __m128 dev = _mm_min_ps(_mm_and_ps(absMask, d1), _mm_and_ps(absMask, d2));
+    int mask = _mm_movemask_ps(_mm_and_ps(opposite, _mm_cmpgt_ps(dev, vthr)));
+    if (mask) {
+      float v[4];
+      _mm_storeu_ps(v, dev);
+      for (int k = 0; k < 4; k++)
+        if (mask & (1 << k))
+          addEvent(st, STAT_SPIKE, series, f + k, v[k]);
+    }
+  }
+#endif
+  for (; f < n - 1; f++) {
+    float d1 = x[f] - x[f - 1], d2 = x[f + 1] - x[f];
+    float dev = fminf(fabsf(d1), fabsf(d2));
+    if (d1 * d2 < 0 && dev > threshold)
+      addEvent(st, STAT_SPIKE, series, f, dev);
+  }
+}
+
+// Diferenca de ordem 0, 1 ou 2 de 4 amostras a partir de x[i]
+#ifdef __SSE2__
+static __m128 diff4(const float *x, int i, int order) {
+  __m128 a = _mm_loadu_ps(x + i);
+  if (order == 0)
+    return a;
+  __m128 b = _mm_loadu_ps(x + i + 1);
+  if (order == 1)
+    return _mm_sub_ps(b, a);
+  return _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(x + i + 2), _mm_add_ps(b, b)), a);
+}
+#endif
+
+static float diff1(const float *x, int i, int order) {
+  if (order == 0)
+    return x[i];
+  if (order == 1)
+    return x[i + 1] - x[i];
+  return x[i + 2] - 2 * x[i + 1] + x[i];
+}
+
+// out[f] = scale * |diferenca de ordem order do vetor (x, y, z) em f|,
+// para f em [0, n - order)
+static void differenceNorm(const float *x, const float *y, const float *z,
+                           int n, int order, float scale, float *out) {
+  int m = n - order, i = 0;
+#ifdef __SSE2__
+  const __m128 vscale = _mm_set1_ps(scale);
+  for (; i + 4 <= m; i += 4) {
+    __m128 dx = diff4(x, i, order), dy = diff4(y, i, order),
+           dz = diff4(z, i, order);
+    __m128 len = _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    _mm_storeu_ps(out + i, _mm_mul_ps(len, vscale));
+  }
+#endif
+  for (; i < m; i++) {
+    float dx = diff1(x, i, order), dy = diff1(y, i, order),
+          dz = diff1(z, i, order);
+    out[i] = scale * sqrtf(dx * dx + dy * dy + dz * dz);
+  }
+}
+
+// **********************************************************************
+//  Analise do clip
+// **********************************************************************
+
+static int addSeries(ClipStats *st, int node, int kind, int channel,
+                     const char *quantity) {
+  SeriesStats *s = &st->series[st->numSeries];
+  memset(s, 0, sizeof(*s));
+  s->node = node;
+  s->kind = kind;
+  s->channel = channel;
+  snprintf(s->quantity, sizeof(s->quantity), "%s", quantity);
+  return st->numSeries++;
+}
+
+static float summarize(ClipStats *st, int series, const float *x, int n) {
+  SeriesStats *s = &st->series[series];
+  float meanStep;
+  seriesMoments(x, n, s);
+  s->peakStep = stepPeak(x, n, &s->peakFrame, &meanStep);
+  return meanStep;
+}
+
+ClipStats *computeClipStats(Clip *clip, const StatsParams *p) {
+  int n = clip->totalFrames, tc = clip->totalChannels;
+  float dt = clip->frameTime > 0 ? clip->frameTime : 1.0f / 30.0f;
+  if (!clip->quats)
+    buildQuatTracks(clip, 1);
+
+  ClipStats *st = calloc(1, sizeof(ClipStats));
+  st->frames = n;
+  st->frameTime = clip->frameTime;
+  st->numNodes = clip->numNodes;
+  st->names = malloc(clip->numNodes * sizeof(char *));
+  st->series = malloc(clip->numNodes * 10 * sizeof(SeriesStats));
+
+  // Canais em colunas: channels[c * n + f]
+  float *channels = malloc((size_t)tc * n * sizeof(float));
+  for (int f = 0; f < n; f++)
+    for (int c = 0; c < tc; c++)
+      channels[(size_t)c * n + f] = clip->motion[(size_t)f * tc + c];
+
+  // Posicoes globais das juntas, tambem em colunas: pos[(j * 3 + k) * n + f]
+  float *pos = malloc((size_t)clip->numNodes * 3 * n * sizeof(float));
+  float *world = malloc(clip->numNodes * 16 * sizeof(float));
+  for (int f = 0; f < n; f++) {
+    computeWorld(clip, f, world);
+    for (int j = 0; j < clip->numNodes; j++)
+      for (int k = 0; k < 3; k++)
+        pos[(size_t)(j * 3 + k) * n + f] = world[j * 16 + 12 + k];
+  }
+  free(world);
+
+  float *series = malloc((n > 1 ? n : 1) * sizeof(float));
+  float *angular = malloc((size_t)3 * (n > 1 ? n : 1) * sizeof(float));
+  float *angle = malloc((n > 1 ? n : 1) * sizeof(float));
+
+  for (int j = 0; j < clip->numNodes; j++) {
+    const Node *node = clip->nodes[j];
+    st->names[j] = strdup(node->name);
+
+    // Canais do arquivo
+    int rotSeries[3], numRot = 0;
+    for (int c = 0; node->channelOffset >= 0 && c < node->channels; c++) {
+      char axis = node->channelOrder[c], quantity[12];
+      snprintf(quantity, sizeof(quantity), "%c%s", toupper(axis),
+               axis >= 'x' ? "position" : "rotation");
+      int s = addSeries(st, j, STAT_CHANNEL, c, quantity);
+      const float *x = channels + (size_t)(node->channelOffset + c) * n;
+      float meanStep = summarize(st, s, x, n);
+      float threshold = p->spikeFactor * meanStep;
+      findSpikes(st, s, x, n, threshold > p->spikeMin ? threshold : p->spikeMin);
+      if (axis < 'x' && numRot < 3)
+        rotSeries[numRot++] = s;
+    }
+
+    // Velocidade e aceleracao lineares da junta
+    const float *px = pos + (size_t)j * 3 * n, *py = px + n, *pz = py + n;
+    if (n >= 2) {
+      differenceNorm(px, py, pz, n, 1, 1 / dt, series);
+      summarize(st, addSeries(st, j, STAT_SPEED, -1, "speed"), series, n - 1);
+    }
+    if (n >= 3) {
+      differenceNorm(px, py, pz, n, 2, 1 / (dt * dt), series);
+      summarize(st, addSeries(st, j, STAT_ACCEL, -1, "accel"), series, n - 2);
+    }
+
+    if (node->quatIndex < 0 || n < 2)
+      continue;
+
+    // Velocidade angular: rotacao relativa entre frames consecutivos,
+    // como vetor eixo * angulo (graus/s)
+    float *wx = angular, *wy = wx + n, *wz = wy + n;
+    for (int f = 0; f + 1 < n; f++) {
+      const float *a = frameQuats(clip, f) + node->quatIndex * 4;
+      const float *b = frameQuats(clip, f + 1) + node->quatIndex * 4;
+      float v[3] = {a[3] * b[0] - b[3] * a[0] - (a[1] * b[2] - a[2] * b[1]),
+                    a[3] * b[1] - b[3] * a[1] - (a[2] * b[0] - a[0] * b[2]),
+                    a[3] * b[2] - b[3] * a[2] - (a[0] * b[1] - a[1] * b[0])};
+      float w = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+      float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+      angle[f] = 2 * atan2f(len, fabsf(w)) * RAD_TO_DEG;
+      float k = len > 1e-12f ? (w < 0 ? -1 : 1) * angle[f] / (len * dt) : 0;
+      wx[f] = v[0] * k;
+      wy[f] = v[1] * k;
+      wz[f] = v[2] * k;
+    }
+    int angSeries = addSeries(st, j, STAT_ANGSPEED, -1, "angspeed");
+    differenceNorm(wx, wy, wz, n - 1, 0, 1, series);
+    summarize(st, angSeries, series, n - 1);
+    if (n >= 3) {
+      differenceNorm(wx, wy, wz, n - 1, 1, 1 / dt, series);
+      summarize(st, addSeries(st, j, STAT_ANGACCEL, -1, "angaccel"), series,
+                n - 2);
+    }
+
+    // Flip: algum angulo de Euler salta muito, mas a orientacao nao;
+    // jump: a propria orientacao salta
+    for (int f = 0; f + 1 < n; f++) {
+      float step = 0;
+      int worst = -1;
+      for (int r = 0; r < numRot; r++) {
+        const float *x = channels +
+            (size_t)(node->channelOffset + st->series[rotSeries[r]].channel) * n;
+        float d = fabsf(x[f + 1] - x[f]);
+        if (d > step) {
+          step = d;
+          worst = rotSeries[r];
+        }
+      }
+      if (worst >= 0 && step > p->flipAngle && angle[f] < p->flipAngle * 0.5f)
+        addEvent(st, STAT_FLIP, worst, f + 1, step);
+      else if (angle[f] > p->jumpAngle)
+        addEvent(st, STAT_JUMP, angSeries, f + 1, angle[f]);
+    }
+  }
+
+  free(channels);
+  free(pos);
+  free(series);
+  free(angular);
+  free(angle);
+  return st;
+}
+
+void freeClipStats(ClipStats *s) {
+  if (!s)
+    return;
+  for (int j = 0; j < s->numNodes; j++)
+    free(s->names[j]);
+  free(s->names);
+  free(s->series);
+  free(s->events);
+  free(s);
+}
+
+// **********************************************************************
+//  Saida
+// **********************************************************************
+
+static const char *eventNames[] = {"spike", "flip", "jump"};
+
+static void writeQuoted(FILE *out, const char *text, int json) {
+  fputc('"', out);
+  for (const char *c = text; *c; c++) {
+    if (*c == '"')
+      fputs(json ? "\\\"" : "\"\"", out);
+    else if (json && *c == '\\')
+      fputs("\\\\", out);
+    else if ((unsigned char)*c >= 0x20)
+      fputc(*c, out);
+  }
+  fputc('"', out);
+}
+
+void writeStatsCsvHeader(FILE *out) {
+  fprintf(out, "file,joint,quantity,min,max,mean,variance,peakStep,peakFrame,"
+               "events\n");
+}
+
+void writeStatsCsv(FILE *out, const char *file, const ClipStats *s) {
+  for (int i = 0; i < s->numSeries; i++) {
+    const SeriesStats *r = &s->series[i];
+    writeQuoted(out, file, 0);
+    fputc(',', out);
+    writeQuoted(out, s->names[r->node], 0);
+    fprintf(out, ",%s,%g,%g,%g,%g,%g,%d,%d\n", r->quantity, r->min, r->max,
+            r->mean, r->variance, r->peakStep, r->peakFrame, r->events);
+  }
+}
+
+// ,"nome":valor; JSON nao tem NaN nem infinito (ex.: canal com NaN no
+// arquivo), que viram null
+static void writeJsonNumber(FILE *out, const char *name, double value) {
+  if (isfinite(value))
+    fprintf(out, ",\"%s\":%g", name, value);
+  else
+    fprintf(out, ",\"%s\":null", name);
+}
+
+void writeStatsJson(FILE *out, const char *file, const ClipStats *s,
+                    int first) {
+  fprintf(out, "%s{\"file\":", first ? "" : ",\n");
+  writeQuoted(out, file, 1);
+  fprintf(out, ",\"frames\":%d", s->frames);
+  writeJsonNumber(out, "frameTime", s->frameTime);
+  fprintf(out, ",\"series\":[");
+  for (int i = 0; i < s->numSeries; i++) {
+    const SeriesStats *r = &s->series[i];
+    fprintf(out, "%s\n {\"joint\":", i ? "," : "");
+    writeQuoted(out, s->names[r->node], 1);
+    fprintf(out, ",\"quantity\":\"%s\"", r->quantity);
+    writeJsonNumber(out, "min", r->min);
+    writeJsonNumber(out, "max", r->max);
+    writeJsonNumber(out, "mean", r->mean);
+    writeJsonNumber(out, "variance", r->variance);
+    writeJsonNumber(out, "peakStep", r->peakStep);
+    fprintf(out, ",\"peakFrame\":%d,\"events\":%d}", r->peakFrame,
+            r->events);
+  }
+  fprintf(out, "],\"events\":[");
+  for (int i = 0; i < s->numEvents; i++) {
+    const StatEvent *e = &s->events[i];
+    const SeriesStats *r = &s->series[e->series];
+    fprintf(out, "%s\n {\"type\":\"%s\",\"joint\":", i ? "," : "",
+            eventNames[e->type]);
+    writeQuoted(out, s->names[r->node], 1);
+    fprintf(out, ",\"quantity\":\"%s\",\"frame\":%d", r->quantity,
+            e->frame);
+    writeJsonNumber(out, "value", e->value);
+    fputc('}', out);
+  }
+  fprintf(out, "]}");
+}
@@ -0,0 +1,74 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "bvh.h"
+
+// Grandezas analisadas de cada junta
+enum {
+  STAT_CHANNEL,  // um canal do arquivo (graus ou unidades)
+  STAT_SPEED,    // velocidade linear da junta (unidades/s)
+  STAT_ACCEL,    // aceleracao linear (unidades/s^2)
+  STAT_ANGSPEED, // velocidade angular da rotacao local (graus/s)
+  STAT_ANGACCEL  // aceleracao angular (graus/s^2)
+};
+
+// Tipos de evento
+enum {
+  STAT_SPIKE, // um frame isolado foge da curva dos vizinhos
+  STAT_FLIP,  // angulos de Euler saltam, mas a orientacao quase nao muda
+  STAT_JUMP   // a orientacao salta de um frame para o outro
+};
+
+typedef struct {
+  float spikeFactor; // spike: desvio > spikeFactor * passo medio da serie
+  float spikeMin;    // ... e maior que este valor absoluto
+  float flipAngle;   // flip: passo de Euler acima deste (graus) ...
+  float jumpAngle;   // jump: rotacao entre dois frames acima deste (graus)
+} StatsParams;
+
+void defaultStatsParams(StatsParams *p);
+
+// Resumo de uma serie temporal
+typedef struct {
+  int node;        // indice do nodo em Clip.nodes
+  int kind;        // STAT_*
+  int channel;     // canal do nodo (STAT_CHANNEL)
+  char quantity[12]; // "Zrotation", "speed", ...
+  float min, max, mean, variance;
+  float peakStep;  // maior |x[f+1] - x[f]|
+  int peakFrame;   // frame f do maior passo
+  int events;      // eventos atribuidos a serie
+} SeriesStats;
+
+typedef struct {
+  int type;   // STAT_SPIKE, STAT_FLIP ou STAT_JUMP
+  int series; // indice em ClipStats.series
+  int frame;
+  float value; // desvio (spike) ou passo em graus (flip/jump)
+} StatEvent;
+
+typedef struct {
+  int frames;
+  float frameTime;
+  int numNodes;
+  char **names; // nome de cada nodo (copias, o clip pode ser liberado)
+  int numSeries;
+  SeriesStats *series;
+  int numEvents;
+  StatEvent *events;
+} ClipStats;
+
+// Analisa o clip (cria as trilhas de quaternions se ainda nao existirem)
+ClipStats *computeClipStats(Clip *clip, const StatsParams *p);
+void freeClipStats(ClipStats *s);
+
+// Saida: CSV tem uma linha por serie; JSON tem um objeto por clip com as
+// series e a lista de eventos. first indica o primeiro clip do arquivo.
+void writeStatsCsvHeader(FILE *out);
+void writeStatsCsv(FILE *out, const char *file, const ClipStats *s);
+void writeStatsJson(FILE *out, const char *file, const ClipStats *s,
+                    int first);
+
+#endif
@@ -0,0 +1,421 @@
+// **********************************************************************
+//	stream.c
+//  Poses ao vivo por datagramas (UDP ou socket Unix): emissor e receptor.
+//  O receptor le o socket numa thread e entrega os frames a thread da
+//  GLUT por uma fila sem locks; so o frame mais recente e exibido.
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stream.h"
+
+#ifndef WIN32
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "queue.h"
+
+// Frames em transito entre a thread de rede e a da GLUT
+#define STREAM_SLOTS 64
+// Intervalo (ms) em que a thread de rede verifica se deve terminar
+#define STREAM_POLL_MS 100
+
+int openStreamSocket(const char *address, int listening) {
+  int fd;
+  if (strchr(address, '/')) {
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(address) >= sizeof(addr.sun_path)) {
+      printf("Erro: caminho de socket longo demais: %s\n", address);
+      return -1;
+    }
+    strcpy(addr.sun_path, address);
+    fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0)
+      return -1;
+    if (listening)
+      unlink(address);
+    if ((listening ? bind(fd, (struct sockaddr *)&addr, sizeof(addr))
+                   : connect(fd, (struct sockaddr *)&addr, sizeof(addr))) < 0) {
+      printf("Erro: %s: %s\n", address, strerror(errno));
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // "porta" ou "host:porta"
+  char host[256] = "127.0.0.1";
+  const char *port = address, *colon = strrchr(address, ':');
+  if (colon) {
+    size_t n = colon - address;
+    if (n >= sizeof(host))
+      n = sizeof(host) - 1;
+    memcpy(host, address, n);
+    host[n] = '\0';
+    port = colon + 1;
+  }
+  struct addrinfo hints = {0}, *info;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host, port, &hints, &info) != 0) {
+    printf("Erro: endereco invalido: %s\n", address);
+    return -1;
+  }
+  fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+  int ok = fd >= 0 && (listening ? bind(fd, info->ai_addr, info->ai_addrlen)
+                                 : connect(fd, info->ai_addr,
+                                           info->ai_addrlen)) == 0;
+  freeaddrinfo(info);
+  if (!ok) {
+    printf("Erro: %s: %s\n", address, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  if (listening) {
+    // Folga para rajadas enquanto a thread de rede nao e escalonada
+    int size = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  }
+  return fd;
+}
+
+// **********************************************************************
+//  Emissor
+// **********************************************************************
+
+char *hierarchyPacketText(const Clip *clip, size_t *length, uint32_t *id) {
+  char *text = NULL;
+  FILE *file = open_memstream(&text, length);
+  if (!file)
+    return NULL;
+  // So o frame 0: o receptor usa o parser de arquivos e ja tem uma pose
+  Clip header = *clip;
+  header.totalFrames = 1;
+  writeClip(file, &header);
+  fclose(file);
+  // O identificador depende so da hierarquia (texto antes de MOTION)
+  const char *motion = strstr(text, "MOTION");
+  *id = (uint32_t)hashBytes(text, motion ? (size_t)(motion - text) : *length,
+                            HASH_SEED);
+  return text;
+}
+
+int sendHierarchy(int fd, const char *text, size_t length, uint32_t id,
+                  uint32_t sequence) {
+  static char packet[STREAM_MAX_PACKET];
+  if (sizeof(StreamHeader) + length > sizeof(packet)) {
+    printf("Erro: hierarquia grande demais para um datagrama (%zu bytes)\n",
+           length);
+    return 0;
+  }
+  StreamHeader h = {STREAM_MAGIC, STREAM_HIERARCHY, 0, id, sequence, 0,
+                    (uint32_t)length, nowSeconds()};
+  memcpy(packet, &h, sizeof(h));
+  memcpy(packet + sizeof(h), text, length);
+  return send(fd, packet, sizeof(h) + length, 0) >= 0;
+}
+
+int sendFrame(int fd, const Clip *clip, int frame, uint32_t id,
+              uint32_t sequence) {
+  static char packet[STREAM_MAX_PACKET];
+  size_t size = clip->totalChannels * sizeof(float);
+  if (sizeof(StreamHeader) + size > sizeof(packet))
+    return 0;
+  StreamHeader h = {STREAM_MAGIC, STREAM_FRAME, 0, id, sequence,
+                    (uint32_t)frame, (uint32_t)clip->totalChannels,
+                    nowSeconds()};
+  memcpy(packet, &h, sizeof(h));
+  memcpy(packet + sizeof(h), clip->data[frame], size);
+  return send(fd, packet, sizeof(h) + size, 0) >= 0;
+}
+
+// **********************************************************************
+//  Receptor
+// **********************************************************************
+
+typedef struct StreamFrame {
+  uint32_t hierarchy, sequence;
+  int channels, capacity;
+  double sendTime, recvTime;
+  float *values;
+} StreamFrame;
+
+struct StreamReceiver {
+  int fd;
+  char *path;          // socket Unix a remover no fim (ou NULL)
+  pthread_t thread;
+  atomic_int stopping;
+
+  StreamFrame slots[STREAM_SLOTS];
+  SpscQueue freeSlots, fullSlots;
+
+  // Hierarquia mais recente (thread de rede) e ainda nao pega pela GLUT
+  pthread_mutex_t lock;
+  Clip *pendingClip;
+  uint32_t pendingId;
+  uint32_t netHierarchy;   // so a thread de rede
+  int netChannels;
+  uint32_t shownHierarchy; // so a thread da GLUT
+
+  // Contadores da thread de rede
+  atomic_long packets, dropped;
+
+  // Estatisticas da thread da GLUT
+  long frames, skipped;
+  long windowFrames, windowShown;
+  double networkSum, displaySum, maxDisplay;
+  double takenSendTime; // envio do ultimo frame pego (0 = ja exibido)
+  uint32_t lastSequence;
+};
+
+static void receiveHierarchy(StreamReceiver *r, const StreamHeader *h,
+                             const char *text) {
+  if (h->hierarchy == r->netHierarchy)
+    return; // repeticao periodica do emissor
+  FILE *file = fmemopen((void *)text, h->count, "rb");
+  if (!file)
+    return;
+  Clip *clip = readClip(file);
+  fclose(file);
+  if (!clip) {
+    printf("Erro: hierarquia recebida invalida\n");
+    return;
+  }
+  r->netHierarchy = h->hierarchy;
+  r->netChannels = clip->totalChannels;
+  printf("Hierarquia recebida: %d juntas, %d canais\n", clip->numNodes,
+         clip->totalChannels);
+  pthread_mutex_lock(&r->lock);
+  freeClip(r->pendingClip);
+  r->pendingClip = clip;
+  r->pendingId = h->hierarchy;
+  pthread_mutex_unlock(&r->lock);
+}
+
+static void receiveFrame(StreamReceiver *r, const StreamHeader *h,
+                         const char *values) {
+  if (h->hierarchy != r->netHierarchy || (int)h->count != r->netChannels) {
+    atomic_fetch_add(&r->dropped, 1);
+    return;
+  }
+  StreamFrame *f = queuePop(&r->freeSlots);
+  if (!f) {
+    // A GLUT parou de consumir (janela escondida, etc.)
+    atomic_fetch_add(&r->dropped, 1);
+    return;
+  }
+  if (f->capacity < (int)h->count) {
+    free(f->values);
+    f->values = malloc(h->count * sizeof(float));
+    f->capacity = h->count;
+  }
+  f->hierarchy = h->hierarchy;
+  f->sequence = h->sequence;
+  f->channels = h->count;
+  f->sendTime = h->sendTime;
+  f->recvTime = nowSeconds();
+  memcpy(f->values, values, h->count * sizeof(float));
+  queuePush(&r->fullSlots, f);
+}
+
+static void *receiveLoop(void *arg) {
+  StreamReceiver *r = arg;
+  static char packet[STREAM_MAX_PACKET + 1];
+  struct pollfd pfd = {r->fd, POLLIN, 0};
+  while (!atomic_load(&r->stopping)) {
+    if (poll(&pfd, 1, STREAM_POLL_MS) <= 0)
+      continue;
+    ssize_t n = recv(r->fd, packet, STREAM_MAX_PACKET, 0);
+    StreamHeader h;
+    if (n < (ssize_t)sizeof(h))
+      continue;
+    memcpy(&h, packet, sizeof(h));
+    size_t payload = n - sizeof(h);
+    if (h.magic != STREAM_MAGIC)
+      continue;
+    if (h.type == STREAM_HIERARCHY && h.count == payload) {
+      atomic_fetch_add(&r->packets, 1);
+      receiveHierarchy(r, &h, packet + sizeof(h));
+    } else if (h.type == STREAM_FRAME && h.count * sizeof(float) == payload) {
+      atomic_fetch_add(&r->packets, 1);
+      receiveFrame(r, &h, packet + sizeof(h));
+    }
+  }
+  return NULL;
+}
+
+StreamReceiver *startStreamReceiver(const char *address) {
+  int fd = openStreamSocket(address, 1);
+  if (fd < 0)
+    return NULL;
+  StreamReceiver *r = calloc(1, sizeof(StreamReceiver));
+  r->fd = fd;
+  r->path = strchr(address, '/') ? strdup(address) : NULL;
+  pthread_mutex_init(&r->lock, NULL);
+  initQueue(&r->freeSlots, STREAM_SLOTS);
+  initQueue(&r->fullSlots, STREAM_SLOTS);
+  for (int i = 0; i < STREAM_SLOTS; i++)
+    queuePush(&r->freeSlots, &r->slots[i]);
+  atomic_init(&r->stopping, 0);
+  atomic_init(&r->packets, 0);
+  atomic_init(&r->dropped, 0);
+  if (pthread_create(&r->thread, NULL, receiveLoop, r) != 0) {
+    close(fd);
+    free(r->path);
+    free(r);
+    return NULL;
+  }
+  printf("Recebendo poses em %s\n", address);
+  return r;
+}
+
+void stopStreamReceiver(StreamReceiver *r) {
+  if (!r)
+    return;
+  atomic_store(&r->stopping, 1);
+  pthread_join(r->thread, NULL);
+  close(r->fd);
+  if (r->path)
+    unlink(r->path);
+  for (int i = 0; i < STREAM_SLOTS; i++)
+    free(r->slots[i].values);
+  destroyQueue(&r->freeSlots);
+  destroyQueue(&r->fullSlots);
+  freeClip(r->pendingClip);
+  pthread_mutex_destroy(&r->lock);
+  free(r->path);
+  free(r);
+}
+
+Clip *takeStreamClip(StreamReceiver *r) {
+  pthread_mutex_lock(&r->lock);
+  Clip *clip = r->pendingClip;
+  if (clip)
+    r->shownHierarchy = r->pendingId;
+  r->pendingClip = NULL;
+  pthread_mutex_unlock(&r->lock);
+  return clip;
+}
+
+Clip *waitStreamClip(StreamReceiver *r) {
+  const struct timespec nap = {0, 10000000};
+  Clip *clip;
+  while (!(clip = takeStreamClip(r)))
+    nanosleep(&nap, NULL);
+  return clip;
+}
+
+int takeStreamFrame(StreamReceiver *r, float *values, int channels) {
+  // Esvazia a fila e fica com o frame de maior sequencia
+  StreamFrame *f, *latest = NULL;
+  while ((f = queuePop(&r->fullSlots)) != NULL) {
+    if (f->hierarchy == r->shownHierarchy && f->channels == channels &&
+        (!latest || (int32_t)(f->sequence - latest->sequence) > 0)) {
+      if (latest) {
+        r->skipped++;
+        queuePush(&r->freeSlots, latest);
+      }
+      latest = f;
+    } else {
+      r->skipped++;
+      queuePush(&r->freeSlots, f);
+    }
+  }
+  if (!latest)
+    return 0;
+  // Um pacote atrasado nao volta a pose para tras; um salto grande para
+  // tras e um emissor que recomecou
+  int32_t step = (int32_t)(latest->sequence - r->lastSequence);
+  int stale = r->frames > 0 && step <= 0 && step > -STREAM_SLOTS;
+  if (!stale) {
+    memcpy(values, latest->values, channels * sizeof(float));
+    r->lastSequence = latest->sequence;
+    r->networkSum += latest->recvTime - latest->sendTime;
+    r->takenSendTime = latest->sendTime;
+    r->frames++;
+    r->windowFrames++;
+  } else
+    r->skipped++;
+  queuePush(&r->freeSlots, latest);
+  return !stale;
+}
+
+void markStreamDisplayed(StreamReceiver *r) {
+  if (r->takenSendTime == 0)
+    return;
+  double latency = nowSeconds() - r->takenSendTime;
+  r->displaySum += latency;
+  if (latency > r->maxDisplay)
+    r->maxDisplay = latency;
+  r->windowShown++;
+  r->takenSendTime = 0;
+}
+
+void streamStats(StreamReceiver *r, StreamStats *out, int reset) {
+  out->packets = atomic_load(&r->packets);
+  out->dropped = atomic_load(&r->dropped);
+  out->frames = r->frames;
+  out->skipped = r->skipped;
+  out->network =
+      r->windowFrames ? r->networkSum * 1000 / r->windowFrames : 0.0;
+  out->display =
+      r->windowShown ? r->displaySum * 1000 / r->windowShown : 0.0;
+  out->maxDisplay = r->maxDisplay * 1000;
+  if (reset) {
+    r->windowFrames = r->windowShown = 0;
+    r->networkSum = r->displaySum = r->maxDisplay = 0;
+  }
+}
+
+#else
+
+int openStreamSocket(const char *address, int listening) {
+  printf("Erro: poses ao vivo nao estao disponiveis no Windows\n");
+  return -1;
+}
+
+char *hierarchyPacketText(const Clip *clip, size_t *length, uint32_t *id) {
+  return NULL;
+}
+
+int sendHierarchy(int fd, const char *text, size_t length, uint32_t id,
+                  uint32_t sequence) {
+  return 0;
+}
+
+int sendFrame(int fd, const Clip *clip, int frame, uint32_t id,
+              uint32_t sequence) {
+  return 0;
+}
+
+StreamReceiver *startStreamReceiver(const char *address) {
+  openStreamSocket(address, 1);
+  return NULL;
+}
+
+void stopStreamReceiver(StreamReceiver *r) {}
+Clip *takeStreamClip(StreamReceiver *r) { return NULL; }
+Clip *waitStreamClip(StreamReceiver *r) { return NULL; }
+int takeStreamFrame(StreamReceiver *r, float *values, int channels) {
+  return 0;
+}
+void markStreamDisplayed(StreamReceiver *r) {}
+void streamStats(StreamReceiver *r, StreamStats *out, int reset) {
+  memset(out, 0, sizeof(*out));
+}
+
+#endif
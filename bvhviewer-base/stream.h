@@ -0,0 +1,84 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+
+#include "bvh.h"
+
+// **********************************************************************
+//  Protocolo de poses ao vivo: datagramas UDP ou Unix, um por mensagem,
+//  na ordem de bytes da maquina (o emissor e o viewer rodam no mesmo
+//  computador). O emissor manda a hierarquia (texto BVH com um frame) e
+//  depois um pacote por frame com os valores dos canais.
+// **********************************************************************
+
+#define STREAM_MAGIC 0x53485642 // "BVHS"
+#define STREAM_MAX_PACKET 65000
+
+enum { STREAM_HIERARCHY = 1, STREAM_FRAME = 2 };
+
+typedef struct StreamHeader {
+  uint32_t magic;
+  uint16_t type;      // STREAM_HIERARCHY ou STREAM_FRAME
+  uint16_t reserved;
+  uint32_t hierarchy; // identificador da hierarquia (hash do texto)
+  uint32_t sequence;  // contador de pacotes do emissor
+  uint32_t frame;     // frame do arquivo de origem (informativo)
+  uint32_t count;     // FRAME: qtd de floats; HIERARCHY: bytes de texto
+  double sendTime;    // nowSeconds() do emissor, para medir a latencia
+} StreamHeader;
+
+// Endereco: caminho com '/' = socket Unix de datagramas; "porta" ou
+// "host:porta" = UDP (host padrao 127.0.0.1). listening = 1 faz o bind
+// (receptor); 0 faz o connect (emissor). Retorna o descritor ou -1
+int openStreamSocket(const char *address, int listening);
+
+// **********************************************************************
+//  Emissor
+// **********************************************************************
+
+// Texto da hierarquia (com o frame 0) e seu identificador
+char *hierarchyPacketText(const Clip *clip, size_t *length, uint32_t *id);
+int sendHierarchy(int fd, const char *text, size_t length, uint32_t id,
+                  uint32_t sequence);
+int sendFrame(int fd, const Clip *clip, int frame, uint32_t id,
+              uint32_t sequence);
+
+// **********************************************************************
+//  Receptor: uma thread le o socket e passa os frames para a thread da
+//  GLUT por uma fila sem locks; a GLUT pega so o mais recente.
+// **********************************************************************
+
+typedef struct StreamReceiver StreamReceiver;
+
+typedef struct StreamStats {
+  long packets;     // pacotes validos recebidos
+  long frames;      // frames aplicados a pose
+  long skipped;     // frames substituidos por um mais novo antes de exibir
+  long dropped;     // frames descartados com a fila cheia ou sem hierarquia
+  // Medias e maximo da janela atual (ms)
+  double network;   // latencia envio -> recepcao
+  double display;   // latencia envio -> troca de buffers
+  double maxDisplay;
+} StreamStats;
+
+StreamReceiver *startStreamReceiver(const char *address);
+void stopStreamReceiver(StreamReceiver *r);
+
+// Clip da hierarquia recebida mais recente, se mudou desde a ultima
+// chamada (com 1 frame; o chamador passa a ser o dono). Thread da GLUT
+Clip *takeStreamClip(StreamReceiver *r);
+// Idem, esperando ate a primeira hierarquia chegar
+Clip *waitStreamClip(StreamReceiver *r);
+
+// Copia para values (channels floats) o frame mais novo da hierarquia
+// atual, descartando os mais antigos. Retorna 0 se nao ha frame novo
+int takeStreamFrame(StreamReceiver *r, float *values, int channels);
+
+// Registra que o ultimo frame pego foi exibido (apos glutSwapBuffers)
+void markStreamDisplayed(StreamReceiver *r);
+
+// Estatisticas acumuladas; reset = 1 zera as medias (janela nova)
+void streamStats(StreamReceiver *r, StreamStats *out, int reset);
+
+#endif
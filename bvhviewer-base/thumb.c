@@ -0,0 +1,191 @@
+// **********************************************************************
+//	thumb.c
+//  Folhas de contato (quadros de um clip lado a lado) desenhadas num
+//  contexto OpenGL sem janela, com drawNode/drawFloor do visualizador
+// **********************************************************************
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "draw.h"
+#include "thumb.h"
+
+// Angulos da camera, os mesmos da posicao inicial do visualizador
+#define VIEW_ROT_X 35
+#define VIEW_ROT_Y 170
+#define VIEW_FOV 60
+
+struct ThumbContext {
+  EGLSurface surface;
+  EGLContext context;
+  int width, height;
+};
+
+static pthread_once_t displayOnce = PTHREAD_ONCE_INIT;
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLConfig config;
+
+// Usa a plataforma "surfaceless" do Mesa quando existir, para nao depender
+// de um servidor X
+static void openDisplay() {
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+          "eglGetPlatformDisplayEXT");
+  EGLDisplay d = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+  if (getPlatformDisplay)
+    d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY,
+                           NULL);
+#endif
+  if (d == EGL_NO_DISPLAY)
+    d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (d == EGL_NO_DISPLAY || !eglInitialize(d, NULL, NULL)) {
+    printf("Erro: EGL indisponivel\n");
+    return;
+  }
+  static const EGLint attribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_RED_SIZE,     8,               EGL_GREEN_SIZE,      8,
+      EGL_BLUE_SIZE,    8,               EGL_DEPTH_SIZE,      24,
+      EGL_NONE};
+  EGLint count = 0;
+  if (!eglChooseConfig(d, attribs, &config, 1, &count) || count < 1) {
+    printf("Erro: nenhuma configuracao EGL com pbuffer e OpenGL\n");
+    eglTerminate(d);
+    return;
+  }
+  display = d;
+}
+
+void defaultThumbOptions(ThumbOptions *opt) {
+  opt->frames = 8;
+  opt->tileSize = 160;
+  opt->columns = 4;
+}
+
+void sheetSize(const ThumbOptions *opt, int *width, int *height) {
+  int columns = opt->columns < opt->frames ? opt->columns : opt->frames;
+  *width = columns * opt->tileSize;
+  *height = (opt->frames + columns - 1) / columns * opt->tileSize;
+}
+
+ThumbContext *createThumbContext(int width, int height) {
+  pthread_once(&displayOnce, openDisplay);
+  if (display == EGL_NO_DISPLAY)
+    return NULL;
+  // Contexto de compatibilidade: o desenho usa o pipeline fixo
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint size[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+  ThumbContext *ctx = calloc(1, sizeof(ThumbContext));
+  ctx->width = width;
+  ctx->height = height;
+  ctx->surface = eglCreatePbufferSurface(display, config, size);
+  ctx->context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+  if (ctx->surface == EGL_NO_SURFACE || ctx->context == EGL_NO_CONTEXT) {
+    printf("Erro: nao foi possivel criar o contexto EGL (0x%x)\n",
+           eglGetError());
+    freeThumbContext(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+void freeThumbContext(ThumbContext *ctx) {
+  if (!ctx)
+    return;
+  if (ctx->context != EGL_NO_CONTEXT)
+    eglDestroyContext(display, ctx->context);
+  if (ctx->surface != EGL_NO_SURFACE)
+    eglDestroySurface(display, ctx->surface);
+  free(ctx);
+}
+
+// Caixa envolvente das juntas na pose atual (node->world)
+static void poseBounds(const Clip *clip, float *min, float *max) {
+  for (int k = 0; k < 3; k++) {
+    min[k] = FLT_MAX;
+    max[k] = -FLT_MAX;
+  }
+  for (int i = 0; i < clip->numNodes; i++)
+    for (int k = 0; k < 3; k++) {
+      float v = clip->nodes[i]->world[12 + k];
+      min[k] = v < min[k] ? v : min[k];
+      max[k] = v > max[k] ? v : max[k];
+    }
+}
+
+static int sampleFrame(const Clip *clip, const ThumbOptions *opt, int k) {
+  if (opt->frames <= 1 || clip->totalFrames <= 1)
+    return 0;
+  return (int)((long)k * (clip->totalFrames - 1) / (opt->frames - 1));
+}
+
+int renderContactSheet(ThumbContext *ctx, Clip *clip, const ThumbOptions *opt,
+                       unsigned char *rgb) {
+  if (!eglMakeCurrent(display, ctx->surface, ctx->surface, ctx->context))
+    return 0;
+
+  // Raio da camera: o da maior pose amostrada, para o mesmo zoom em todos
+  // os quadros (o centro acompanha cada pose)
+  float radius = 1, min[3], max[3];
+  for (int k = 0; k < opt->frames; k++) {
+    applyFrame(clip, sampleFrame(clip, opt, k));
+    poseBounds(clip, min, max);
+    float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+    float r = 0.5f * sqrtf(dx * dx + dy * dy + dz * dz);
+    radius = r > radius ? r : radius;
+  }
+  float distance = radius / sinf(VIEW_FOV * 0.5f * (float)M_PI / 180) * 1.05f;
+
+  setupScene();
+  glViewport(0, 0, ctx->width, ctx->height);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glEnable(GL_SCISSOR_TEST);
+
+  for (int k = 0; k < opt->frames; k++) {
+    int column = k % opt->columns, row = k / opt->columns;
+    int x = column * opt->tileSize;
+    int y = ctx->height - (row + 1) * opt->tileSize;
+    glViewport(x, y, opt->tileSize, opt->tileSize);
+    glScissor(x, y, opt->tileSize, opt->tileSize);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    applyFrame(clip, sampleFrame(clip, opt, k));
+    poseBounds(clip, min, max);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(VIEW_FOV, 1, distance * 0.05, distance * 20);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0, 0, -distance);
+    glRotatef(VIEW_ROT_X, 1, 0, 0);
+    glRotatef(VIEW_ROT_Y, 0, 1, 0);
+    glTranslatef(-(min[0] + max[0]) / 2, -(min[1] + max[1]) / 2,
+                 -(min[2] + max[2]) / 2);
+
+    drawFloor();
+    glColor3f(0.7, 0.0, 0.0); // vermelho, como no visualizador
+    drawNode(clip->root);
+  }
+  glDisable(GL_SCISSOR_TEST);
+
+  // O OpenGL le de baixo para cima
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  size_t stride = (size_t)ctx->width * 3;
+  unsigned char *pixels = malloc(stride * ctx->height);
+  glReadPixels(0, 0, ctx->width, ctx->height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+  int ok = glGetError() == GL_NO_ERROR;
+  for (int y = 0; y < ctx->height; y++)
+    memcpy(rgb + y * stride, pixels + (ctx->height - 1 - y) * stride, stride);
+  free(pixels);
+
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  return ok;
+}
@@ -0,0 +1,29 @@
+#ifndef THUMB_H
+#define THUMB_H
+
+#include "bvh.h"
+
+typedef struct {
+  int frames;   // frames amostrados (igualmente espacados)
+  int tileSize; // lado de cada quadro, em pixels
+  int columns;  // quadros por linha da folha
+} ThumbOptions;
+
+void defaultThumbOptions(ThumbOptions *opt);
+// Tamanho da folha de contato em pixels
+void sheetSize(const ThumbOptions *opt, int *width, int *height);
+
+// Contexto OpenGL sem janela (EGL + pbuffer, renderizador por software do
+// Mesa quando nao ha GPU). Cada thread usa o seu; o contexto fica corrente
+// so durante renderContactSheet.
+typedef struct ThumbContext ThumbContext;
+ThumbContext *createThumbContext(int width, int height);
+void freeThumbContext(ThumbContext *ctx);
+
+// Desenha os quadros do clip, com a camera enquadrando a pose de cada um,
+// e le a folha em rgb (width * height * 3 bytes, linha 0 = topo).
+// Retorna 0 em caso de erro
+int renderContactSheet(ThumbContext *ctx, Clip *clip, const ThumbOptions *opt,
+                       unsigned char *rgb);
+
+#endif
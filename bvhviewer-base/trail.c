@@ -0,0 +1,73 @@
+// **********************************************************************
+//	trail.c
+//  Buffer circular de poses para trajetorias e "fantasmas" (onion skin)
+// **********************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trail.h"
+
+PoseRing *createPoseRing(const Clip *clip, int radius) {
+  PoseRing *ring = calloc(1, sizeof(PoseRing));
+  ring->radius = radius;
+  ring->capacity = 2 * radius + 1;
+  ring->numNodes = clip->numNodes;
+  ring->frames = malloc(ring->capacity * sizeof(int));
+  for (int i = 0; i < ring->capacity; i++)
+    ring->frames[i] = -1;
+  ring->positions =
+      malloc((size_t)ring->capacity * clip->numNodes * 3 * sizeof(float));
+  ring->world = malloc(clip->numNodes * 16 * sizeof(float));
+  return ring;
+}
+
+void freePoseRing(PoseRing *ring) {
+  if (!ring)
+    return;
+  free(ring->frames);
+  free(ring->positions);
+  free(ring->world);
+  free(ring);
+}
+
+int updatePoseRing(PoseRing *ring, const Clip *clip, int center) {
+  int first = center - ring->radius;
+  int last = center + ring->radius;
+  if (first < 0)
+    first = 0;
+  if (last > clip->totalFrames - 1)
+    last = clip->totalFrames - 1;
+
+  int computed = 0;
+  for (int f = first; f <= last; f++) {
+    int slot = f % ring->capacity;
+    if (ring->frames[slot] == f)
+      continue;
+    computeWorld(clip, f, ring->world);
+    float *pos = ring->positions + (size_t)slot * ring->numNodes * 3;
+    for (int i = 0; i < ring->numNodes; i++)
+      memcpy(pos + i * 3, ring->world + i * 16 + 12, 3 * sizeof(float));
+    ring->frames[slot] = f;
+    computed++;
+  }
+  ring->first = first;
+  ring->count = last - first + 1;
+  return computed;
+}
+
+const float *ringPositions(const PoseRing *ring, int frame) {
+  if (frame < ring->first || frame >= ring->first + ring->count)
+    return NULL;
+  return ring->positions +
+         (size_t)(frame % ring->capacity) * ring->numNodes * 3;
+}
+
+void gatherTrails(const PoseRing *ring, float *out) {
+  for (int k = 0; k < ring->count; k++) {
+    const float *pos = ringPositions(ring, ring->first + k);
+    for (int i = 0; i < ring->numNodes; i++)
+      memcpy(out + ((size_t)i * ring->count + k) * 3, pos + i * 3,
+             3 * sizeof(float));
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include "bvh.h"
+
+// Buffer circular com as posicoes globais das juntas dos frames em torno
+// do frame atual. O frame f fica no slot f % capacity, de modo que avancar
+// um frame na reproducao so calcula a FK do frame que entrou na janela.
+typedef struct PoseRing {
+  int radius;       // qtd de frames antes e depois do centro
+  int capacity;     // 2 * radius + 1
+  int numNodes;
+  int *frames;      // frame guardado em cada slot (-1 = vazio)
+  float *positions; // capacity * numNodes * 3
+  float *world;     // rascunho para a FK (numNodes matrizes)
+  int first, count; // janela valida atual: [first, first + count)
+} PoseRing;
+
+PoseRing *createPoseRing(const Clip *clip, int radius);
+void freePoseRing(PoseRing *ring);
+
+// Centra a janela em center, calculando so os frames que faltam.
+// Retorna a qtd de frames calculados
+int updatePoseRing(PoseRing *ring, const Clip *clip, int center);
+
+// Posicoes (numNodes * 3) de um frame da janela atual
+const float *ringPositions(const PoseRing *ring, int frame);
+
+// Copia a janela para out em ordem junta-major: as ring->count posicoes
+// da junta 0, depois as da junta 1... (numNodes * count * 3 floats)
+void gatherTrails(const PoseRing *ring, float *out);
+
+#endif